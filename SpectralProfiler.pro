@@ -1,33 +1,26 @@
-QT = widgets
+QT = widgets network
 CONFIG += qwt
 
 SOURCES = \
     sources/main.cc \
     sources/application.cc \
+    sources/measurement.cc \
+    sources/controlserver.cc \
     sources/mainwindow.cc \
-    sources/audiosys.cc \
-    sources/audioprocessor.cc \
-    sources/analyzerdefs.cc \
-    sources/messages.cc \
-    sources/utility/ring_buffer.cpp
+    sources/waterfallview.cc
 
 HEADERS = \
     sources/application.h \
+    sources/measurement.h \
+    sources/controlserver.h \
     sources/mainwindow.h \
-    sources/audiosys.h \
-    sources/audioprocessor.h \
-    sources/analyzerdefs.h \
-    sources/messages.h \
-    sources/utility/nextpow2.h \
-    sources/utility/ring_buffer.h \
-    sources/utility/counting_bitset.h \
-    sources/utility/counting_bitset.tcc
+    sources/waterfallview.h
+
+include(sources/engine.pri)
 
 FORMS = \
     forms/mainwindow.ui
 
-LIBS = -ljack -lfftw3f
-
 DESTDIR = build
 OBJECTS_DIR = build/obj
 MOC_DIR = build/moc
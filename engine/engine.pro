@@ -0,0 +1,12 @@
+TEMPLATE = lib
+CONFIG += staticlib c++11
+CONFIG -= qt
+TARGET = spectralengine
+
+include(../sources/engine.pri)
+
+SOURCES += ../sources/spectralengine.cc
+HEADERS += ../sources/spectralengine.h
+
+DESTDIR = build
+OBJECTS_DIR = build/obj
@@ -9,6 +9,5 @@
 namespace Analysis {
 
 float sample_rate;
-float global_gain = 0.5f;
 
 }  // namespace Analysis
@@ -4,6 +4,7 @@
 //          http://www.boost.org/LICENSE_1_0.txt)
 
 #pragma once
+#include <cmath>
 
 namespace Analysis {
 
@@ -17,12 +18,38 @@ enum {
     db_range_max = +40,
 };
 
+enum {
+    rta_range_min = -100,
+    rta_range_max = 0,
+};
+
 enum {
     sweep_length = 128,
+    sweep_capacity = 1024,
+};
+
+enum {
+    // capacity of a multitone step, and the setting of the sweep, beyond
+    // which the tones of the coarse grid share the bins at the low end
+    max_bins_at_once = sweep_capacity,
+    max_parallel = 32,
+};
+
+enum {
+    // limit of the capture of a step, in periods of the analysis
+    max_capture_blocks = 8,
+};
+
+enum {
+    max_bands = 288,
+};
+
+enum {
+    max_matrix_channels = 8,
 };
 
 enum {
-    max_bins_at_once = 32,
+    parallel_regions = 4,
 };
 
 enum Signal_Pseudo_Level {
@@ -30,19 +57,67 @@ enum Signal_Pseudo_Level {
     Signal_Hi,
 };
 
+enum Measurement_Mode {
+    Mode_Sweep,
+    Mode_Transfer,
+    Mode_Rta,
+    Mode_Matrix,
+};
+
+enum Noise_Type {
+    Noise_White,
+    Noise_Pink,
+    Noise_Periodic_Pink,
+};
+
+// the windows of the stepped sine, which trade the rejection of the other
+// tones for the flatness of the main lobe
+enum Window_Type {
+    Window_Hann,
+    Window_Flat_Top,
+    Window_Blackman_Harris,
+};
+[[gnu::unused]] static constexpr unsigned num_window_types = 3;
+
+enum Phase_View {
+    Phase_Wrapped,
+    Phase_Unwrapped,
+    Phase_Group_Delay,
+};
+
+// the rate of the audio system, as published by Parameter_Block
 extern float sample_rate;
-extern float global_gain;
 
 [[gnu::unused]] static constexpr float silence_threshold = 1e-4f;
 
+// tolerance of the residual of a multitone step in automatic parallelism,
+// relative to a single tone, unless below the floor
+[[gnu::unused]] static constexpr float parallel_margin_db = 6;
+[[gnu::unused]] static constexpr float parallel_floor_db = -60;
+
 inline constexpr double spl_amplitude(int spl)
 {
     return (spl == Signal_Hi) ? 1.0 : 0.01;
 }
 
-inline double global_amplitude(int spl)
+// the largest mismatch of the clock of the loop which the analysis follows,
+// and the least which it compensates, as smaller ones are likely noise
+[[gnu::unused]] static constexpr double max_clock_drift = 500e-6;
+[[gnu::unused]] static constexpr double min_clock_drift = 2e-6;
+
+// the largest target of uncertainty in dB, which sets the length of captures
+[[gnu::unused]] static constexpr double max_target_uncertainty = 3;
+
+// standard uncertainty in dB of a magnitude measured with the given ratio of
+// the power of the tone to that of the noise in its bin, and the converse
+inline double snr_uncertainty_db(double snr)
+{
+    return (snr > 0) ? (20 / M_LN10) / std::sqrt(2 * snr) : INFINITY;
+}
+
+inline double uncertainty_snr(double db)
 {
-    return spl_amplitude(spl) * global_gain;
+    return (db > 0) ? 0.5 * std::pow((20 / M_LN10) / db, 2) : 0;
 }
 
 inline unsigned nth_bin_position(unsigned sweep_index, unsigned nth_bin, unsigned count_at_once)
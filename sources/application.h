@@ -5,9 +5,6 @@
 
 #pragma once
 #include <QApplication>
-#include <memory>
-class Audio_Processor;
-class MainWindow;
 
 class Application : public QApplication {
     Q_OBJECT
@@ -15,30 +12,6 @@ class Application : public QApplication {
 public:
     Application(int &argc, char *argv[]);
     ~Application();
-
-    void setAudioProcessor(Audio_Processor &proc);
-    void setMainWindow(MainWindow &win);
-
-    void setSweepEnabled(bool lo, bool hi);
-    void setFreqsAtOnce(unsigned count);
-
-signals:
-    void sweepPhaseChanged(int spl);
-
-public slots:
-    void setSweepActive(bool active);
-    void saveProfile();
-
-protected slots:
-    void realtimeUpdateTick();
-    void nextSweepTick();
-
-private:
-    void replotResponses();
-
-private:
-    struct Impl;
-    std::unique_ptr<Impl> P;
 };
 
 #define theApplication static_cast<::Application *>(qApp)
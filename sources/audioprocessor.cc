@@ -7,110 +7,198 @@
 #include "audiosys.h"
 #include "analyzerdefs.h"
 #include "messages.h"
-#include "dsp/amp_follower.h"
+#include "processorchannel.h"
+#include "transferanalyzer.h"
+#include "bandanalyzer.h"
+#include "multitone.h"
+#include "fftplan.h"
+#include "rtprofiler.h"
+#include "rtarena.h"
+#include "tracer.h"
+#include "dsp/noise_generator.h"
+#include "dsp/kernels.h"
 #include "utility/nextpow2.h"
 #include "utility/ring_buffer.h"
 #include <fftw3.h>
 #include <algorithm>
-#include <thread>
 #include <complex>
+#include <cstdlib>
 #include <cassert>
 typedef std::complex<float> cfloat;
 typedef std::complex<double> cdouble;
 
 struct Audio_Processor::Impl {
-    static void process(const float *in, float *out, unsigned n, void *userdata);
-    void handle_messages();
+    void configure();
+    static void process(const float *in, const float *ref, float *out, unsigned n, void *userdata);
     void process_message(const Basic_Message &hmsg);
     void generate(float *out, unsigned n);
-    void collect(const float *in, unsigned n);
-    void compute_response(cfloat *response);
+    void generate_noise(float *out, unsigned n);
+    void apply_gain(float *out, unsigned n, float amp);
     void update_levels(const float *in, float *out, unsigned n);
+    void init_periodic_noise(unsigned size);
+    static void xrun(void *userdata);
 
 /*
     static cdouble interpolate(const cfloat *in, double pos, unsigned size);
     static double interpolate4(const double *y, double mu);
 */
 
-    Amp_Follower<float> in_amp_follower_;
-    Amp_Follower<float> out_amp_follower_;
+    // the kernels for this processor, chosen before the audio thread runs
+    const Dsp_Kernels *kernels_ = nullptr;
+
+    // peak levels, which decay with the release of the meters
+    float amp_decay_ = 0;
     float in_amp_ = 0;
     float out_amp_ = 0;
 
-    std::unique_ptr<Ring_Buffer> rb_in_;
-    std::unique_ptr<Ring_Buffer> rb_out_;
-    std::unique_ptr<uint8_t[]> rb_in_buf_;
-    std::unique_ptr<uint8_t[]> rb_out_buf_;
+    // the buffers of the audio thread, in memory locked at configuration
+    Rt_Arena arena_;
+
+    std::unique_ptr<Ring_Buffer> rb_worker_;
+    Message_Buffer result_buf_;
 
+    unsigned loop_ = 0;
     bool active_ = false;
+    int mode_ = Analysis::Mode_Sweep;
+
+    // the messages and the parameters of the cycle, shared with the
+    // control thread
+    Processor_Channel channel_;
 
     bool gen_can_start_ = false;
     bool gen_has_finished_ = false;
     int gen_spl_ = Analysis::Signal_Lo;
 
-    unsigned gen_num_bins_ = 0;
-    float gen_freq_[Analysis::max_bins_at_once] = {};
-    float gen_phase_[Analysis::max_bins_at_once] = {};
-    float gen_starting_phase_[Analysis::max_bins_at_once] = {};
-    float gen_gain_compensate_ = 0;
+    uint32_t gen_version_ = 0;
+    uint32_t trace_step_ = 0;
+    uint64_t frames_ = 0;
 
-    std::unique_ptr<float[]> out_buf_;
-    unsigned out_buf_len_ = 0;
-    unsigned out_buf_fill_ = 0;
+    // the tones of the sweep, and their analysis at the input
+    Multitone_Generator gen_;
+    Multitone_Analyzer analyzer_;
+
+    int gen_noise_ = Analysis::Noise_Pink;
+    White_Noise<float> white_noise_;
+    Pink_Noise<float> pink_noise_;
+    float *periodic_noise_ = nullptr;
+    unsigned periodic_noise_len_ = 0;
+    unsigned periodic_noise_pos_ = 0;
+
+    unsigned fft_size_ = 0;
 
     struct Fftwf_Deleter {
         void operator()(void *x) { fftwf_free(x); }
     };
-    struct Fftwf_Plan_Deleter {
-        void operator()(fftwf_plan x) { fftwf_destroy_plan(x); }
-    };
 
-    std::unique_ptr<float[], Fftwf_Deleter> fft_real_;
-    std::unique_ptr<cfloat[], Fftwf_Deleter> fft_cplx_;
-    std::unique_ptr<fftwf_plan_s, Fftwf_Plan_Deleter> fft_plan_;
+    std::unique_ptr<Transfer_Analyzer> transfer_;
+    std::unique_ptr<Band_Analyzer> bands_;
+
+    std::unique_ptr<Rt_Profiler> profiler_;
 };
 
-Audio_Processor::Audio_Processor()
+Audio_Processor::Audio_Processor(unsigned loop)
     : P(new Impl)
+{
+    P->loop_ = loop;
+    P->profiler_.reset(new Rt_Profiler(Analysis::sample_rate));
+    P->configure();
+}
+
+Audio_Processor::~Audio_Processor()
+{
+}
+
+void Audio_Processor::Impl::configure()
 {
     const float sr = Analysis::sample_rate;
 
-    P->in_amp_follower_.release(50e-3f * sr);
-    P->out_amp_follower_.release(50e-3f * sr);
+    kernels_ = &dsp_kernels();
+    amp_decay_ = std::exp(-1 / (50e-3f * sr));
 
-    P->rb_in_.reset(new Ring_Buffer(8192));
-    P->rb_out_.reset(new Ring_Buffer(8192));
-    P->rb_in_buf_.reset(Messages::allocate_buffer());
-    P->rb_out_buf_.reset(Messages::allocate_buffer());
+    rb_worker_.reset(new Ring_Buffer(16384));
 
     const unsigned fft_size = nextpow2(std::ceil(0.5f * sr));
+    const unsigned nb = Analysis::max_bins_at_once;
+    const size_t result_size = Messages::NotifyFrequencyAnalysis::size_for(nb);
 
-    P->out_buf_len_ = fft_size;
-    P->out_buf_.reset(new float[fft_size]);
+    Rt_Arena &arena = arena_;
+    arena.reset(
+        Processor_Channel::footprint() +
+        Rt_Arena::footprint<uint8_t>(result_size) +
+        Multitone_Generator::footprint(nb) +
+        Multitone_Analyzer::footprint(nb, fft_size) +
+        Rt_Arena::footprint<float>(fft_size));
 
-    P->fft_real_.reset(fftwf_alloc_real(fft_size));
-    P->fft_cplx_.reset((cfloat *)fftwf_alloc_complex(fft_size / 2 + 1));
-    if (!P->fft_real_ || !P->fft_cplx_)
-        throw std::bad_alloc();
+    channel_.configure(arena, sr);
+    result_buf_.attach(arena.allocate<uint8_t>(result_size), result_size);
 
-    P->fft_plan_.reset(fftwf_plan_dft_r2c_1d(fft_size, P->fft_real_.get(), (fftwf_complex *)P->fft_cplx_.get(), FFTW_MEASURE));
-    if (!P->fft_plan_)
-        throw std::bad_alloc();
-}
+    // the transform by default, or the detector named by the environment
+    fft_size_ = fft_size;
+    gen_.configure(arena, nb, fft_size, 1);
+    analyzer_.configure(arena, nb, fft_size, getenv("SP_DETECTOR"));
 
-Audio_Processor::~Audio_Processor()
-{
+    transfer_.reset(new Transfer_Analyzer(fft_size));
+
+    // the analyzer updates at 10 Hz
+    unsigned band_hop = std::min<unsigned>(std::lround(0.1f * sr), fft_size);
+    bands_.reset(new Band_Analyzer(fft_size, band_hop, *rb_worker_));
+
+    init_periodic_noise(fft_size);
+
+    // the tracer allocates when first used, which is not for the audio thread
+    Tracer::instance();
 }
 
 void Audio_Processor::start()
 {
+    start_analyzers();
+
+    // the profiler outlives the reconfigurations, unlike the rest
     Audio_Sys &sys = Audio_Sys::instance();
-    sys.start(&Impl::process, this);
+    sys.set_xrun_callback(P->loop_, &Impl::xrun, P->profiler_.get());
+    sys.start(P->loop_, &Impl::process, this);
+}
+
+void Audio_Processor::start_analyzers()
+{
+    P->transfer_->start();
+    P->bands_->start();
+}
+
+void Audio_Processor::reconfigure()
+{
+    std::unique_ptr<Impl> impl(new Impl);
+    impl->loop_ = P->loop_;
+    impl->profiler_ = std::move(P->profiler_);
+    impl->profiler_->set_sample_rate(Analysis::sample_rate);
+    impl->configure();
+
+    impl->transfer_->set_averages(P->transfer_->averages());
+    impl->bands_->set_resolution(P->bands_->resolution());
+    impl->bands_->set_time_constant(P->bands_->time_constant());
+
+    // the old analyzers stop as they are destroyed
+    P = std::move(impl);
+}
+
+void Audio_Processor::process(const float *in, const float *ref, float *out, unsigned n)
+{
+    Impl::process(in, ref, out, n, this);
+}
+
+unsigned Audio_Processor::loop() const
+{
+    return P->loop_;
 }
 
 unsigned Audio_Processor::fft_size() const
 {
-    return P->out_buf_len_;
+    return P->fft_size_;
+}
+
+bool Audio_Processor::memory_locked() const
+{
+    return P->arena_.locked();
 }
 
 float Audio_Processor::input_level() const
@@ -123,114 +211,184 @@ float Audio_Processor::output_level() const
     return P->out_amp_;
 }
 
-void Audio_Processor::send_message(const Basic_Message &hmsg)
+Transfer_Analyzer &Audio_Processor::transfer_analyzer()
 {
-    Ring_Buffer &rb = *P->rb_in_;
-    while (!rb.put((uint8_t *)&hmsg, Messages::size_of(hmsg.tag)))
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return *P->transfer_;
 }
 
-Basic_Message *Audio_Processor::receive_message()
+Band_Analyzer &Audio_Processor::band_analyzer()
 {
-    Ring_Buffer &rb = *P->rb_out_;
-    Basic_Message *msg = (Basic_Message *)P->rb_out_buf_.get();
+    return *P->bands_;
+}
 
-    if (!rb.peek(*msg))
-        return nullptr;
+const Rt_Profiler &Audio_Processor::profiler() const
+{
+    return *P->profiler_;
+}
 
-    size_t size = Messages::size_of(msg->tag);
-    if (rb.size_used() < size)
-        return nullptr;
+void Audio_Processor::send_message(const Basic_Message &hmsg)
+{
+    P->channel_.send_message(hmsg);
+}
 
-    rb.get((uint8_t *)msg, size);
-    return msg;
+Basic_Message *Audio_Processor::receive_message()
+{
+    if (Basic_Message *rt_msg = P->channel_.receive_message())
+        return rt_msg;
+    return P->channel_.receive_message(*P->rb_worker_);
 }
 
-void Audio_Processor::Impl::process(const float *in, float *out, unsigned n, void *userdata)
+void Audio_Processor::Impl::process(const float *in, const float *ref, float *out, unsigned n, void *userdata)
 {
     Audio_Processor *self = (Audio_Processor *)userdata;
     Impl *P = self->P.get();
+    Rt_Profiler &prof = *P->profiler_;
+
+    prof.begin_cycle(n);
 
     std::fill_n(out, n, 0);
 
-    P->handle_messages();
+    {
+        Rt_Profiler::Scope scope(prof, Rt_Profiler::Stage_Messages);
+        P->channel_.update_parameters();
+        P->channel_.handle_messages([P](const Basic_Message &hmsg) { P->process_message(hmsg); });
+    }
+
+    bool generated = false;
 
-    if (P->active_) {
+    if (P->active_ && P->mode_ == Analysis::Mode_Transfer) {
+        Rt_Profiler::Scope scope(prof, Rt_Profiler::Stage_Stream);
+        const float *channels[] = {ref, in};
+        P->transfer_->push(channels, n);
+    }
+    else if (P->active_ && P->mode_ == Analysis::Mode_Rta) {
+        {
+            Rt_Profiler::Scope scope(prof, Rt_Profiler::Stage_Generate);
+            P->generate_noise(out, n);
+            generated = true;
+        }
+        Rt_Profiler::Scope scope(prof, Rt_Profiler::Stage_Stream);
+        const float *channels[] = {in};
+        P->bands_->push(channels, n);
+    }
+    else if (P->active_) {
         if (P->gen_can_start_) {
-            P->collect(in, n);
-            if (!P->gen_has_finished_ && P->out_buf_fill_ == P->out_buf_len_) {
-                Ring_Buffer &rb_out = *P->rb_out_;
-                Messages::NotifyFrequencyAnalysis msg;
-                if (sizeof(msg) < rb_out.size_free()) {
+            // the next period of the capture follows without a gap
+            Multitone_Analyzer &analyzer = P->analyzer_;
+            for (unsigned i = 0; i < n;) {
+                {
+                    Rt_Profiler::Scope scope(prof, Rt_Profiler::Stage_Collect);
+                    i += analyzer.collect(in + i, n - i, P->frames_ + i);
+                }
+                if (!analyzer.block_ready())
+                    break;
+                Rt_Profiler::Scope scope(prof, Rt_Profiler::Stage_Response);
+                analyzer.analyze_block();
+            }
+            if (!P->gen_has_finished_ && analyzer.complete()) {
+                Ring_Buffer &rb_out = P->channel_.output();
+                const unsigned num_bins = P->gen_.count();
+                if (Messages::NotifyFrequencyAnalysis::size_for(num_bins) < rb_out.size_free()) {
+                    auto &msg = P->result_buf_.emplace<Messages::NotifyFrequencyAnalysis>(num_bins);
                     msg.spl = P->gen_spl_;
-                    msg.num_bins = P->gen_num_bins_;
-                    P->compute_response(msg.response);
-                    for (unsigned a = 0; a < msg.num_bins; ++a)
-                        msg.frequency[a] = P->gen_freq_[a] * Analysis::sample_rate;
-                    rb_out.put(msg);
+                    msg.version = (P->channel_.params().version == P->gen_version_) ? P->gen_version_ : 0;
+                    msg.blocks = analyzer.blocks();
+                    msg.drift = analyzer.drift();
+                    Tracer &tracer = Tracer::instance();
+                    tracer.event(Tracer::Track_Audio, Tracer::Phase_Async_End, "capture", P->trace_step_);
+                    tracer.event(Tracer::Track_Audio, Tracer::Phase_Begin, "analysis");
+                    {
+                        Rt_Profiler::Scope scope(prof, Rt_Profiler::Stage_Response);
+                        const float amp = Analysis::spl_amplitude(P->gen_spl_) * P->channel_.gain_ramp().current();
+                        analyzer.compute_response(msg.response(), msg.snr(), amp);
+                        msg.residual = analyzer.compute_residual();
+                    }
+                    tracer.event(Tracer::Track_Audio, Tracer::Phase_End, "analysis");
+                    tracer.event(Tracer::Track_Audio, Tracer::Phase_Async_Begin, "result wait", P->trace_step_);
+                    float *frequency = msg.frequency();
+                    for (unsigned a = 0; a < num_bins; ++a)
+                        frequency[a] = P->gen_.frequency(a) * P->channel_.params().sample_rate;
+                    rb_out.put((uint8_t *)&msg, msg.size);
                     P->gen_has_finished_ = true;
                 }
             }
         }
 
-        if (!P->gen_can_start_ && P->out_amp_ < Analysis::silence_threshold) {
+        // the capture starts in silence, once the gain has settled
+        if (!P->gen_can_start_ && P->out_amp_ < Analysis::silence_threshold && !P->channel_.gain_ramp().active()) {
             P->gen_can_start_ = true;
-            for (unsigned a = 0, num_bins = P->gen_num_bins_; a < num_bins; ++a)
-                P->gen_starting_phase_[a] = P->gen_phase_[a];
+            P->gen_version_ = P->channel_.params().version;
+            P->gen_.mark_start();
+            P->analyzer_.start_capture(P->frames_ + n);
+            Tracer &tracer = Tracer::instance();
+            tracer.event(Tracer::Track_Audio, Tracer::Phase_Async_End, "silence wait", P->trace_step_);
+            tracer.event(Tracer::Track_Audio, Tracer::Phase_Async_Begin, "capture", P->trace_step_);
         }
 
-        if (P->gen_can_start_)
+        if (P->gen_can_start_) {
+            Rt_Profiler::Scope scope(prof, Rt_Profiler::Stage_Generate);
             P->generate(out, n);
+            generated = true;
+        }
+    }
+
+    if (!generated)
+        P->channel_.gain_ramp().skip(n);
+
+    {
+        Rt_Profiler::Scope scope(prof, Rt_Profiler::Stage_Levels);
+        P->update_levels(in, out, n);
     }
 
-    P->update_levels(in, out, n);
+    P->frames_ += n;
+
+    prof.end_cycle();
 }
 
-void Audio_Processor::Impl::handle_messages()
+void Audio_Processor::Impl::xrun(void *userdata)
 {
-    Ring_Buffer &rb_in = *rb_in_;
-    Basic_Message *hmsg = (Basic_Message *)rb_in_buf_.get();
-    while (rb_in.peek(*hmsg)) {
-        size_t size = Messages::size_of(hmsg->tag);
-        if (rb_in.size_used() < size)
-            break;
-        rb_in.get((uint8_t *)hmsg, size);
-        process_message(*hmsg);
-    }
+    Rt_Profiler *prof = (Rt_Profiler *)userdata;
+    prof->xrun();
 }
 
 void Audio_Processor::Impl::process_message(const Basic_Message &hmsg)
 {
-    float sr = Analysis::sample_rate;
-    unsigned fft_size = out_buf_len_;
+    float sr = channel_.params().sample_rate;
 
     switch (hmsg.tag) {
     case Message_Tag::RequestAnalyzeFrequency: {
         auto *msg = (Messages::RequestAnalyzeFrequency *)&hmsg;
         active_ = true;
+        mode_ = Analysis::Mode_Sweep;
         gen_can_start_ = false;
         gen_has_finished_ = false;
         gen_spl_ = msg->spl;
-        unsigned num_bins = gen_num_bins_ = msg->num_bins;
-        for (unsigned a = 0; a < num_bins; ++a) {
-            unsigned bin = std::lround(fft_size * msg->frequency[a] / sr);
-            bin = std::min(bin, fft_size / 2);
-            gen_freq_[a] = (float)bin / fft_size;
-            gen_phase_[a] = 0;
-            gen_starting_phase_[a] = 0;
-        }
-        out_buf_fill_ = 0;
-
-        // compensate for level increase caused by sum of sines
-        float rms_single = M_SQRT1_2;
-        float rms_sum = sqrt((M_SQRT1_2 * M_SQRT1_2) * num_bins);
-        gen_gain_compensate_ = rms_single / rms_sum;
-
+        gen_.set_tones(msg->frequency(), nullptr, msg->num_bins, sr);
+        analyzer_.begin_step(gen_, msg->window, msg->uncertainty, frames_);
+
+        // the steps are numbered in the same order by the GUI
+        Tracer &tracer = Tracer::instance();
+        ++trace_step_;
+        tracer.event(Tracer::Track_Audio, Tracer::Phase_Async_End, "queue", trace_step_);
+        tracer.event(Tracer::Track_Audio, Tracer::Phase_Async_Begin, "silence wait", trace_step_);
         break;
     }
     case Message_Tag::RequestStop:
         active_ = false;
+        analyzer_.end_sweep();
+        break;
+    case Message_Tag::RequestTransferAnalysis:
+        active_ = true;
+        mode_ = Analysis::Mode_Transfer;
+        break;
+    case Message_Tag::RequestNoiseAnalysis: {
+        auto *msg = (Messages::RequestNoiseAnalysis *)&hmsg;
+        active_ = true;
+        mode_ = Analysis::Mode_Rta;
+        gen_spl_ = msg->spl;
+        gen_noise_ = msg->noise;
         break;
+    }
     default:
         assert(false);
         break;
@@ -239,81 +397,91 @@ void Audio_Processor::Impl::process_message(const Basic_Message &hmsg)
 
 void Audio_Processor::Impl::generate(float *out, unsigned n)
 {
-    const float amp = Analysis::global_amplitude(gen_spl_);
-
     for (unsigned i = 0; i < n; ++i)
         out[i] = 0;
 
-    unsigned num_bins = gen_num_bins_;
-    for (unsigned a = 0; a < num_bins; ++a) {
-        const float f = gen_freq_[a];
-        float p = gen_phase_[a];
+    gen_.generate(&out, n);
+    apply_gain(out, n, Analysis::spl_amplitude(gen_spl_));
+}
+
+void Audio_Processor::Impl::generate_noise(float *out, unsigned n)
+{
+    switch (gen_noise_) {
+    case Analysis::Noise_White:
+        for (unsigned i = 0; i < n; ++i)
+            out[i] = white_noise_.process();
+        break;
+    default:
+    case Analysis::Noise_Pink:
+        for (unsigned i = 0; i < n; ++i)
+            out[i] = pink_noise_.process();
+        break;
+    case Analysis::Noise_Periodic_Pink: {
+        const float *noise = periodic_noise_;
+        const unsigned len = periodic_noise_len_;
+        unsigned pos = periodic_noise_pos_;
         for (unsigned i = 0; i < n; ++i) {
-            out[i] += amp * std::cos(2 * (float)M_PI * p);
-            p += f;
-            p -= (int)p;
+            out[i] = noise[pos];
+            pos = (pos + 1 < len) ? (pos + 1) : 0;
         }
-        gen_phase_[a] = p;
+        periodic_noise_pos_ = pos;
+        break;
+    }
     }
 
-    //
-    const float comp = gen_gain_compensate_;
-    for (unsigned i = 0; i < n; ++i)
-        out[i] *= comp;
+    apply_gain(out, n, Analysis::spl_amplitude(gen_spl_));
 }
 
-void Audio_Processor::Impl::collect(const float *in, unsigned n)
+void Audio_Processor::Impl::apply_gain(float *out, unsigned n, float amp)
 {
-    float *buf = out_buf_.get();
-    const unsigned len = out_buf_len_;
-    unsigned fill = out_buf_fill_;
+    Gain_Ramp<float> &ramp = channel_.gain_ramp();
+    if (!ramp.active()) {
+        const float g = amp * ramp.current();
+        for (unsigned i = 0; i < n; ++i)
+            out[i] *= g;
+        return;
+    }
 
-    n = std::min(n, len - fill);
     for (unsigned i = 0; i < n; ++i)
-        buf[fill++] = in[i];
+        out[i] *= amp * ramp.process();
+}
 
-    out_buf_fill_ = fill;
+void Audio_Processor::Impl::update_levels(const float *in, float *out, unsigned n)
+{
+    in_amp_ = kernels_->peak_envelope(in, n, amp_decay_, in_amp_);
+    out_amp_ = kernels_->peak_envelope(out, n, amp_decay_, out_amp_);
 }
 
-void Audio_Processor::Impl::compute_response(cfloat *response)
+void Audio_Processor::Impl::init_periodic_noise(unsigned size)
 {
-    const unsigned n = out_buf_len_;
+    // pink spectrum with random phases, which repeats exactly every period
+    std::unique_ptr<float[], Fftwf_Deleter> real(fftwf_alloc_real(size));
+    std::unique_ptr<cfloat[], Fftwf_Deleter> cplx((cfloat *)fftwf_alloc_complex(size / 2 + 1));
+    if (!real || !cplx)
+        throw std::bad_alloc();
 
-    const float *raw = out_buf_.get();
-    float *real = fft_real_.get();
-    cfloat *cplx = fft_cplx_.get();
+    Fft_Plan plan = Fft_Plan_Cache::instance().get(size, Fft_Type::Real_Backward);
 
-    for (unsigned i = 0; i < n; ++i) {
-        float w = 0.5f * (1 - std::cos((2 * (float)M_PI * i) / (n - 1)));
-        real[i] = raw[i] * w;
-    }
+    White_Noise<float> phase_gen;
+    cplx[0] = 0;
+    for (unsigned i = 1; i < size / 2; ++i)
+        cplx[i] = std::polar(1 / std::sqrt((float)i), (float)M_PI * phase_gen.process());
+    cplx[size / 2] = 0;
 
-    fftwf_execute(fft_plan_.get());
-
-    unsigned num_bins = gen_num_bins_;
-    for (unsigned a = 0; a < num_bins; ++a) {
-        const float f = gen_freq_[a];
-        unsigned bin = std::lround(n * f);
-        cfloat h_out = cplx[bin] * 4.0f / (float)n;
-        cfloat h_in = std::polar(
-            (float)Analysis::global_amplitude(gen_spl_) * gen_gain_compensate_,
-            2 * (float)M_PI * gen_starting_phase_[a]);
-        response[a] = h_out / h_in;
-    }
-}
+    plan.execute(cplx.get(), real.get());
 
-void Audio_Processor::Impl::update_levels(const float *in, float *out, unsigned n)
-{
-    float in_amp = in_amp_;
-    float out_amp = out_amp_;
-
-    for (unsigned i = 0; i < n; ++i) {
-        in_amp = in_amp_follower_.process(in[i]);
-        out_amp = out_amp_follower_.process(out[i]);
-    };
+    // normalize to the level of the pink noise generator
+    double sum2 = 0;
+    for (unsigned i = 0; i < size; ++i)
+        sum2 += real[i] * real[i];
+    const float rms = 0.1f;
+    const float gain = rms / std::sqrt(sum2 / size);
 
-    in_amp_ = in_amp;
-    out_amp_ = out_amp;
+    float *noise = arena_.allocate<float>(size);
+    periodic_noise_ = noise;
+    periodic_noise_len_ = size;
+    for (unsigned i = 0; i < size; ++i)
+        noise[i] = real[i] * gain;
 }
 
 /*
@@ -6,18 +6,40 @@
 #pragma once
 #include <memory>
 struct Basic_Message;
+class Transfer_Analyzer;
+class Band_Analyzer;
+class Rt_Profiler;
 
 class Audio_Processor {
 public:
-    Audio_Processor();
+    explicit Audio_Processor(unsigned loop = 0);
     ~Audio_Processor();
     void start();
 
+    // rebuilds the buffers, plans and analyzers for the current rate, while
+    // the audio system holds the cycles, and drops the analysis in progress;
+    // the analyzers stay stopped until `start_analyzers`, once the transfer
+    // analyzer has its frequencies
+    void reconfigure();
+    void start_analyzers();
+
+    // runs one cycle outside of the audio system, for simulations
+    void process(const float *in, const float *ref, float *out, unsigned n);
+
+    unsigned loop() const;
+
     unsigned fft_size() const;
+    // whether the buffers of the audio thread are locked in memory
+    bool memory_locked() const;
 
     float input_level() const;
     float output_level() const;
 
+    Transfer_Analyzer &transfer_analyzer();
+    Band_Analyzer &band_analyzer();
+
+    const Rt_Profiler &profiler() const;
+
     void send_message(const Basic_Message &hmsg);
     Basic_Message *receive_message();
 
@@ -4,7 +4,11 @@
 //          http://www.boost.org/LICENSE_1_0.txt)
 
 #include "audiosys.h"
-#include <QCoreApplication>
+#include "rtguard.h"
+#include <algorithm>
+#include <thread>
+
+std::string Audio_Sys::client_name_ = "Spectral Profiler";
 
 Audio_Sys &Audio_Sys::instance()
 {
@@ -12,29 +16,32 @@ Audio_Sys &Audio_Sys::instance()
     return sys;
 }
 
-Audio_Sys::Audio_Sys()
+void Audio_Sys::set_client_name(const std::string &name)
 {
-    QCoreApplication *app = QCoreApplication::instance();
+    client_name_ = name;
+}
 
+Audio_Sys::Audio_Sys()
+{
     jack_client_t *client = jack_client_open(
-        app->applicationName().toUtf8().data(),
-        JackNoStartServer, nullptr);
+        client_name_.c_str(), JackNoStartServer, nullptr);
     if (!client)
         return;
 
     client_.reset(client);
 
-    jack_port_t *in = jack_port_register(client, app->tr("Measurement input").toUtf8().data(), JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
-    jack_port_t *out = jack_port_register(client, app->tr("Generator output").toUtf8().data(), JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
-    if (!in || !out) {
+    if (!add_loop()) {
         client_.reset();
         return;
     }
 
-    in_ = in;
-    out_ = out;
+    rate_.store(jack_get_sample_rate(client));
+    period_.store(jack_get_buffer_size(client));
 
     jack_set_process_callback(client, &process, this);
+    jack_set_xrun_callback(client, &xrun, this);
+    jack_set_sample_rate_callback(client, &sample_rate_changed, this);
+    jack_set_buffer_size_callback(client, &buffer_size_changed, this);
 }
 
 Audio_Sys::~Audio_Sys()
@@ -46,17 +53,69 @@ Audio_Sys::operator bool() const
     return client_ != nullptr;
 }
 
+unsigned Audio_Sys::loop_count() const
+{
+    return num_loops_;
+}
+
+bool Audio_Sys::add_loop()
+{
+    jack_client_t *client = client_.get();
+    unsigned index = num_loops_;
+    if (index == max_loops)
+        return false;
+
+    std::string suffix = (index > 0) ? (" " + std::to_string(index + 1)) : std::string();
+
+    jack_port_t *in = jack_port_register(client, ("Measurement input" + suffix).c_str(), JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
+    jack_port_t *ref = jack_port_register(client, ("Reference input" + suffix).c_str(), JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
+    jack_port_t *out = jack_port_register(client, ("Generator output" + suffix).c_str(), JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+    if (!in || !ref || !out) {
+        for (jack_port_t *port : {in, ref, out}) {
+            if (port)
+                jack_port_unregister(client, port);
+        }
+        return false;
+    }
+
+    Loop &loop = loops_[index];
+    loop.in_ = in;
+    loop.ref_ = ref;
+    loop.out_ = out;
+    num_loops_ = index + 1;
+    return true;
+}
+
 float Audio_Sys::sample_rate() const
 {
-    return jack_get_sample_rate(client_.get());
+    return rate_.load();
+}
+
+unsigned Audio_Sys::buffer_size() const
+{
+    return period_.load();
+}
+
+jack_nframes_t Audio_Sys::frame_time() const
+{
+    return jack_frame_time(client_.get());
 }
 
-void Audio_Sys::start(void (*fn)(const float *, float *, unsigned, void *), void *data)
+void Audio_Sys::start(unsigned loop, void (*fn)(const float *, const float *, float *, unsigned, void *), void *data)
 {
     jack_client_t *client = client_.get();
     jack_deactivate(client);
-    cb_fn_ = fn;
-    cb_data_ = data;
+    loops_[loop].cb_fn_ = fn;
+    loops_[loop].cb_data_ = data;
+    jack_activate(client);
+}
+
+void Audio_Sys::start_group(Group_Fn *fn, void *data)
+{
+    jack_client_t *client = client_.get();
+    jack_deactivate(client);
+    group_fn_ = fn;
+    group_data_ = data;
     jack_activate(client);
 }
 
@@ -66,15 +125,99 @@ void Audio_Sys::stop()
     jack_deactivate(client);
 }
 
+bool Audio_Sys::config_changed() const
+{
+    return config_serial_.load() != config_ack_.load();
+}
+
+unsigned Audio_Sys::suspend() const
+{
+    // the cycle which saw the change returns at once, so this waits for one
+    // which started before at most
+    unsigned serial = config_serial_.load();
+    while (busy_.load())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return serial;
+}
+
+void Audio_Sys::resume(unsigned serial)
+{
+    config_ack_.store(serial);
+}
+
+void Audio_Sys::set_xrun_callback(unsigned loop, void (*fn)(void *), void *data)
+{
+    // to call before start, while the client is inactive
+    loops_[loop].xrun_fn_ = fn;
+    loops_[loop].xrun_data_ = data;
+}
+
 int Audio_Sys::process(jack_nframes_t nframes, void *userdata)
 {
     Audio_Sys *self = (Audio_Sys *)userdata;
+    const unsigned nloops = self->num_loops_;
+    Rt_Guard::Scope guard;
+
+    // the processors are not touched until they are rebuilt
+    self->busy_.store(true);
+    bool stale = self->config_serial_.load() != self->config_ack_.load();
+
+    const float *in[max_loops];
+    const float *ref[max_loops];
+    float *out[max_loops];
+    for (unsigned i = 0; i < nloops; ++i) {
+        const Loop &loop = self->loops_[i];
+        in[i] = (float *)jack_port_get_buffer(loop.in_, nframes);
+        ref[i] = (float *)jack_port_get_buffer(loop.ref_, nframes);
+        out[i] = (float *)jack_port_get_buffer(loop.out_, nframes);
+    }
+
+    if (stale) {
+        for (unsigned i = 0; i < nloops; ++i)
+            std::fill_n(out[i], nframes, 0.0f);
+    }
+    else if (!self->group_fn_ || !self->group_fn_(in, out, nloops, nframes, self->group_data_)) {
+        for (unsigned i = 0; i < nloops; ++i) {
+            const Loop &loop = self->loops_[i];
+            if (loop.cb_fn_)
+                loop.cb_fn_(in[i], ref[i], out[i], nframes, loop.cb_data_);
+            else
+                std::fill_n(out[i], nframes, 0.0f);
+        }
+    }
+
+    self->busy_.store(false);
+    return 0;
+}
+
+int Audio_Sys::xrun(void *userdata)
+{
+    Audio_Sys *self = (Audio_Sys *)userdata;
+
+    for (unsigned i = 0, n = self->num_loops_; i < n; ++i) {
+        const Loop &loop = self->loops_[i];
+        if (loop.xrun_fn_)
+            loop.xrun_fn_(loop.xrun_data_);
+    }
 
-    const float *in = (float *)jack_port_get_buffer(self->in_, nframes);
-    float *out = (float *)jack_port_get_buffer(self->out_, nframes);
+    return 0;
+}
 
-    if (self->cb_fn_)
-        self->cb_fn_(in, out, nframes, self->cb_data_);
+int Audio_Sys::sample_rate_changed(jack_nframes_t rate, void *userdata)
+{
+    Audio_Sys *self = (Audio_Sys *)userdata;
+
+    // also called at the activation, with the rate which is known already
+    if (self->rate_.exchange((float)rate) != (float)rate)
+        self->config_serial_.fetch_add(1);
+    return 0;
+}
+
+int Audio_Sys::buffer_size_changed(jack_nframes_t nframes, void *userdata)
+{
+    Audio_Sys *self = (Audio_Sys *)userdata;
 
+    if (self->period_.exchange(nframes) != nframes)
+        self->config_serial_.fetch_add(1);
     return 0;
 }
@@ -4,12 +4,17 @@
 //          http://www.boost.org/LICENSE_1_0.txt)
 
 #include <jack/jack.h>
+#include <atomic>
 #include <memory>
+#include <string>
 
 class Audio_Sys {
 public:
     static Audio_Sys &instance();
 
+    // to call before the first use of the instance
+    static void set_client_name(const std::string &name);
+
 private:
     Audio_Sys();
 
@@ -17,21 +22,66 @@ public:
     ~Audio_Sys();
     explicit operator bool() const;
 
+    enum { max_loops = 16 };
+
+    // each measurement loop has its own ports, served by the same callback;
+    // the loops are added before the first start, while the client is
+    // inactive, since the callback reads them without synchronization
+    unsigned loop_count() const;
+    bool add_loop();
+
     float sample_rate() const;
+    unsigned buffer_size() const;
+    jack_nframes_t frame_time() const;
 
-    void start(void (*fn)(const float *, float *, unsigned, void *), void *data);
+    // the server changed its rate or its period, and the cycles are silent
+    // until the processors are rebuilt for them; the reconfiguration waits
+    // for the cycle in progress with `suspend`, and lets the next ones run
+    // with the serial it returned
+    bool config_changed() const;
+    unsigned suspend() const;
+    void resume(unsigned serial);
+
+    void start(unsigned loop, void (*fn)(const float *, const float *, float *, unsigned, void *), void *data);
     void stop();
 
+    void set_xrun_callback(unsigned loop, void (*fn)(void *), void *data);
+
+    // processing of all the loops together, which takes precedence over the
+    // callbacks of the loops in the cycles where it returns true
+    typedef bool (Group_Fn)(const float *const *in, float *const *out, unsigned nloops, unsigned n, void *);
+    void start_group(Group_Fn *fn, void *data);
+
 private:
     struct Jack_Deleter {
         void operator()(jack_client_t *x) { jack_client_close(x); }
     };
 
+    struct Loop {
+        jack_port_t *in_ = nullptr;
+        jack_port_t *ref_ = nullptr;
+        jack_port_t *out_ = nullptr;
+        void (*cb_fn_)(const float *, const float *, float *, unsigned, void *) = nullptr;
+        void *cb_data_ = nullptr;
+        void (*xrun_fn_)(void *) = nullptr;
+        void *xrun_data_ = nullptr;
+    };
+
+    static std::string client_name_;
     std::unique_ptr<jack_client_t, Jack_Deleter> client_;
-    jack_port_t *in_ = nullptr;
-    jack_port_t *out_ = nullptr;
-    void (*cb_fn_)(const float *, float *, unsigned, void *) = nullptr;
-    void *cb_data_ = nullptr;
+    Loop loops_[max_loops];
+    unsigned num_loops_ = 0;
+    Group_Fn *group_fn_ = nullptr;
+    void *group_data_ = nullptr;
+
+    std::atomic<float> rate_{0};
+    std::atomic<unsigned> period_{0};
+    std::atomic<unsigned> config_serial_{0};
+    std::atomic<unsigned> config_ack_{0};
+    std::atomic<bool> busy_{false};
 
     static int process(jack_nframes_t nframes, void *userdata);
+    static int xrun(void *userdata);
+    static int sample_rate_changed(jack_nframes_t rate, void *userdata);
+    static int buffer_size_changed(jack_nframes_t nframes, void *userdata);
 };
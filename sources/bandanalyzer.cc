@@ -0,0 +1,198 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "bandanalyzer.h"
+#include "analyzerdefs.h"
+#include "messages.h"
+#include "fftplan.h"
+#include "windowcache.h"
+#include "dsp/kernels.h"
+#include <fftw3.h>
+#include <algorithm>
+#include <complex>
+#include <mutex>
+#include <vector>
+#include <cmath>
+typedef std::complex<float> cfloat;
+
+struct Band_Analyzer::Impl {
+    unsigned fft_size_ = 0;
+    unsigned hop_size_ = 0;
+    Ring_Buffer *rb_out_ = nullptr;
+    const Dsp_Kernels *kernels_ = nullptr;
+
+    const float *window_ = nullptr;
+    float power_scale_ = 0;
+
+    struct Fftwf_Deleter {
+        void operator()(void *x) { fftwf_free(x); }
+    };
+
+    std::unique_ptr<float[], Fftwf_Deleter> fft_real_;
+    std::unique_ptr<cfloat[], Fftwf_Deleter> fft_cplx_;
+    Fft_Plan fft_plan_;
+
+    std::mutex config_mutex_;
+    unsigned fraction_ = 3;
+    float time_constant_ = 1.0f;
+
+    std::vector<unsigned> bin_lo_;
+    std::vector<unsigned> bin_hi_;
+    std::vector<double> power_;
+    unsigned num_blocks_ = 0;
+
+    void compute_bands();
+};
+
+Band_Analyzer::Band_Analyzer(unsigned fft_size, unsigned hop_size, Ring_Buffer &rb_out)
+    : Stream_Analyzer(1, fft_size, hop_size), P(new Impl)
+{
+    P->fft_size_ = fft_size;
+    P->hop_size_ = hop_size;
+    P->rb_out_ = &rb_out;
+    P->kernels_ = &dsp_kernels();
+
+    const Window_Table &window = Window_Cache::instance().get(Analysis::Window_Hann, fft_size);
+    P->window_ = window.data;
+    // one-sided spectrum to mean square
+    P->power_scale_ = 2.0 / (fft_size * window.square_sum);
+
+    P->fft_real_.reset(fftwf_alloc_real(fft_size));
+    P->fft_cplx_.reset((cfloat *)fftwf_alloc_complex(fft_size / 2 + 1));
+    if (!P->fft_real_ || !P->fft_cplx_)
+        throw std::bad_alloc();
+
+    P->fft_plan_ = Fft_Plan_Cache::instance().get(fft_size, Fft_Type::Real_Forward);
+
+    P->compute_bands();
+}
+
+Band_Analyzer::~Band_Analyzer()
+{
+    stop();
+}
+
+void Band_Analyzer::set_resolution(unsigned fraction)
+{
+    std::lock_guard<std::mutex> lock(P->config_mutex_);
+    if (P->fraction_ == fraction)
+        return;
+    P->fraction_ = fraction;
+    P->compute_bands();
+}
+
+void Band_Analyzer::set_time_constant(float seconds)
+{
+    std::lock_guard<std::mutex> lock(P->config_mutex_);
+    P->time_constant_ = seconds;
+}
+
+unsigned Band_Analyzer::resolution() const
+{
+    std::lock_guard<std::mutex> lock(P->config_mutex_);
+    return P->fraction_;
+}
+
+float Band_Analyzer::time_constant() const
+{
+    std::lock_guard<std::mutex> lock(P->config_mutex_);
+    return P->time_constant_;
+}
+
+unsigned Band_Analyzer::band_centers(unsigned fraction, double *centers, unsigned max)
+{
+    const double fmin = Analysis::freq_range_min;
+    const double fmax = Analysis::freq_range_max;
+
+    // base-2 bands around 1 kHz
+    int kmin = (int)std::ceil(fraction * std::log2(fmin / 1000));
+    int kmax = (int)std::floor(fraction * std::log2(fmax / 1000));
+
+    unsigned count = 0;
+    for (int k = kmin; k <= kmax && count < max; ++k)
+        centers[count++] = 1000 * std::exp2((double)k / fraction);
+    return count;
+}
+
+void Band_Analyzer::process_block(const float *const *block, unsigned size)
+{
+    std::lock_guard<std::mutex> lock(P->config_mutex_);
+
+    float *real = P->fft_real_.get();
+    cfloat *cplx = P->fft_cplx_.get();
+
+    P->kernels_->multiply(real, block[0], P->window_, size);
+
+    P->fft_plan_.execute(real, cplx);
+
+    // exponential average, or cumulative if the time constant is infinite
+    unsigned k = ++P->num_blocks_;
+    double alpha;
+    if (P->time_constant_ > 0) {
+        double hop_time = P->hop_size_ / (double)Analysis::sample_rate;
+        alpha = 1 - std::exp(-hop_time / P->time_constant_);
+        alpha = std::max(alpha, 1.0 / k);
+    }
+    else
+        alpha = 1.0 / k;
+
+    Messages::NotifyBandLevels msg;
+    unsigned num_bands = (unsigned)P->bin_lo_.size();
+    msg.fraction = P->fraction_;
+    msg.num_bands = num_bands;
+
+    const double scale = P->power_scale_;
+    for (unsigned b = 0; b < num_bands; ++b) {
+        double power = 0;
+        for (unsigned i = P->bin_lo_[b], e = P->bin_hi_[b]; i < e; ++i)
+            power += std::norm(cplx[i]);
+        power *= scale;
+        double &avg = P->power_[b];
+        avg += alpha * (power - avg);
+        msg.level[b] = 10 * std::log10(avg + 1e-20);
+    }
+
+    Ring_Buffer &rb_out = *P->rb_out_;
+    if (sizeof(msg) < rb_out.size_free())
+        rb_out.put(msg);
+}
+
+void Band_Analyzer::reset()
+{
+    std::lock_guard<std::mutex> lock(P->config_mutex_);
+    std::fill(P->power_.begin(), P->power_.end(), 0.0);
+    P->num_blocks_ = 0;
+}
+
+void Band_Analyzer::Impl::compute_bands()
+{
+    const unsigned fft_size = fft_size_;
+    const unsigned max_bin = fft_size / 2;
+    const double bin_width = Analysis::sample_rate / fft_size;
+    const double half_band = std::exp2(0.5 / fraction_);
+
+    double centers[Analysis::max_bands];
+    unsigned num_bands = band_centers(fraction_, centers, Analysis::max_bands);
+
+    bin_lo_.resize(num_bands);
+    bin_hi_.resize(num_bands);
+    for (unsigned b = 0; b < num_bands; ++b) {
+        double fc = centers[b];
+        unsigned lo = (unsigned)std::ceil(fc / half_band / bin_width);
+        unsigned hi = (unsigned)std::ceil(fc * half_band / bin_width);
+        lo = std::min(lo, max_bin);
+        hi = std::min(hi, max_bin + 1);
+        // narrow bands at low frequency take at least the nearest bin
+        if (lo >= hi) {
+            lo = std::min<unsigned>(std::lround(fc / bin_width), max_bin);
+            hi = lo + 1;
+        }
+        bin_lo_[b] = lo;
+        bin_hi_[b] = hi;
+    }
+
+    power_.assign(num_bands, 0.0);
+    num_blocks_ = 0;
+}
@@ -0,0 +1,36 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include "streamanalyzer.h"
+#include "utility/ring_buffer.h"
+#include <memory>
+
+//------------------------------------------------------------------------------
+// Real-time analyzer of the measurement input in fractional-octave bands.
+//
+// Band powers are computed from overlapped Hann blocks, averaged with a time
+// constant, and posted as `NotifyBandLevels` messages at the rate of the hop.
+class Band_Analyzer : public Stream_Analyzer {
+public:
+    Band_Analyzer(unsigned fft_size, unsigned hop_size, Ring_Buffer &rb_out);
+    ~Band_Analyzer();
+
+    void set_resolution(unsigned fraction); // 1/N octave
+    void set_time_constant(float seconds); // 0 = infinite average
+    unsigned resolution() const;
+    float time_constant() const;
+
+    // centers of 1/N octave bands within the analysis range
+    static unsigned band_centers(unsigned fraction, double *centers, unsigned max);
+
+protected:
+    void process_block(const float *const *block, unsigned size) override;
+    void reset() override;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> P;
+};
@@ -0,0 +1,329 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "controlserver.h"
+#include "measurement.h"
+#include "mainwindow.h"
+#include "analyzerdefs.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QtEndian>
+#include <vector>
+#include <algorithm>
+
+struct ControlServer::Impl {
+    ControlServer *self_ = nullptr;
+    QLocalServer *server_ = nullptr;
+
+    struct Loop {
+        Measurement *measurement;
+        MainWindow *window;
+    };
+    std::vector<Loop> loops_;
+
+    struct Client {
+        QLocalSocket *socket = nullptr;
+        QByteArray input;
+        bool subscribed = false;
+        unsigned long dropped = 0;
+    };
+    std::vector<std::unique_ptr<Client>> clients_;
+
+    enum {
+        max_frame_size = 64 * 1024,
+        max_pending_size = 256 * 1024,
+    };
+
+    void read_client(Client *client);
+    void remove_client(Client *client);
+    QJsonObject execute(Client &client, const QJsonObject &cmd);
+    bool configure(MainWindow &window, const QJsonObject &cmd, QString &error);
+    void publish(const QJsonObject &event);
+    static QByteArray frame(const QJsonObject &obj);
+    static const char *level_name(int spl);
+    static int mode_by_name(const QString &name);
+    static int window_by_name(const QString &name);
+};
+
+ControlServer::ControlServer(QObject *parent)
+    : QObject(parent), P(new Impl)
+{
+    P->self_ = this;
+
+    QLocalServer *server = P->server_ = new QLocalServer(this);
+    connect(server, &QLocalServer::newConnection, this, &ControlServer::acceptConnection);
+}
+
+ControlServer::~ControlServer()
+{
+}
+
+bool ControlServer::listen(const QString &name)
+{
+    // replace the socket left behind by an instance which crashed
+    QLocalServer::removeServer(name);
+    return P->server_->listen(name);
+}
+
+QString ControlServer::errorString() const
+{
+    return P->server_->errorString();
+}
+
+void ControlServer::addLoop(Measurement &measurement, MainWindow &window)
+{
+    // loops are numbered from 1, as the windows and ports are
+    int number = P->loops_.size() + 1;
+    P->loops_.push_back(Impl::Loop{&measurement, &window});
+
+    connect(
+        &measurement, &Measurement::pointMeasured,
+        this, [this, number](int spl, double frequency, double magnitude, double phase, double snr) {
+                  QJsonObject event;
+                  event["event"] = "point";
+                  event["loop"] = number;
+                  event["level"] = Impl::level_name(spl);
+                  event["frequency"] = frequency;
+                  event["magnitude"] = magnitude;
+                  event["phase"] = phase;
+                  // unknown until the noise floor is measured
+                  if (snr > 0) {
+                      event["snr"] = snr;
+                      event["uncertainty"] = Analysis::snr_uncertainty_db(snr);
+                  }
+                  P->publish(event);
+              });
+    connect(
+        &measurement, &Measurement::sweepCompleted,
+        this, [this, number](int spl) {
+                  QJsonObject event;
+                  event["event"] = "sweep";
+                  event["loop"] = number;
+                  event["level"] = Impl::level_name(spl);
+                  P->publish(event);
+              });
+}
+
+void ControlServer::acceptConnection()
+{
+    while (QLocalSocket *socket = P->server_->nextPendingConnection()) {
+        Impl::Client *client = new Impl::Client;
+        client->socket = socket;
+        P->clients_.emplace_back(client);
+
+        connect(socket, &QLocalSocket::readyRead,
+                this, [this, client]() { P->read_client(client); });
+        connect(socket, &QLocalSocket::disconnected,
+                this, [this, client]() { P->remove_client(client); });
+    }
+}
+
+void ControlServer::Impl::read_client(Client *client)
+{
+    QLocalSocket *socket = client->socket;
+    QByteArray &input = client->input;
+    input.append(socket->readAll());
+
+    while (input.size() >= 4) {
+        quint32 size = qFromBigEndian<quint32>((const uchar *)input.constData());
+        if (size > max_frame_size) {
+            // the client is lost, and it is removed upon disconnection
+            socket->abort();
+            return;
+        }
+        if ((quint32)input.size() < 4 + size)
+            break;
+
+        QJsonParseError error;
+        QJsonDocument doc = QJsonDocument::fromJson(input.mid(4, size), &error);
+        input.remove(0, 4 + size);
+
+        QJsonObject reply;
+        if (doc.isObject())
+            reply = execute(*client, doc.object());
+        else {
+            reply["ok"] = false;
+            reply["error"] = error.errorString();
+        }
+        socket->write(frame(reply));
+    }
+}
+
+void ControlServer::Impl::remove_client(Client *client)
+{
+    client->socket->deleteLater();
+
+    auto it = std::find_if(
+        clients_.begin(), clients_.end(),
+        [client](const std::unique_ptr<Client> &x) { return x.get() == client; });
+    if (it != clients_.end())
+        clients_.erase(it);
+}
+
+QJsonObject ControlServer::Impl::execute(Client &client, const QJsonObject &cmd)
+{
+    QJsonObject reply;
+    if (cmd.contains("id"))
+        reply["id"] = cmd["id"];
+
+    QString command = cmd["command"].toString();
+    int number = cmd["loop"].toInt(1);
+    QString error;
+
+    if (number < 1 || (unsigned)number > loops_.size())
+        error = "no such loop";
+    else if (command == "configure")
+        configure(*loops_[number - 1].window, cmd, error);
+    else if (command == "start")
+        loops_[number - 1].window->selectSweepActive(true);
+    else if (command == "stop")
+        loops_[number - 1].window->selectSweepActive(false);
+    else if (command == "restart")
+        loops_[number - 1].measurement->restartSweep();
+    else if (command == "subscribe")
+        client.subscribed = true;
+    else if (command == "unsubscribe")
+        client.subscribed = false;
+    else
+        error = "unknown command";
+
+    reply["ok"] = error.isEmpty();
+    if (!error.isEmpty())
+        reply["error"] = error;
+    return reply;
+}
+
+bool ControlServer::Impl::configure(MainWindow &window, const QJsonObject &cmd, QString &error)
+{
+    // check everything before applying anything
+    int mode = -1;
+    if (cmd.contains("mode")) {
+        mode = mode_by_name(cmd["mode"].toString());
+        if (mode == -1) {
+            error = "unknown mode";
+            return false;
+        }
+    }
+
+    int parallel = -1;
+    if (cmd.contains("parallel")) {
+        parallel = cmd["parallel"].toInt(-1);
+        if (parallel < 0 || parallel > Analysis::max_parallel) {
+            error = "invalid parallel count";
+            return false;
+        }
+    }
+
+    double uncertainty = -1;
+    if (cmd.contains("uncertainty")) {
+        uncertainty = cmd["uncertainty"].toDouble(-1);
+        if (!(uncertainty >= 0 && uncertainty <= Analysis::max_target_uncertainty)) {
+            error = "invalid uncertainty";
+            return false;
+        }
+    }
+
+    int analysis_window = -1;
+    if (cmd.contains("window")) {
+        analysis_window = window_by_name(cmd["window"].toString());
+        if (analysis_window == -1) {
+            error = "unknown window";
+            return false;
+        }
+    }
+
+    if (mode != -1 && !window.selectMode(mode)) {
+        error = "mode not available";
+        return false;
+    }
+
+    if (cmd.contains("levels")) {
+        QJsonArray levels = cmd["levels"].toArray();
+        window.selectLevels(levels.contains("lo"), levels.contains("hi"));
+    }
+    if (parallel != -1)
+        window.selectParallel(parallel);
+    if (cmd.contains("adaptive"))
+        window.selectAdaptive(cmd["adaptive"].toBool());
+    if (uncertainty != -1)
+        window.selectUncertainty(uncertainty);
+    if (analysis_window != -1)
+        window.selectWindow(analysis_window);
+    if (cmd.contains("gain"))
+        window.selectGain(cmd["gain"].toDouble());
+
+    return true;
+}
+
+void ControlServer::Impl::publish(const QJsonObject &event)
+{
+    QByteArray data;
+
+    for (const std::unique_ptr<Client> &client : clients_) {
+        if (!client->subscribed)
+            continue;
+
+        if (data.isEmpty())
+            data = frame(event);
+
+        // the socket only buffers, it is the client which is late
+        QLocalSocket *socket = client->socket;
+        if (socket->bytesToWrite() + data.size() > max_pending_size) {
+            ++client->dropped;
+            continue;
+        }
+
+        if (client->dropped > 0) {
+            QJsonObject notice;
+            notice["event"] = "dropped";
+            notice["count"] = (double)client->dropped;
+            socket->write(frame(notice));
+            client->dropped = 0;
+        }
+
+        socket->write(data);
+    }
+}
+
+QByteArray ControlServer::Impl::frame(const QJsonObject &obj)
+{
+    QByteArray json = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+    QByteArray data(4, 0);
+    qToBigEndian<quint32>(json.size(), (uchar *)data.data());
+    data.append(json);
+    return data;
+}
+
+const char *ControlServer::Impl::level_name(int spl)
+{
+    return (spl == Analysis::Signal_Hi) ? "hi" : "lo";
+}
+
+int ControlServer::Impl::mode_by_name(const QString &name)
+{
+    if (name == "sweep")
+        return Analysis::Mode_Sweep;
+    else if (name == "transfer")
+        return Analysis::Mode_Transfer;
+    else if (name == "rta")
+        return Analysis::Mode_Rta;
+    else if (name == "matrix")
+        return Analysis::Mode_Matrix;
+    return -1;
+}
+
+int ControlServer::Impl::window_by_name(const QString &name)
+{
+    if (name == "hann")
+        return Analysis::Window_Hann;
+    else if (name == "flattop")
+        return Analysis::Window_Flat_Top;
+    else if (name == "blackman-harris")
+        return Analysis::Window_Blackman_Harris;
+    return -1;
+}
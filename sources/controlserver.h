@@ -0,0 +1,38 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <QObject>
+#include <memory>
+class Measurement;
+class MainWindow;
+
+//------------------------------------------------------------------------------
+// Control of the analyzer by other programs, on a local socket.
+//
+// A frame is a JSON object, preceded by its size as a 32-bit big-endian
+// integer. Each command gets a reply, and the subscribers get the results
+// as they arrive. The measurement never waits for a client: the results
+// which would overflow the send buffer of a slow client are dropped, and
+// the client is told how many were.
+class ControlServer : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ControlServer(QObject *parent = nullptr);
+    ~ControlServer();
+
+    bool listen(const QString &name);
+    QString errorString() const;
+
+    void addLoop(Measurement &measurement, MainWindow &window);
+
+private slots:
+    void acceptConnection();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> P;
+};
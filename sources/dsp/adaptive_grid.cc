@@ -0,0 +1,94 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "adaptive_grid.h"
+#include <algorithm>
+#include <vector>
+#include <cmath>
+typedef std::complex<double> cdouble;
+
+unsigned refine_grid(
+    const double *freqs, const std::complex<float> *response, const bool *valid, unsigned n,
+    const Grid_Refinement &params, double *added, unsigned max_added)
+{
+    // the valid points, as log-frequency and log-response
+    std::vector<unsigned> index;
+    std::vector<double> x;
+    std::vector<cdouble> y;
+    index.reserve(n);
+    x.reserve(n);
+    y.reserve(n);
+
+    double offset = 0;
+    double last = 0;
+    for (unsigned i = 0; i < n; ++i) {
+        if (!valid[i])
+            continue;
+        cdouble h = response[i];
+        double p = std::arg(h);
+        if (!index.empty())
+            offset -= 2 * M_PI * std::round((p - last) / (2 * M_PI));
+        last = p;
+        index.push_back(i);
+        x.push_back(std::log(freqs[i]));
+        y.push_back(cdouble(std::log(std::abs(h) + 1e-20), p + offset));
+    }
+
+    const unsigned m = (unsigned)index.size();
+    if (m < 2 || max_added == 0)
+        return 0;
+
+    // second divided difference around the middle point of a triple
+    auto curvature = [&x, &y](unsigned j) -> double {
+        double dx1 = x[j] - x[j - 1];
+        double dx2 = x[j + 1] - x[j];
+        double dx = x[j + 1] - x[j - 1];
+        if (dx1 <= 0 || dx2 <= 0)
+            return 0;
+        cdouble s1 = (y[j] - y[j - 1]) / dx1;
+        cdouble s2 = (y[j + 1] - y[j]) / dx2;
+        return std::abs(2.0 * (s2 - s1) / dx);
+    };
+
+    const double tolerance = params.tolerance_db * (std::log(10.0) / 20);
+
+    struct Candidate {
+        double score;
+        double freq;
+    };
+    std::vector<Candidate> candidates;
+
+    for (unsigned j = 0; j + 1 < m; ++j) {
+        double f1 = freqs[index[j]];
+        double f2 = freqs[index[j + 1]];
+        if (f2 - f1 < 2 * params.min_spacing)
+            continue;
+
+        double h = x[j + 1] - x[j];
+        double c = 0;
+        if (j > 0)
+            c = std::max(c, curvature(j));
+        if (j + 2 < m)
+            c = std::max(c, curvature(j + 1));
+        double error = c * h * h / 8;
+
+        double phase_step = std::abs(y[j + 1].imag() - y[j].imag());
+        if (phase_step > params.max_phase_step)
+            error = std::max(error, tolerance * phase_step / params.max_phase_step);
+
+        if (error > tolerance)
+            candidates.push_back(Candidate{error, std::sqrt(f1 * f2)});
+    }
+
+    unsigned k = std::min<unsigned>(candidates.size(), max_added);
+    std::partial_sort(
+        candidates.begin(), candidates.begin() + k, candidates.end(),
+        [](const Candidate &a, const Candidate &b) { return a.score > b.score; });
+
+    for (unsigned i = 0; i < k; ++i)
+        added[i] = candidates[i].freq;
+    std::sort(added, added + k);
+    return k;
+}
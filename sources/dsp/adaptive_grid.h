@@ -0,0 +1,47 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <complex>
+#include <cmath>
+
+//------------------------------------------------------------------------------
+// Refinement of a sorted frequency grid where the response changes quickly.
+//
+// The response is handled as ln|H| + j·φ over the log-frequency, where the
+// error of linear interpolation on an interval is estimated as c·h²/8 from
+// the curvature c of the neighboring triples. Intervals are split at their
+// geometric middle when this error exceeds the tolerance, or when the phase
+// turns by more than the maximal step. Intervals narrower than twice the
+// minimal spacing are kept, and the worst intervals are split first.
+// The new frequencies are returned in increasing order.
+struct Grid_Refinement {
+    double tolerance_db = 0.5;
+    double max_phase_step = M_PI / 4;
+    double min_spacing = 0;
+};
+
+unsigned refine_grid(
+    const double *freqs, const std::complex<float> *response, const bool *valid, unsigned n,
+    const Grid_Refinement &params, double *added, unsigned max_added);
+
+//------------------------------------------------------------------------------
+// Merge of sorted new values into a sorted array which has room for them,
+// from the back, in linear time. The function `move(from, to)` relocates the
+// element at `from` to `to`, and `insert(to, index)` places the new value of
+// given index at `to`. It returns the count of leading elements left in place.
+template <class Move, class Insert>
+unsigned merge_grid(const double *freqs, unsigned n, const double *added, unsigned k,
+                Move &&move, Insert &&insert)
+{
+    unsigned i = n, j = k, w = n + k;
+    while (j > 0) {
+        if (i > 0 && freqs[i - 1] > added[j - 1])
+            move(--i, --w);
+        else
+            insert(--w, --j);
+    }
+    return i;
+}
@@ -0,0 +1,522 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "eq_fit.h"
+#include "kernels.h"
+#include "workerpool.h"
+#include "fftplan.h"
+#include "utility/nextpow2.h"
+#include <fftw3.h>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <complex>
+#include <cmath>
+
+// the fit works in log2 of the power gain, which the kernel computes
+static const double db_per_unit = 3.0102999566398120;  // 10·log10(2)
+
+namespace {
+
+// the iterations of a loop which a worker shares with the caller, with its
+// own slot of scratch memory
+struct Loop_Worker : Worker_Task {
+    std::atomic<unsigned> *next = nullptr;
+    std::atomic<unsigned> *done = nullptr;
+    unsigned count = 0;
+    unsigned slot = 0;
+    const std::function<void(unsigned, unsigned)> *fn = nullptr;
+
+    bool service() override
+    {
+        unsigned i = (*next)++;
+        if (i >= count)
+            return false;
+        (*fn)(i, slot);
+        ++*done;
+        return true;
+    }
+};
+
+class Eq_Fitter {
+public:
+    Eq_Fitter(const Eq_Fit_Params &params);
+    bool set_points(const double *freqs, const double *response_db, const bool *valid, const double *target_db, unsigned n);
+    bool add_section();
+    void adjust();
+    Eq_Fit result() const;
+
+private:
+    typedef std::vector<float> Curve;
+
+    void parallel(unsigned count, const std::function<void(unsigned, unsigned)> &fn);
+    void evaluate(const Eq_Section &section, const float *base, float *out) const;
+    double error(const float *model) const;
+    double evaluate_all(const std::vector<Eq_Section> &sections, std::vector<Curve> &curves, Curve &model);
+    void clamp(Eq_Section &section) const;
+
+private:
+    Eq_Fit_Params params_;
+    const Dsp_Kernels &kernels_;
+    unsigned slots_ = 1;
+    std::vector<Loop_Worker> workers_;
+
+    // the points in the range, with the correction, as log2 of power
+    unsigned m_ = 0;
+    std::vector<double> freqs_;
+    std::vector<double> weights_;
+    Curve phi_;
+    Curve target_;
+    double gain_ = 0;
+
+    std::vector<Eq_Section> sections_;
+    std::vector<Curve> curves_;
+    Curve model_;
+    Curve zero_;
+    std::vector<Curve> scratch_;
+};
+
+Eq_Fitter::Eq_Fitter(const Eq_Fit_Params &params)
+    : params_(params), kernels_(dsp_kernels())
+{
+    slots_ = params.threads ? params.threads : Worker_Pool::instance().thread_count();
+    slots_ = std::max(1u, slots_);
+    workers_.resize(slots_ - 1);
+    scratch_.resize(slots_);
+}
+
+bool Eq_Fitter::set_points(const double *freqs, const double *response_db, const bool *valid, const double *target_db, unsigned n)
+{
+    const double fs = params_.sample_rate;
+    const double fmax = std::min(params_.max_frequency, 0.49 * fs);
+    std::vector<double> correction;
+    for (unsigned i = 0; i < n; ++i) {
+        double f = freqs[i];
+        if (!valid[i] || f < params_.min_frequency || f > fmax)
+            continue;
+        freqs_.push_back(f);
+        correction.push_back((target_db ? target_db[i] : 0.0) - response_db[i]);
+    }
+
+    const unsigned m = m_ = (unsigned)freqs_.size();
+    if (m < 2)
+        return false;
+
+    // the half of the log-frequency interval on either side
+    weights_.resize(m);
+    double sum = 0;
+    for (unsigned i = 0; i < m; ++i) {
+        double lo = std::log(freqs_[i > 0 ? i - 1 : i]);
+        double hi = std::log(freqs_[i + 1 < m ? i + 1 : i]);
+        sum += weights_[i] = 0.5 * (hi - lo);
+    }
+    for (double &w : weights_)
+        w /= sum;
+
+    // the average of the limited correction, which settles in a few passes
+    // if the limits cut the deep notches
+    double gain = 0;
+    for (unsigned pass = 0; pass < 4; ++pass) {
+        double mean = 0;
+        for (unsigned i = 0; i < m; ++i)
+            mean += weights_[i] * std::max(-params_.max_cut_db, std::min(params_.max_boost_db, correction[i] - gain));
+        gain += mean;
+    }
+    gain_ = gain / db_per_unit;
+
+    phi_.resize(m);
+    target_.resize(m);
+    for (unsigned i = 0; i < m; ++i) {
+        double s = std::sin(M_PI * freqs_[i] / fs);
+        phi_[i] = (float)(s * s);
+        double c = std::max(-params_.max_cut_db, std::min(params_.max_boost_db, correction[i] - gain));
+        target_[i] = (float)(c / db_per_unit);
+    }
+
+    model_.assign(m, 0);
+    zero_.assign(m, 0);
+    for (Curve &scratch : scratch_)
+        scratch.resize(m);
+    return true;
+}
+
+void Eq_Fitter::parallel(unsigned count, const std::function<void(unsigned, unsigned)> &fn)
+{
+    std::atomic<unsigned> next(0);
+    std::atomic<unsigned> done(0);
+
+    Worker_Pool &pool = Worker_Pool::instance();
+    for (unsigned s = 1; s < slots_ && s < count; ++s) {
+        Loop_Worker &worker = workers_[s - 1];
+        worker.next = &next;
+        worker.done = &done;
+        worker.count = count;
+        worker.slot = s;
+        worker.fn = &fn;
+        pool.attach(&worker);
+    }
+
+    for (unsigned i; (i = next++) < count;) {
+        fn(i, 0);
+        ++done;
+    }
+    while (done < count)
+        std::this_thread::yield();
+
+    for (unsigned s = 1; s < slots_ && s < count; ++s)
+        pool.detach(&workers_[s - 1]);
+}
+
+void Eq_Fitter::evaluate(const Eq_Section &section, const float *base, float *out) const
+{
+    // the gain A⁴ at the center, with α² of the bandwidth
+    double w0 = 2 * M_PI * section.frequency / params_.sample_rate;
+    double alpha = std::sin(w0) / (2 * section.q);
+    double a2 = std::pow(10.0, section.gain_db / 20);
+    double center = std::sin(0.5 * w0);
+    center *= center;
+    kernels_.peaking_gain(
+        out, base, phi_.data(), m_,
+        (float)center, (float)(alpha * alpha * a2), (float)(alpha * alpha / a2));
+}
+
+double Eq_Fitter::error(const float *model) const
+{
+    double sum = 0;
+    for (unsigned i = 0; i < m_; ++i) {
+        double e = model[i] - target_[i];
+        sum += weights_[i] * e * e;
+    }
+    return sum;
+}
+
+double Eq_Fitter::evaluate_all(const std::vector<Eq_Section> &sections, std::vector<Curve> &curves, Curve &model)
+{
+    const unsigned k = (unsigned)sections.size();
+    curves.resize(k);
+    parallel(k, [&](unsigned s, unsigned) {
+        curves[s].resize(m_);
+        evaluate(sections[s], zero_.data(), curves[s].data());
+    });
+
+    model.assign(m_, 0);
+    for (const Curve &curve : curves) {
+        for (unsigned i = 0; i < m_; ++i)
+            model[i] += curve[i];
+    }
+    return error(model.data());
+}
+
+void Eq_Fitter::clamp(Eq_Section &section) const
+{
+    const double fmax = std::min(params_.max_frequency, 0.49 * params_.sample_rate);
+    section.frequency = std::max(params_.min_frequency, std::min(fmax, section.frequency));
+    section.gain_db = std::max(-params_.max_cut_db, std::min(params_.max_boost_db, section.gain_db));
+    section.q = std::max(params_.min_q, std::min(params_.max_q, section.q));
+}
+
+bool Eq_Fitter::add_section()
+{
+    const unsigned m = m_;
+    const double fmax = std::min(params_.max_frequency, 0.49 * params_.sample_rate);
+    const double current = error(model_.data());
+
+    // the candidates by twelfths of octave, and Q in geometric steps
+    enum { num_q = 10 };
+    std::vector<Eq_Section> candidates;
+    for (double f = params_.min_frequency; f <= fmax; f *= std::pow(2.0, 1.0 / 12)) {
+        // the gain which fills the error at the center
+        unsigned i = (unsigned)(std::lower_bound(freqs_.begin(), freqs_.end(), f) - freqs_.begin());
+        i = std::min(i, m - 1);
+        Eq_Section section;
+        section.frequency = f;
+        section.gain_db = (target_[i] - model_[i]) * db_per_unit;
+        for (unsigned j = 0; j < num_q; ++j) {
+            section.q = params_.min_q * std::pow(params_.max_q / params_.min_q, j / (num_q - 1.0));
+            clamp(section);
+            candidates.push_back(section);
+        }
+    }
+
+    const unsigned count = (unsigned)candidates.size();
+    if (count == 0)
+        return false;
+    std::vector<double> errors(count);
+    parallel(count, [&](unsigned c, unsigned slot) {
+        float *out = scratch_[slot].data();
+        evaluate(candidates[c], model_.data(), out);
+        errors[c] = error(out);
+    });
+
+    unsigned best = (unsigned)(std::min_element(errors.begin(), errors.end()) - errors.begin());
+    if (!(errors[best] < current * (1 - 1e-4)))
+        return false;
+
+    Curve curve(m);
+    evaluate(candidates[best], zero_.data(), curve.data());
+    for (unsigned i = 0; i < m; ++i)
+        model_[i] += curve[i];
+    sections_.push_back(candidates[best]);
+    curves_.push_back(std::move(curve));
+    return true;
+}
+
+// solves A·x = b in place for a symmetric positive definite A, or returns false
+static bool solve_cholesky(std::vector<double> &a, std::vector<double> &b, unsigned n)
+{
+    for (unsigned j = 0; j < n; ++j) {
+        double d = a[j * n + j];
+        for (unsigned k = 0; k < j; ++k)
+            d -= a[j * n + k] * a[j * n + k];
+        if (!(d > 0))
+            return false;
+        d = a[j * n + j] = std::sqrt(d);
+        for (unsigned i = j + 1; i < n; ++i) {
+            double s = a[i * n + j];
+            for (unsigned k = 0; k < j; ++k)
+                s -= a[i * n + k] * a[j * n + k];
+            a[i * n + j] = s / d;
+        }
+    }
+    for (unsigned i = 0; i < n; ++i) {
+        double s = b[i];
+        for (unsigned k = 0; k < i; ++k)
+            s -= a[i * n + k] * b[k];
+        b[i] = s / a[i * n + i];
+    }
+    for (unsigned i = n; i-- > 0;) {
+        double s = b[i];
+        for (unsigned k = i + 1; k < n; ++k)
+            s -= a[k * n + i] * b[k];
+        b[i] = s / a[i * n + i];
+    }
+    return true;
+}
+
+void Eq_Fitter::adjust()
+{
+    const unsigned m = m_;
+    const unsigned k = (unsigned)sections_.size();
+    const unsigned np = 3 * k;
+    if (k == 0)
+        return;
+
+    // the parameters are the log-frequency, the gain and the log-Q
+    const double steps[3] = {1e-3, 1e-2, 1e-3};
+    std::vector<Curve> jacobian(np, Curve(m));
+    std::vector<double> a(np * np), b(np), x(np);
+    std::vector<Eq_Section> trial;
+    std::vector<Curve> trial_curves;
+    Curve trial_model;
+
+    double current = error(model_.data());
+    double lambda = 1e-3;
+
+    for (unsigned iter = 0; iter < params_.iterations; ++iter) {
+        // the columns as differences of the section, on its own curve
+        parallel(np, [&](unsigned p, unsigned slot) {
+            Eq_Section section = sections_[p / 3];
+            double h = steps[p % 3];
+            switch (p % 3) {
+            case 0: section.frequency *= std::exp(h); break;
+            case 1: section.gain_db += h; break;
+            case 2: section.q *= std::exp(h); break;
+            }
+            float *neg = scratch_[slot].data();
+            const float *curve = curves_[p / 3].data();
+            for (unsigned i = 0; i < m; ++i)
+                neg[i] = -curve[i];
+            float *column = jacobian[p].data();
+            evaluate(section, neg, column);
+            for (unsigned i = 0; i < m; ++i)
+                column[i] = (float)(column[i] / h);
+        });
+
+        // the normal equations, by rows
+        parallel(np, [&](unsigned r, unsigned) {
+            const float *jr = jacobian[r].data();
+            for (unsigned c = r; c < np; ++c) {
+                const float *jc = jacobian[c].data();
+                double sum = 0;
+                for (unsigned i = 0; i < m; ++i)
+                    sum += weights_[i] * jr[i] * jc[i];
+                a[r * np + c] = a[c * np + r] = sum;
+            }
+            double sum = 0;
+            for (unsigned i = 0; i < m; ++i)
+                sum += weights_[i] * jr[i] * (target_[i] - model_[i]);
+            b[r] = sum;
+        });
+
+        bool improved = false;
+        while (!improved && lambda < 1e8) {
+            std::vector<double> damped = a;
+            x = b;
+            for (unsigned p = 0; p < np; ++p)
+                damped[p * np + p] += lambda * a[p * np + p] + 1e-12;
+            if (!solve_cholesky(damped, x, np)) {
+                lambda *= 10;
+                continue;
+            }
+
+            trial = sections_;
+            for (unsigned s = 0; s < k; ++s) {
+                trial[s].frequency *= std::exp(x[3 * s]);
+                trial[s].gain_db += x[3 * s + 1];
+                trial[s].q *= std::exp(x[3 * s + 2]);
+                clamp(trial[s]);
+            }
+
+            double e = evaluate_all(trial, trial_curves, trial_model);
+            if (e < current) {
+                improved = true;
+                bool converged = e > current * (1 - 1e-6);
+                sections_.swap(trial);
+                curves_.swap(trial_curves);
+                model_.swap(trial_model);
+                current = e;
+                lambda = std::max(lambda / 3, 1e-9);
+                if (converged)
+                    return;
+            }
+            else
+                lambda *= 4;
+        }
+        if (!improved)
+            return;
+    }
+}
+
+Eq_Fit Eq_Fitter::result() const
+{
+    Eq_Fit fit;
+    fit.gain_db = gain_ * db_per_unit;
+    for (const Eq_Section &section : sections_) {
+        if (std::fabs(section.gain_db) >= 0.05)
+            fit.sections.push_back(section);
+    }
+    std::sort(fit.sections.begin(), fit.sections.end(),
+              [](const Eq_Section &a, const Eq_Section &b) { return a.frequency < b.frequency; });
+
+    fit.error_db = m_ ? (std::sqrt(error(model_.data())) * db_per_unit) : 0;
+    fit.frequencies = freqs_;
+    fit.correction_db.resize(m_);
+    for (unsigned i = 0; i < m_; ++i)
+        fit.correction_db[i] = (target_[i] + gain_) * db_per_unit;
+    return fit;
+}
+
+}  // namespace
+
+Eq_Fit fit_eq(
+    const double *freqs, const double *response_db, const bool *valid, const double *target_db,
+    unsigned n, const Eq_Fit_Params &params)
+{
+    Eq_Fitter fitter(params);
+    if (fitter.set_points(freqs, response_db, valid, target_db, n)) {
+        for (unsigned s = 0; s < params.sections && fitter.add_section(); ++s)
+            ;
+        fitter.adjust();
+    }
+    return fitter.result();
+}
+
+void eq_section_coefficients(const Eq_Section &section, double sample_rate, double coefs[5])
+{
+    double w0 = 2 * M_PI * section.frequency / sample_rate;
+    double alpha = std::sin(w0) / (2 * section.q);
+    double a = std::pow(10.0, section.gain_db / 40);
+    double c = std::cos(w0);
+    double a0 = 1 + alpha / a;
+    coefs[0] = (1 + alpha * a) / a0;
+    coefs[1] = -2 * c / a0;
+    coefs[2] = (1 - alpha * a) / a0;
+    coefs[3] = -2 * c / a0;
+    coefs[4] = (1 - alpha / a) / a0;
+}
+
+double eq_section_gain_db(const Eq_Section &section, double sample_rate, double frequency)
+{
+    double coefs[5];
+    eq_section_coefficients(section, sample_rate, coefs);
+    std::complex<double> z = std::polar(1.0, -2 * M_PI * frequency / sample_rate);
+    std::complex<double> num = coefs[0] + z * (coefs[1] + z * coefs[2]);
+    std::complex<double> den = 1.0 + z * (coefs[3] + z * coefs[4]);
+    return 20 * std::log10(std::abs(num / den));
+}
+
+void design_min_phase_fir(
+    const double *freqs, const double *correction_db, unsigned n,
+    double sample_rate, float *taps, unsigned num_taps)
+{
+    typedef std::complex<float> cfloat;
+    struct Fftwf_Deleter {
+        void operator()(void *x) { fftwf_free(x); }
+    };
+
+    // long enough that the cepstrum does not alias much
+    const unsigned size = std::max(1024u, nextpow2(8 * num_taps));
+    const unsigned bins = size / 2 + 1;
+    std::unique_ptr<float[], Fftwf_Deleter> real(fftwf_alloc_real(size));
+    std::unique_ptr<cfloat[], Fftwf_Deleter> cplx((cfloat *)fftwf_alloc_complex(bins));
+    if (!real || !cplx)
+        throw std::bad_alloc();
+
+    Fft_Plan forward = Fft_Plan_Cache::instance().get(size, Fft_Type::Real_Forward);
+    Fft_Plan backward = Fft_Plan_Cache::instance().get(size, Fft_Type::Real_Backward);
+
+    std::vector<double> bin_freqs(bins), mags(bins);
+    for (unsigned k = 0; k < bins; ++k)
+        bin_freqs[k] = k * sample_rate / size;
+    resample_curve(freqs, correction_db, n, bin_freqs.data(), mags.data(), bins);
+
+    // the real cepstrum, folded onto the positive quefrencies
+    for (unsigned k = 0; k < bins; ++k)
+        cplx[k] = (float)(mags[k] * (M_LN10 / 20));
+    backward.execute(cplx.get(), real.get());
+    const float scale = 1.0f / size;
+    real[0] *= scale;
+    for (unsigned i = 1; i < size / 2; ++i)
+        real[i] *= 2 * scale;
+    real[size / 2] *= scale;
+    std::fill(&real[size / 2 + 1], &real[size], 0.0f);
+
+    forward.execute(real.get(), cplx.get());
+    for (unsigned k = 0; k < bins; ++k)
+        cplx[k] = std::exp(cplx[k]);
+    backward.execute(cplx.get(), real.get());
+
+    // the end of the response fades out over the last eighth
+    const unsigned fade = std::max(1u, num_taps / 8);
+    for (unsigned i = 0; i < num_taps; ++i) {
+        float h = (i < size) ? real[i] * scale : 0.0f;
+        if (i + fade >= num_taps)
+            h *= (float)(0.5 + 0.5 * std::cos(M_PI * (i + fade - num_taps + 1) / fade));
+        taps[i] = h;
+    }
+}
+
+void resample_curve(
+    const double *curve_freqs, const double *curve_values, unsigned curve_n,
+    const double *freqs, double *values, unsigned n)
+{
+    for (unsigned i = 0; i < n; ++i) {
+        double f = freqs[i];
+        if (curve_n == 0)
+            values[i] = 0;
+        else if (f <= curve_freqs[0])
+            values[i] = curve_values[0];
+        else if (f >= curve_freqs[curve_n - 1])
+            values[i] = curve_values[curve_n - 1];
+        else {
+            unsigned j = (unsigned)(std::upper_bound(curve_freqs, curve_freqs + curve_n, f) - curve_freqs);
+            double x0 = std::log(curve_freqs[j - 1]), x1 = std::log(curve_freqs[j]);
+            double mu = (x1 > x0) ? (std::log(f) - x0) / (x1 - x0) : 0;
+            values[i] = curve_values[j - 1] + mu * (curve_values[j] - curve_values[j - 1]);
+        }
+    }
+}
@@ -0,0 +1,72 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <vector>
+
+//------------------------------------------------------------------------------
+// Fit of peaking biquads which bring a measured response to a target curve.
+//
+// The correction is the target minus the response in dB, over the range of
+// the fit, limited to the maximal boost and cut, and less its average, which
+// becomes the gain. The sections are placed one at a time where they reduce
+// the error the most, among candidates of frequency and Q which are evaluated
+// in parallel, and then all of them are adjusted together by the method of
+// Levenberg-Marquardt. The error is weighted by the spacing of the points in
+// log-frequency, so that a region of dense points does not count more.
+struct Eq_Section {
+    double frequency = 1000;
+    double gain_db = 0;
+    double q = 1;
+};
+
+struct Eq_Fit_Params {
+    unsigned sections = 10;
+    double sample_rate = 48000;
+    double min_frequency = 20;
+    double max_frequency = 20000;
+    double max_boost_db = 6;
+    double max_cut_db = 24;
+    double min_q = 0.2;
+    double max_q = 12;
+    unsigned iterations = 50;
+    // 0 for the count of the processor
+    unsigned threads = 0;
+};
+
+struct Eq_Fit {
+    std::vector<Eq_Section> sections;
+    double gain_db = 0;
+    // the weighted rms of the correction which the sections miss
+    double error_db = 0;
+    // the correction over the range of the fit, gain included
+    std::vector<double> frequencies;
+    std::vector<double> correction_db;
+};
+
+// the target is null for a flat one, and the invalid points are ignored
+Eq_Fit fit_eq(
+    const double *freqs, const double *response_db, const bool *valid, const double *target_db,
+    unsigned n, const Eq_Fit_Params &params);
+
+// the coefficients b0 b1 b2 a1 a2 of a section, for a0 = 1
+void eq_section_coefficients(const Eq_Section &section, double sample_rate, double coefs[5]);
+// the gain of a section in dB at a frequency
+double eq_section_gain_db(const Eq_Section &section, double sample_rate, double frequency);
+
+//------------------------------------------------------------------------------
+// The minimum phase FIR filter whose magnitude follows a correction given on a
+// sorted grid, interpolated in log-frequency and held beyond the ends. The
+// phase comes from the folded real cepstrum of the log-magnitude.
+void design_min_phase_fir(
+    const double *freqs, const double *correction_db, unsigned n,
+    double sample_rate, float *taps, unsigned num_taps);
+
+//------------------------------------------------------------------------------
+// Values of a curve on a sorted grid, at other frequencies, interpolated in
+// log-frequency and held beyond the ends.
+void resample_curve(
+    const double *curve_freqs, const double *curve_values, unsigned curve_n,
+    const double *freqs, double *values, unsigned n);
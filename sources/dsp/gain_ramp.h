@@ -0,0 +1,63 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+template <class R>
+struct Gain_Ramp
+{
+    R gain_ = 0;
+    R target_ = 0;
+    R step_ = 0;
+    unsigned left_ = 0;
+    unsigned length_ = 1;
+    void length(unsigned n); // n = fs * ramp time
+    void jump(R g);
+    void target(R g);
+    void skip(unsigned n);
+    bool active() const { return left_ > 0; }
+    R current() const { return gain_; }
+    R process();
+};
+
+template <class R>
+void Gain_Ramp<R>::length(unsigned n)
+{
+    length_ = (n > 0) ? n : 1;
+}
+
+template <class R>
+void Gain_Ramp<R>::jump(R g)
+{
+    gain_ = target_ = g;
+    left_ = 0;
+}
+
+template <class R>
+void Gain_Ramp<R>::target(R g)
+{
+    target_ = g;
+    step_ = (g - gain_) / length_;
+    left_ = length_;
+}
+
+template <class R>
+void Gain_Ramp<R>::skip(unsigned n)
+{
+    if (n >= left_)
+        jump(target_);
+    else {
+        gain_ += n * step_;
+        left_ -= n;
+    }
+}
+
+template <class R>
+R Gain_Ramp<R>::process()
+{
+    if (left_ > 0)
+        gain_ = (--left_ > 0) ? (gain_ + step_) : target_;
+    return gain_;
+}
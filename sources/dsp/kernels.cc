@@ -0,0 +1,76 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "kernels_impl.h"
+#include <cstdlib>
+#include <cstring>
+
+const Dsp_Kernels scalar_kernels = {
+    "scalar",
+    &Kernels::oscillator,
+    &Kernels::multiply,
+    &Kernels::peak_envelope,
+    &Kernels::power,
+    &Kernels::cross_spectrum,
+    &Kernels::peaking_gain,
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+static bool supported(const Dsp_Kernels &kernels)
+{
+    __builtin_cpu_init();
+    if (&kernels == &sse2_kernels)
+        return __builtin_cpu_supports("sse2");
+    if (&kernels == &avx2_kernels)
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    if (&kernels == &avx512_kernels)
+        return __builtin_cpu_supports("avx512f");
+    return true;
+}
+
+static const Dsp_Kernels *const all_kernels[] = {
+    &scalar_kernels, &sse2_kernels, &avx2_kernels, &avx512_kernels,
+};
+#else
+static bool supported(const Dsp_Kernels &)
+{
+    return true;
+}
+
+static const Dsp_Kernels *const all_kernels[] = {
+    &scalar_kernels,
+};
+#endif
+
+std::vector<const Dsp_Kernels *> supported_dsp_kernels()
+{
+    std::vector<const Dsp_Kernels *> list;
+    for (const Dsp_Kernels *kernels : all_kernels) {
+        if (supported(*kernels))
+            list.push_back(kernels);
+    }
+    return list;
+}
+
+static const Dsp_Kernels &select_dsp_kernels()
+{
+    std::vector<const Dsp_Kernels *> list = supported_dsp_kernels();
+
+    const char *name = getenv("SP_KERNELS");
+    if (name && name[0]) {
+        for (const Dsp_Kernels *kernels : list) {
+            if (!strcmp(kernels->name, name))
+                return *kernels;
+        }
+    }
+
+    return *list.back();
+}
+
+const Dsp_Kernels &dsp_kernels()
+{
+    static const Dsp_Kernels &kernels = select_dsp_kernels();
+    return kernels;
+}
@@ -0,0 +1,61 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <complex>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+//------------------------------------------------------------------------------
+// The inner loops of the processing, in variants for the instruction sets of
+// x86, of which the best one which the processor supports is chosen at the
+// first call. The variants agree within the rounding of their arithmetic.
+struct Dsp_Kernels {
+    typedef std::complex<float> cfloat;
+    typedef std::complex<double> cdouble;
+
+    const char *name;
+
+    // adds a cosine of amplitude `amp`, whose phase counts in 1/2^32 turns
+    void (*oscillator)(float *out, unsigned n, uint32_t *phase, uint32_t increment, float amp);
+
+    void (*multiply)(float *out, const float *a, const float *b, unsigned n);
+
+    // the envelope max(|x|, decay·previous) at the end of the block
+    float (*peak_envelope)(const float *in, unsigned n, float decay, float level);
+
+    // |z|² of each bin
+    void (*power)(float *out, const cfloat *in, unsigned n);
+
+    // exponential average of the auto and cross spectra of x and y
+    void (*cross_spectrum)(double *gxx, double *gyy, cdouble *gxy,
+                           const cfloat *x, const cfloat *y, unsigned n, double alpha);
+
+    // the base plus the log2 of the power gain of a peaking biquad at
+    // φ = sin²(ω/2), which is ((φ-φc)² + num·φ(1-φ)) / ((φ-φc)² + den·φ(1-φ))
+    // with φc at its center, a form whose terms are all positive
+    void (*peaking_gain)(float *out, const float *base, const float *phi, unsigned n,
+                         float center, float num, float den);
+};
+
+// the kernels in use, by default the fastest supported, or those named by the
+// environment variable SP_KERNELS if supported
+const Dsp_Kernels &dsp_kernels();
+
+// all the variants which this processor supports, the scalar one first
+std::vector<const Dsp_Kernels *> supported_dsp_kernels();
+
+// the phase increment of a frequency relative to the sample rate
+inline uint32_t phase_increment(double frequency)
+{
+    double turns = frequency - std::floor(frequency);
+    return (uint32_t)(uint64_t)std::llround(turns * 4294967296.0);
+}
+
+inline float phase_turns(uint32_t phase)
+{
+    return (float)(phase * (1.0 / 4294967296.0));
+}
@@ -0,0 +1,187 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#if defined(__x86_64__) || defined(__i386__)
+#include "kernels_impl.h"
+#include <immintrin.h>
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+
+namespace Kernels {
+namespace AVX2 {
+
+static inline __m256 cos_turns(__m256i phase)
+{
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 x = _mm256_andnot_ps(sign, _mm256_mul_ps(_mm256_cvtepi32_ps(phase), _mm256_set1_ps(phase_scale)));
+    __m256 back = _mm256_cmp_ps(x, _mm256_set1_ps(0.25f), _CMP_GT_OQ);
+    __m256 b = _mm256_blendv_ps(x, _mm256_sub_ps(_mm256_set1_ps(0.5f), x), back);
+    __m256 y = _mm256_mul_ps(b, b);
+    __m256 c = _mm256_set1_ps(cos_c6);
+    c = _mm256_fmadd_ps(c, y, _mm256_set1_ps(cos_c5));
+    c = _mm256_fmadd_ps(c, y, _mm256_set1_ps(cos_c4));
+    c = _mm256_fmadd_ps(c, y, _mm256_set1_ps(cos_c3));
+    c = _mm256_fmadd_ps(c, y, _mm256_set1_ps(cos_c2));
+    c = _mm256_fmadd_ps(c, y, _mm256_set1_ps(cos_c1));
+    c = _mm256_fmadd_ps(c, y, _mm256_set1_ps(cos_c0));
+    return _mm256_xor_ps(c, _mm256_and_ps(back, sign));
+}
+
+static void oscillator(float *out, unsigned n, uint32_t *phase, uint32_t increment, float amp)
+{
+    uint32_t p = *phase;
+    const __m256 g = _mm256_set1_ps(amp);
+    const __m256i step = _mm256_set1_epi32((int32_t)(8 * increment));
+    __m256i pv = _mm256_add_epi32(
+        _mm256_set1_epi32((int32_t)p),
+        _mm256_mullo_epi32(_mm256_set1_epi32((int32_t)increment), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 c = cos_turns(pv);
+        _mm256_storeu_ps(&out[i], _mm256_fmadd_ps(g, c, _mm256_loadu_ps(&out[i])));
+        pv = _mm256_add_epi32(pv, step);
+    }
+
+    p += i * increment;
+    Kernels::oscillator(&out[i], n - i, &p, increment, amp);
+    *phase = p;
+}
+
+static void multiply(float *out, const float *a, const float *b, unsigned n)
+{
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(&out[i], _mm256_mul_ps(_mm256_loadu_ps(&a[i]), _mm256_loadu_ps(&b[i])));
+    Kernels::multiply(&out[i], &a[i], &b[i], n - i);
+}
+
+static float peak_envelope(const float *in, unsigned n, float decay, float level)
+{
+    const unsigned m = n & ~7u;
+    float w = 1;
+    float peak = peak_envelope_tail(&in[m], n - m, decay, &w);
+
+    alignas(32) float lanes[8];
+    float d = 1;
+    for (unsigned l = 8; l-- > 0;) {
+        lanes[l] = w * d;
+        d *= decay;
+    }
+
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 step = _mm256_set1_ps(d);
+    __m256 wv = _mm256_load_ps(lanes);
+    __m256 acc = _mm256_setzero_ps();
+    for (unsigned i = m; i >= 8; i -= 8) {
+        __m256 x = _mm256_andnot_ps(sign, _mm256_loadu_ps(&in[i - 8]));
+        acc = _mm256_max_ps(acc, _mm256_mul_ps(x, wv));
+        wv = _mm256_mul_ps(wv, step);
+    }
+
+    _mm256_store_ps(lanes, acc);
+    for (float lane : lanes)
+        peak = std::max(peak, lane);
+    _mm256_store_ps(lanes, wv);
+    return std::max(peak, level * lanes[7]);
+}
+
+static void power(float *out, const cfloat *in, unsigned n)
+{
+    const float *src = (const float *)in;
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 a = _mm256_loadu_ps(&src[2 * i]);
+        __m256 b = _mm256_loadu_ps(&src[2 * i + 8]);
+        // the pairs come out of the lanes as 0 1 4 5 2 3 6 7
+        __m256 s = _mm256_hadd_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b));
+        s = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(s), _MM_SHUFFLE(3, 1, 2, 0)));
+        _mm256_storeu_ps(&out[i], s);
+    }
+    Kernels::power(&out[i], &in[i], n - i);
+}
+
+static void cross_spectrum(double *gxx, double *gyy, cdouble *gxy,
+                           const cfloat *x, const cfloat *y, unsigned n, double alpha)
+{
+    // two bins at a time, as pairs of doubles
+    const __m256d a = _mm256_set1_pd(alpha);
+    unsigned i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m256d xv = _mm256_cvtps_pd(_mm_loadu_ps((const float *)&x[i]));
+        __m256d yv = _mm256_cvtps_pd(_mm_loadu_ps((const float *)&y[i]));
+
+        // the norms as x0 y0 x1 y1, brought to x0 x1 y0 y1
+        __m256d norms = _mm256_hadd_pd(_mm256_mul_pd(xv, xv), _mm256_mul_pd(yv, yv));
+        norms = _mm256_permute4x64_pd(norms, _MM_SHUFFLE(3, 1, 2, 0));
+        __m128d nx = _mm256_castpd256_pd128(norms);
+        __m128d ny = _mm256_extractf128_pd(norms, 1);
+        __m128d gx = _mm_loadu_pd(&gxx[i]);
+        __m128d gy = _mm_loadu_pd(&gyy[i]);
+        _mm_storeu_pd(&gxx[i], _mm_fmadd_pd(_mm256_castpd256_pd128(a), _mm_sub_pd(nx, gx), gx));
+        _mm_storeu_pd(&gyy[i], _mm_fmadd_pd(_mm256_castpd256_pd128(a), _mm_sub_pd(ny, gy), gy));
+
+        __m256d re = _mm256_mul_pd(xv, yv);
+        __m256d im = _mm256_mul_pd(xv, _mm256_permute_pd(yv, 0x5));
+        __m256d sxy = _mm256_blend_pd(_mm256_hadd_pd(re, re), _mm256_hsub_pd(im, im), 0xa);
+        double *pxy = (double *)&gxy[i];
+        __m256d gv = _mm256_loadu_pd(pxy);
+        _mm256_storeu_pd(pxy, _mm256_fmadd_pd(a, _mm256_sub_pd(sxy, gv), gv));
+    }
+    Kernels::cross_spectrum(&gxx[i], &gyy[i], &gxy[i], &x[i], &y[i], n - i, alpha);
+}
+
+static inline __m256 log2_approx(__m256 x)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256i bits = _mm256_castps_si256(x);
+    __m256i e = _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127));
+    __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)), _mm256_set1_epi32(0x3f800000)));
+    __m256 fold = _mm256_cmp_ps(m, _mm256_set1_ps(sqrt2), _CMP_GT_OQ);
+    m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), fold);
+    // the mask is -1 where folded
+    e = _mm256_sub_epi32(e, _mm256_castps_si256(fold));
+    __m256 t = _mm256_div_ps(_mm256_sub_ps(m, one), _mm256_add_ps(m, one));
+    __m256 t2 = _mm256_mul_ps(t, t);
+    __m256 p = _mm256_set1_ps(log2_c7);
+    p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(log2_c5));
+    p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(log2_c3));
+    p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(log2_c1));
+    return _mm256_fmadd_ps(t, p, _mm256_cvtepi32_ps(e));
+}
+
+static void peaking_gain(float *out, const float *base, const float *phi, unsigned n,
+                         float center, float num, float den)
+{
+    const __m256 c = _mm256_set1_ps(center);
+    const __m256 bn = _mm256_set1_ps(num);
+    const __m256 bd = _mm256_set1_ps(den);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(&phi[i]);
+        __m256 d = _mm256_sub_ps(x, c);
+        __m256 d2 = _mm256_mul_ps(d, d);
+        __m256 s = _mm256_mul_ps(x, _mm256_sub_ps(one, x));
+        __m256 ratio = _mm256_div_ps(_mm256_fmadd_ps(bn, s, d2), _mm256_fmadd_ps(bd, s, d2));
+        _mm256_storeu_ps(&out[i], _mm256_add_ps(_mm256_loadu_ps(&base[i]), log2_approx(ratio)));
+    }
+    Kernels::peaking_gain(&out[i], &base[i], &phi[i], n - i, center, num, den);
+}
+
+}  // namespace AVX2
+}  // namespace Kernels
+#pragma GCC pop_options
+
+const Dsp_Kernels avx2_kernels = {
+    "avx2",
+    &Kernels::AVX2::oscillator,
+    &Kernels::AVX2::multiply,
+    &Kernels::AVX2::peak_envelope,
+    &Kernels::AVX2::power,
+    &Kernels::AVX2::cross_spectrum,
+    &Kernels::AVX2::peaking_gain,
+};
+#endif
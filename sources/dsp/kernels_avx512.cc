@@ -0,0 +1,193 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#if defined(__x86_64__) || defined(__i386__)
+#include "kernels_impl.h"
+#include <immintrin.h>
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+// the undefined vectors of the intrinsics of GCC 12 look uninitialized
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+namespace Kernels {
+namespace AVX512 {
+
+static inline __m512 cos_turns(__m512i phase)
+{
+    __m512 x = _mm512_abs_ps(_mm512_mul_ps(_mm512_cvtepi32_ps(phase), _mm512_set1_ps(phase_scale)));
+    __mmask16 back = _mm512_cmp_ps_mask(x, _mm512_set1_ps(0.25f), _CMP_GT_OQ);
+    __m512 b = _mm512_mask_sub_ps(x, back, _mm512_set1_ps(0.5f), x);
+    __m512 y = _mm512_mul_ps(b, b);
+    __m512 c = _mm512_set1_ps(cos_c6);
+    c = _mm512_fmadd_ps(c, y, _mm512_set1_ps(cos_c5));
+    c = _mm512_fmadd_ps(c, y, _mm512_set1_ps(cos_c4));
+    c = _mm512_fmadd_ps(c, y, _mm512_set1_ps(cos_c3));
+    c = _mm512_fmadd_ps(c, y, _mm512_set1_ps(cos_c2));
+    c = _mm512_fmadd_ps(c, y, _mm512_set1_ps(cos_c1));
+    c = _mm512_fmadd_ps(c, y, _mm512_set1_ps(cos_c0));
+    return _mm512_mask_sub_ps(c, back, _mm512_setzero_ps(), c);
+}
+
+static void oscillator(float *out, unsigned n, uint32_t *phase, uint32_t increment, float amp)
+{
+    uint32_t p = *phase;
+    const __m512 g = _mm512_set1_ps(amp);
+    const __m512i step = _mm512_set1_epi32((int32_t)(16 * increment));
+    __m512i pv = _mm512_add_epi32(
+        _mm512_set1_epi32((int32_t)p),
+        _mm512_mullo_epi32(_mm512_set1_epi32((int32_t)increment),
+                           _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)));
+
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 c = cos_turns(pv);
+        _mm512_storeu_ps(&out[i], _mm512_fmadd_ps(g, c, _mm512_loadu_ps(&out[i])));
+        pv = _mm512_add_epi32(pv, step);
+    }
+
+    p += i * increment;
+    Kernels::oscillator(&out[i], n - i, &p, increment, amp);
+    *phase = p;
+}
+
+static void multiply(float *out, const float *a, const float *b, unsigned n)
+{
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_ps(&out[i], _mm512_mul_ps(_mm512_loadu_ps(&a[i]), _mm512_loadu_ps(&b[i])));
+    Kernels::multiply(&out[i], &a[i], &b[i], n - i);
+}
+
+static float peak_envelope(const float *in, unsigned n, float decay, float level)
+{
+    const unsigned m = n & ~15u;
+    float w = 1;
+    float peak = peak_envelope_tail(&in[m], n - m, decay, &w);
+
+    alignas(64) float lanes[16];
+    float d = 1;
+    for (unsigned l = 16; l-- > 0;) {
+        lanes[l] = w * d;
+        d *= decay;
+    }
+
+    const __m512 step = _mm512_set1_ps(d);
+    __m512 wv = _mm512_load_ps(lanes);
+    __m512 acc = _mm512_setzero_ps();
+    for (unsigned i = m; i >= 16; i -= 16) {
+        __m512 x = _mm512_abs_ps(_mm512_loadu_ps(&in[i - 16]));
+        acc = _mm512_max_ps(acc, _mm512_mul_ps(x, wv));
+        wv = _mm512_mul_ps(wv, step);
+    }
+
+    peak = std::max(peak, _mm512_reduce_max_ps(acc));
+    _mm512_store_ps(lanes, wv);
+    return std::max(peak, level * lanes[15]);
+}
+
+static void power(float *out, const cfloat *in, unsigned n)
+{
+    const float *src = (const float *)in;
+    const __m512i even = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i odd = _mm512_add_epi32(even, _mm512_set1_epi32(1));
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 a = _mm512_loadu_ps(&src[2 * i]);
+        __m512 b = _mm512_loadu_ps(&src[2 * i + 16]);
+        __m512 re = _mm512_permutex2var_ps(a, even, b);
+        __m512 im = _mm512_permutex2var_ps(a, odd, b);
+        _mm512_storeu_ps(&out[i], _mm512_fmadd_ps(re, re, _mm512_mul_ps(im, im)));
+    }
+    Kernels::power(&out[i], &in[i], n - i);
+}
+
+static void cross_spectrum(double *gxx, double *gyy, cdouble *gxy,
+                           const cfloat *x, const cfloat *y, unsigned n, double alpha)
+{
+    // four bins at a time, as pairs of doubles
+    const __m512d a = _mm512_set1_pd(alpha);
+    const __m512i even = _mm512_setr_epi64(0, 2, 4, 6, 8, 10, 12, 14);
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m512d xv = _mm512_cvtps_pd(_mm256_loadu_ps((const float *)&x[i]));
+        __m512d yv = _mm512_cvtps_pd(_mm256_loadu_ps((const float *)&y[i]));
+
+        // the sums of the pairs, at the even lanes of x and the odd of y
+        __m512d xx = _mm512_mul_pd(xv, xv);
+        __m512d yy = _mm512_mul_pd(yv, yv);
+        __m512d sx = _mm512_add_pd(xx, _mm512_permute_pd(xx, 0x55));
+        __m512d sy = _mm512_add_pd(yy, _mm512_permute_pd(yy, 0x55));
+        __m512d norms = _mm512_permutex2var_pd(sx, even, sy);
+        __m512d g = _mm512_insertf64x4(_mm512_castpd256_pd512(_mm256_loadu_pd(&gxx[i])), _mm256_loadu_pd(&gyy[i]), 1);
+        g = _mm512_fmadd_pd(a, _mm512_sub_pd(norms, g), g);
+        _mm256_storeu_pd(&gxx[i], _mm512_castpd512_pd256(g));
+        _mm256_storeu_pd(&gyy[i], _mm512_extractf64x4_pd(g, 1));
+
+        __m512d re = _mm512_mul_pd(xv, yv);
+        __m512d im = _mm512_mul_pd(xv, _mm512_permute_pd(yv, 0x55));
+        __m512d sre = _mm512_add_pd(re, _mm512_permute_pd(re, 0x55));
+        __m512d sim = _mm512_sub_pd(_mm512_permute_pd(im, 0x55), im);
+        __m512d sxy = _mm512_mask_blend_pd(0xaa, sre, sim);
+        double *pxy = (double *)&gxy[i];
+        __m512d gv = _mm512_loadu_pd(pxy);
+        _mm512_storeu_pd(pxy, _mm512_fmadd_pd(a, _mm512_sub_pd(sxy, gv), gv));
+    }
+    Kernels::cross_spectrum(&gxx[i], &gyy[i], &gxy[i], &x[i], &y[i], n - i, alpha);
+}
+
+static inline __m512 log2_approx(__m512 x)
+{
+    const __m512 one = _mm512_set1_ps(1.0f);
+    __m512i bits = _mm512_castps_si512(x);
+    __m512i e = _mm512_sub_epi32(_mm512_srli_epi32(bits, 23), _mm512_set1_epi32(127));
+    __m512 m = _mm512_castsi512_ps(_mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi32(0x007fffff)), _mm512_set1_epi32(0x3f800000)));
+    __mmask16 fold = _mm512_cmp_ps_mask(m, _mm512_set1_ps(sqrt2), _CMP_GT_OQ);
+    m = _mm512_mask_mul_ps(m, fold, m, _mm512_set1_ps(0.5f));
+    e = _mm512_mask_add_epi32(e, fold, e, _mm512_set1_epi32(1));
+    __m512 t = _mm512_div_ps(_mm512_sub_ps(m, one), _mm512_add_ps(m, one));
+    __m512 t2 = _mm512_mul_ps(t, t);
+    __m512 p = _mm512_set1_ps(log2_c7);
+    p = _mm512_fmadd_ps(p, t2, _mm512_set1_ps(log2_c5));
+    p = _mm512_fmadd_ps(p, t2, _mm512_set1_ps(log2_c3));
+    p = _mm512_fmadd_ps(p, t2, _mm512_set1_ps(log2_c1));
+    return _mm512_fmadd_ps(t, p, _mm512_cvtepi32_ps(e));
+}
+
+static void peaking_gain(float *out, const float *base, const float *phi, unsigned n,
+                         float center, float num, float den)
+{
+    const __m512 c = _mm512_set1_ps(center);
+    const __m512 bn = _mm512_set1_ps(num);
+    const __m512 bd = _mm512_set1_ps(den);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 x = _mm512_loadu_ps(&phi[i]);
+        __m512 d = _mm512_sub_ps(x, c);
+        __m512 d2 = _mm512_mul_ps(d, d);
+        __m512 s = _mm512_mul_ps(x, _mm512_sub_ps(one, x));
+        __m512 ratio = _mm512_div_ps(_mm512_fmadd_ps(bn, s, d2), _mm512_fmadd_ps(bd, s, d2));
+        _mm512_storeu_ps(&out[i], _mm512_add_ps(_mm512_loadu_ps(&base[i]), log2_approx(ratio)));
+    }
+    Kernels::peaking_gain(&out[i], &base[i], &phi[i], n - i, center, num, den);
+}
+
+}  // namespace AVX512
+}  // namespace Kernels
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+
+const Dsp_Kernels avx512_kernels = {
+    "avx512",
+    &Kernels::AVX512::oscillator,
+    &Kernels::AVX512::multiply,
+    &Kernels::AVX512::peak_envelope,
+    &Kernels::AVX512::power,
+    &Kernels::AVX512::cross_spectrum,
+    &Kernels::AVX512::peaking_gain,
+};
+#endif
@@ -0,0 +1,144 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include "kernels.h"
+#include <algorithm>
+#include <cstring>
+
+// the variants, of which all but the scalar one exist only on x86
+//
+// the scalar code below serves for the tails of the vectors; the files of the
+// variants include it before they select their instruction set, so it stays
+// portable in all of them
+extern const Dsp_Kernels scalar_kernels;
+extern const Dsp_Kernels sse2_kernels;
+extern const Dsp_Kernels avx2_kernels;
+extern const Dsp_Kernels avx512_kernels;
+
+namespace Kernels {
+
+typedef std::complex<float> cfloat;
+typedef std::complex<double> cdouble;
+
+// cos(2πx) as a polynomial of x² for |x| ≤ 1/4, exact to float precision
+static constexpr float cos_c0 = 1.0f;
+static constexpr float cos_c1 = -19.739208802178716f;
+static constexpr float cos_c2 = 64.93939402266828f;
+static constexpr float cos_c3 = -85.45681720669371f;
+static constexpr float cos_c4 = 60.24464137187664f;
+static constexpr float cos_c5 = -26.426256783374388f;
+static constexpr float cos_c6 = 7.903536371318465f;
+static constexpr float phase_scale = 1.0f / 4294967296.0f;
+
+// log2(m) = 2/ln2·atanh(t), t = (m-1)/(m+1), as an odd series of t for a
+// mantissa folded within [√½, √2)
+static constexpr float log2_c1 = 2.8853900817779268f;
+static constexpr float log2_c3 = 0.9617966939259756f;
+static constexpr float log2_c5 = 0.5770780163555854f;
+static constexpr float log2_c7 = 0.41219858311113244f;
+static constexpr float sqrt2 = 1.4142135623730951f;
+
+// the phase as a signed fraction of a turn, folded to the first quarter,
+// where the sign of the second quarter is restored after
+static inline float cos_turns(uint32_t phase)
+{
+    float x = std::fabs((float)(int32_t)phase * phase_scale);
+    bool back = x > 0.25f;
+    float b = back ? (0.5f - x) : x;
+    float y = b * b;
+    float c = ((((((cos_c6 * y + cos_c5) * y + cos_c4) * y + cos_c3) * y + cos_c2) * y + cos_c1) * y + cos_c0);
+    return back ? -c : c;
+}
+
+static inline void oscillator(float *out, unsigned n, uint32_t *phase, uint32_t increment, float amp)
+{
+    uint32_t p = *phase;
+    for (unsigned i = 0; i < n; ++i) {
+        out[i] += amp * cos_turns(p);
+        p += increment;
+    }
+    *phase = p;
+}
+
+static inline void multiply(float *out, const float *a, const float *b, unsigned n)
+{
+    for (unsigned i = 0; i < n; ++i)
+        out[i] = a[i] * b[i];
+}
+
+static inline float peak_envelope(const float *in, unsigned n, float decay, float level)
+{
+    for (unsigned i = 0; i < n; ++i)
+        level = std::max(std::fabs(in[i]), level * decay);
+    return level;
+}
+
+static inline void power(float *out, const cfloat *in, unsigned n)
+{
+    for (unsigned i = 0; i < n; ++i)
+        out[i] = in[i].real() * in[i].real() + in[i].imag() * in[i].imag();
+}
+
+static inline void cross_spectrum(double *gxx, double *gyy, cdouble *gxy,
+                                  const cfloat *x, const cfloat *y, unsigned n, double alpha)
+{
+    for (unsigned i = 0; i < n; ++i) {
+        double xr = x[i].real(), xi = x[i].imag();
+        double yr = y[i].real(), yi = y[i].imag();
+        gxx[i] += alpha * ((xr * xr + xi * xi) - gxx[i]);
+        gyy[i] += alpha * ((yr * yr + yi * yi) - gyy[i]);
+        cdouble sxy(xr * yr + xi * yi, xr * yi - xi * yr);
+        gxy[i] += alpha * (sxy - gxy[i]);
+    }
+}
+
+// of a positive normal number
+static inline float log2_approx(float x)
+{
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    int e = (int)(bits >> 23) - 127;
+    bits = (bits & 0x007fffff) | 0x3f800000;
+    float m;
+    memcpy(&m, &bits, sizeof(m));
+    if (m > sqrt2) {
+        m *= 0.5f;
+        ++e;
+    }
+    float t = (m - 1.0f) / (m + 1.0f);
+    float t2 = t * t;
+    float p = ((log2_c7 * t2 + log2_c5) * t2 + log2_c3) * t2 + log2_c1;
+    return (float)e + t * p;
+}
+
+static inline void peaking_gain(float *out, const float *base, const float *phi, unsigned n,
+                                float center, float num, float den)
+{
+    for (unsigned i = 0; i < n; ++i) {
+        float x = phi[i];
+        float d = x - center;
+        float s = x * (1.0f - x);
+        out[i] = base[i] + log2_approx((d * d + num * s) / (d * d + den * s));
+    }
+}
+
+// the envelope at the end of the block is the largest of the inputs, each
+// decayed over the samples after it, and of the level before, decayed over
+// all; the vector variants take this form from the end, with weights which
+// decay by a full vector at each step back
+static inline float peak_envelope_tail(const float *in, unsigned n, float decay, float *weight)
+{
+    float w = *weight;
+    float level = 0;
+    for (unsigned i = n; i-- > 0;) {
+        level = std::max(level, std::fabs(in[i]) * w);
+        w *= decay;
+    }
+    *weight = w;
+    return level;
+}
+
+}  // namespace Kernels
@@ -0,0 +1,176 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#if defined(__x86_64__) || defined(__i386__)
+#include "kernels_impl.h"
+#include <emmintrin.h>
+#pragma GCC push_options
+#pragma GCC target("sse2")
+
+namespace Kernels {
+namespace SSE2 {
+
+static inline __m128 cos_turns(__m128i phase)
+{
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 x = _mm_andnot_ps(sign, _mm_mul_ps(_mm_cvtepi32_ps(phase), _mm_set1_ps(phase_scale)));
+    __m128 back = _mm_cmpgt_ps(x, _mm_set1_ps(0.25f));
+    __m128 b = _mm_or_ps(_mm_and_ps(back, _mm_sub_ps(_mm_set1_ps(0.5f), x)), _mm_andnot_ps(back, x));
+    __m128 y = _mm_mul_ps(b, b);
+    __m128 c = _mm_set1_ps(cos_c6);
+    c = _mm_add_ps(_mm_mul_ps(c, y), _mm_set1_ps(cos_c5));
+    c = _mm_add_ps(_mm_mul_ps(c, y), _mm_set1_ps(cos_c4));
+    c = _mm_add_ps(_mm_mul_ps(c, y), _mm_set1_ps(cos_c3));
+    c = _mm_add_ps(_mm_mul_ps(c, y), _mm_set1_ps(cos_c2));
+    c = _mm_add_ps(_mm_mul_ps(c, y), _mm_set1_ps(cos_c1));
+    c = _mm_add_ps(_mm_mul_ps(c, y), _mm_set1_ps(cos_c0));
+    return _mm_xor_ps(c, _mm_and_ps(back, sign));
+}
+
+static void oscillator(float *out, unsigned n, uint32_t *phase, uint32_t increment, float amp)
+{
+    uint32_t p = *phase;
+    const __m128 g = _mm_set1_ps(amp);
+    const __m128i step = _mm_set1_epi32((int32_t)(4 * increment));
+    __m128i pv = _mm_add_epi32(
+        _mm_set1_epi32((int32_t)p),
+        _mm_setr_epi32(0, (int32_t)increment, (int32_t)(2 * increment), (int32_t)(3 * increment)));
+
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 c = cos_turns(pv);
+        _mm_storeu_ps(&out[i], _mm_add_ps(_mm_loadu_ps(&out[i]), _mm_mul_ps(g, c)));
+        pv = _mm_add_epi32(pv, step);
+    }
+
+    p += i * increment;
+    Kernels::oscillator(&out[i], n - i, &p, increment, amp);
+    *phase = p;
+}
+
+static void multiply(float *out, const float *a, const float *b, unsigned n)
+{
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(&out[i], _mm_mul_ps(_mm_loadu_ps(&a[i]), _mm_loadu_ps(&b[i])));
+    Kernels::multiply(&out[i], &a[i], &b[i], n - i);
+}
+
+static float peak_envelope(const float *in, unsigned n, float decay, float level)
+{
+    const unsigned m = n & ~3u;
+    float w = 1;
+    float peak = peak_envelope_tail(&in[m], n - m, decay, &w);
+
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 step = _mm_set1_ps(decay * decay * decay * decay);
+    __m128 wv = _mm_mul_ps(_mm_set1_ps(w), _mm_setr_ps(decay * decay * decay, decay * decay, decay, 1));
+    __m128 acc = _mm_setzero_ps();
+    for (unsigned i = m; i >= 4; i -= 4) {
+        __m128 x = _mm_andnot_ps(sign, _mm_loadu_ps(&in[i - 4]));
+        acc = _mm_max_ps(acc, _mm_mul_ps(x, wv));
+        wv = _mm_mul_ps(wv, step);
+    }
+
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, acc);
+    for (float lane : lanes)
+        peak = std::max(peak, lane);
+    _mm_store_ps(lanes, wv);
+    return std::max(peak, level * lanes[3]);
+}
+
+static void power(float *out, const cfloat *in, unsigned n)
+{
+    const float *src = (const float *)in;
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 a = _mm_loadu_ps(&src[2 * i]);
+        __m128 b = _mm_loadu_ps(&src[2 * i + 4]);
+        __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(&out[i], _mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im)));
+    }
+    Kernels::power(&out[i], &in[i], n - i);
+}
+
+static void cross_spectrum(double *gxx, double *gyy, cdouble *gxy,
+                           const cfloat *x, const cfloat *y, unsigned n, double alpha)
+{
+    // one bin at a time, as a pair of doubles
+    const __m128d a = _mm_set1_pd(alpha);
+    const __m128d conj = _mm_setr_pd(1, -1);
+    for (unsigned i = 0; i < n; ++i) {
+        __m128d xv = _mm_cvtps_pd(_mm_castpd_ps(_mm_load_sd((const double *)&x[i])));
+        __m128d yv = _mm_cvtps_pd(_mm_castpd_ps(_mm_load_sd((const double *)&y[i])));
+        __m128d xx = _mm_mul_pd(xv, xv);
+        __m128d yy = _mm_mul_pd(yv, yv);
+        __m128d norms = _mm_add_pd(_mm_unpacklo_pd(xx, yy), _mm_unpackhi_pd(xx, yy));
+        __m128d g = _mm_loadh_pd(_mm_load_sd(&gxx[i]), &gyy[i]);
+        g = _mm_add_pd(g, _mm_mul_pd(a, _mm_sub_pd(norms, g)));
+        _mm_storel_pd(&gxx[i], g);
+        _mm_storeh_pd(&gyy[i], g);
+
+        __m128d xy = _mm_mul_pd(xv, yv);
+        __m128d xs = _mm_mul_pd(xv, _mm_shuffle_pd(yv, yv, 1));
+        __m128d sxy = _mm_add_pd(_mm_unpacklo_pd(xy, xs), _mm_mul_pd(conj, _mm_unpackhi_pd(xy, xs)));
+        double *pxy = (double *)&gxy[i];
+        __m128d gv = _mm_loadu_pd(pxy);
+        _mm_storeu_pd(pxy, _mm_add_pd(gv, _mm_mul_pd(a, _mm_sub_pd(sxy, gv))));
+    }
+}
+
+static inline __m128 log2_approx(__m128 x)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128i bits = _mm_castps_si128(x);
+    __m128i e = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+    __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f800000)));
+    __m128 fold = _mm_cmpgt_ps(m, _mm_set1_ps(sqrt2));
+    m = _mm_mul_ps(m, _mm_or_ps(_mm_and_ps(fold, _mm_set1_ps(0.5f)), _mm_andnot_ps(fold, one)));
+    // the mask is -1 where folded
+    e = _mm_sub_epi32(e, _mm_castps_si128(fold));
+    __m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+    __m128 t2 = _mm_mul_ps(t, t);
+    __m128 p = _mm_set1_ps(log2_c7);
+    p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(log2_c5));
+    p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(log2_c3));
+    p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(log2_c1));
+    return _mm_add_ps(_mm_cvtepi32_ps(e), _mm_mul_ps(t, p));
+}
+
+static void peaking_gain(float *out, const float *base, const float *phi, unsigned n,
+                         float center, float num, float den)
+{
+    const __m128 c = _mm_set1_ps(center);
+    const __m128 bn = _mm_set1_ps(num);
+    const __m128 bd = _mm_set1_ps(den);
+    const __m128 one = _mm_set1_ps(1.0f);
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(&phi[i]);
+        __m128 d = _mm_sub_ps(x, c);
+        __m128 d2 = _mm_mul_ps(d, d);
+        __m128 s = _mm_mul_ps(x, _mm_sub_ps(one, x));
+        __m128 ratio = _mm_div_ps(_mm_add_ps(d2, _mm_mul_ps(bn, s)), _mm_add_ps(d2, _mm_mul_ps(bd, s)));
+        _mm_storeu_ps(&out[i], _mm_add_ps(_mm_loadu_ps(&base[i]), log2_approx(ratio)));
+    }
+    Kernels::peaking_gain(&out[i], &base[i], &phi[i], n - i, center, num, den);
+}
+
+}  // namespace SSE2
+}  // namespace Kernels
+#pragma GCC pop_options
+
+const Dsp_Kernels sse2_kernels = {
+    "sse2",
+    &Kernels::SSE2::oscillator,
+    &Kernels::SSE2::multiply,
+    &Kernels::SSE2::peak_envelope,
+    &Kernels::SSE2::power,
+    &Kernels::SSE2::cross_spectrum,
+    &Kernels::SSE2::peaking_gain,
+};
+#endif
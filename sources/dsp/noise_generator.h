@@ -0,0 +1,51 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <cstdint>
+
+template <class R>
+struct White_Noise
+{
+    uint32_t seed_ = 1;
+    R process(); // uniform in [-1, 1]
+};
+
+template <class R>
+struct Pink_Noise
+{
+    White_Noise<R> white_;
+    R b_[7] = {};
+    R process();
+};
+
+template <class R>
+R White_Noise<R>::process()
+{
+    // xorshift32
+    uint32_t x = seed_;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    seed_ = x;
+    return (R)x * (R)(2.0 / 4294967295.0) - 1;
+}
+
+template <class R>
+R Pink_Noise<R>::process()
+{
+    // Paul Kellet's refined method
+    R w = white_.process();
+    R *b = b_;
+    b[0] = (R)0.99886 * b[0] + w * (R)0.0555179;
+    b[1] = (R)0.99332 * b[1] + w * (R)0.0750759;
+    b[2] = (R)0.96900 * b[2] + w * (R)0.1538520;
+    b[3] = (R)0.86650 * b[3] + w * (R)0.3104856;
+    b[4] = (R)0.55000 * b[4] + w * (R)0.5329522;
+    b[5] = (R)-0.7616 * b[5] - w * (R)0.0168980;
+    R pink = b[0] + b[1] + b[2] + b[3] + b[4] + b[5] + b[6] + w * (R)0.5362;
+    b[6] = w * (R)0.115926;
+    return pink * (R)0.11;
+}
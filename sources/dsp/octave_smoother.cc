@@ -0,0 +1,239 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "octave_smoother.h"
+#include <algorithm>
+#include <cmath>
+
+void Octave_Smoother::set_grid(const double *freqs, unsigned n)
+{
+    freqs_.assign(freqs, freqs + n);
+    weights_.resize(n);
+    win_lo_.resize(n);
+    win_hi_.resize(n);
+    values_.assign(n, 0.0);
+    valid_.assign(n, false);
+    count_.assign(n, 0);
+    out_mag_.assign(n, 0.0);
+    out_cplx_.assign(n, 0.0);
+    dirty_mark_.assign(n, false);
+    dirty_.reserve(n);
+
+    // each point weighs half the log distance to its neighbors
+    for (unsigned i = 0; i < n; ++i) {
+        double l1 = std::log2(freqs[(i > 0) ? (i - 1) : i]);
+        double l2 = std::log2(freqs[(i + 1 < n) ? (i + 1) : i]);
+        weights_[i] = (n > 1) ? (0.5 * (l2 - l1)) : 1.0;
+    }
+
+    compute_windows();
+    invalidate_all();
+}
+
+void Octave_Smoother::set_fraction(unsigned fraction)
+{
+    if (fraction_ == fraction)
+        return;
+    fraction_ = fraction;
+    compute_windows();
+    invalidate_all();
+}
+
+void Octave_Smoother::reset()
+{
+    std::fill(values_.begin(), values_.end(), 0.0);
+    std::fill(valid_.begin(), valid_.end(), false);
+    invalidate_all();
+}
+
+void Octave_Smoother::update(unsigned index, cdouble value)
+{
+    if (!all_dirty_) {
+        // the difference to what the input added before
+        const double w = weights_[index];
+        const double w_old = valid_[index] ? w : 0.0;
+        const cdouble v_old = values_[index];
+        if (!valid_[index])
+            prefix_count_.add(index, 1);
+        prefix_w_.add(index, w - w_old);
+        prefix_pow_.add(index, w * std::norm(value) - w_old * std::norm(v_old));
+        prefix_cplx_.add(index, w * value - w_old * v_old);
+        if (!dirty_mark_[index]) {
+            dirty_mark_[index] = true;
+            dirty_.push_back(index);
+        }
+    }
+
+    values_[index] = value;
+    valid_[index] = true;
+}
+
+void Octave_Smoother::compute()
+{
+    if (all_dirty_) {
+        rebuild_sums();
+        compute_outputs(0, size());
+        all_dirty_ = false;
+        return;
+    }
+
+    // the runs of consecutive updated inputs, and the outputs whose windows
+    // overlap them, merged where they meet; the bounds are monotonic
+    std::sort(dirty_.begin(), dirty_.end());
+    unsigned out_lo = 0, out_hi = 0;
+    for (size_t k = 0, m = dirty_.size(); k < m;) {
+        unsigned lo = dirty_[k];
+        unsigned hi = lo + 1;
+        while (++k < m && dirty_[k] == hi)
+            ++hi;
+        unsigned olo = std::upper_bound(win_hi_.begin(), win_hi_.end(), lo) - win_hi_.begin();
+        unsigned ohi = std::lower_bound(win_lo_.begin(), win_lo_.end(), hi) - win_lo_.begin();
+        if (olo > out_hi) {
+            compute_outputs(out_lo, out_hi);
+            out_lo = olo;
+        }
+        out_hi = std::max(out_hi, ohi);
+    }
+    compute_outputs(out_lo, out_hi);
+
+    for (unsigned index : dirty_)
+        dirty_mark_[index] = false;
+    dirty_.clear();
+}
+
+void Octave_Smoother::compute_outputs(unsigned lo, unsigned hi)
+{
+    for (unsigned i = lo; i < hi; ++i) {
+        unsigned wlo = win_lo_[i];
+        unsigned whi = win_hi_[i];
+        count_[i] = prefix_count_.sum(whi) - prefix_count_.sum(wlo);
+        double wsum = prefix_w_.sum(whi) - prefix_w_.sum(wlo);
+        if (count_[i] > 0 && wsum > 0) {
+            double pow = (prefix_pow_.sum(whi) - prefix_pow_.sum(wlo)) / wsum;
+            out_mag_[i] = std::sqrt(std::max(0.0, pow));
+            out_cplx_[i] = (prefix_cplx_.sum(whi) - prefix_cplx_.sum(wlo)) / wsum;
+        }
+        else {
+            out_mag_[i] = 0;
+            out_cplx_[i] = 0;
+        }
+    }
+}
+
+void Octave_Smoother::rebuild_sums()
+{
+    const unsigned n = size();
+
+    // from scratch, which also drops the rounding errors of the updates
+    std::vector<unsigned> count(n);
+    std::vector<double> w(n), pow(n);
+    std::vector<cdouble> cplx(n);
+    for (unsigned i = 0; i < n; ++i) {
+        count[i] = valid_[i];
+        w[i] = valid_[i] ? weights_[i] : 0.0;
+        pow[i] = w[i] * std::norm(values_[i]);
+        cplx[i] = w[i] * values_[i];
+    }
+
+    prefix_count_.build(count.data(), n);
+    prefix_w_.build(w.data(), n);
+    prefix_pow_.build(pow.data(), n);
+    prefix_cplx_.build(cplx.data(), n);
+}
+
+void Octave_Smoother::compute_windows()
+{
+    const unsigned n = size();
+
+    if (fraction_ == 0) {
+        for (unsigned i = 0; i < n; ++i) {
+            win_lo_[i] = i;
+            win_hi_[i] = i + 1;
+        }
+        return;
+    }
+
+    const double ratio = std::exp2(0.5 / fraction_);
+    unsigned lo = 0, hi = 0;
+    for (unsigned i = 0; i < n; ++i) {
+        const double fmin = freqs_[i] / ratio;
+        const double fmax = freqs_[i] * ratio;
+        while (lo < i && freqs_[lo] < fmin)
+            ++lo;
+        hi = std::max(hi, i + 1);
+        while (hi < n && freqs_[hi] <= fmax)
+            ++hi;
+        win_lo_[i] = lo;
+        win_hi_[i] = hi;
+    }
+}
+
+void Octave_Smoother::invalidate_all()
+{
+    all_dirty_ = true;
+    dirty_.clear();
+    std::fill(dirty_mark_.begin(), dirty_mark_.end(), false);
+}
+
+//------------------------------------------------------------------------------
+template <class T>
+void Octave_Smoother::Prefix_Tree<T>::build(const T *values, unsigned n)
+{
+    // a Fenwick tree, where the node i holds the sum of the i & -i elements
+    // which end at i, built in linear time
+    node.assign(n + 1, T());
+    for (unsigned i = 1; i <= n; ++i) {
+        node[i] += values[i - 1];
+        unsigned j = i + (i & -i);
+        if (j <= n)
+            node[j] += node[i];
+    }
+}
+
+template <class T>
+void Octave_Smoother::Prefix_Tree<T>::add(unsigned index, T delta)
+{
+    for (unsigned i = index + 1, n = node.size(); i < n; i += i & -i)
+        node[i] += delta;
+}
+
+template <class T>
+T Octave_Smoother::Prefix_Tree<T>::sum(unsigned end) const
+{
+    T s = T();
+    for (unsigned i = end; i > 0; i -= i & -i)
+        s += node[i];
+    return s;
+}
+
+//------------------------------------------------------------------------------
+void unwrap_phase(const std::complex<double> *response, double *phase, unsigned n)
+{
+    double offset = 0;
+    double last = 0;
+    for (unsigned i = 0; i < n; ++i) {
+        double p = std::arg(response[i]);
+        if (i > 0)
+            offset -= 2 * M_PI * std::round((p - last) / (2 * M_PI));
+        last = p;
+        phase[i] = p + offset;
+    }
+}
+
+void group_delay(const double *freqs, const double *unwrapped, double *delay, unsigned n)
+{
+    if (n < 2) {
+        std::fill_n(delay, n, 0.0);
+        return;
+    }
+
+    // -dφ/dω, central differences inside, one-sided at the ends
+    for (unsigned i = 0; i < n; ++i) {
+        unsigned i1 = (i > 0) ? (i - 1) : i;
+        unsigned i2 = (i + 1 < n) ? (i + 1) : i;
+        double dw = 2 * M_PI * (freqs[i2] - freqs[i1]);
+        delay[i] = (dw > 0) ? (-(unwrapped[i2] - unwrapped[i1]) / dw) : 0.0;
+    }
+}
@@ -0,0 +1,78 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <vector>
+#include <complex>
+
+//------------------------------------------------------------------------------
+// Fractional-octave smoothing on a sorted frequency grid.
+//
+// Each output point averages the inputs which lie within ±1/(2N) octave of its
+// frequency, weighted by the log-frequency width of each input. Window bounds
+// are found with two moving pointers, and sums are taken as differences of
+// prefix sums, so a full computation is linear in the number of points.
+// An update adds its difference to trees of the prefix sums, in logarithmic
+// time, and the updated inputs are kept as a list, so that only the outputs
+// whose windows overlap one of them are computed again.
+class Octave_Smoother {
+public:
+    typedef std::complex<double> cdouble;
+
+    void set_grid(const double *freqs, unsigned n);
+    void set_fraction(unsigned fraction); // 1/N octave, 0 = no smoothing
+
+    unsigned size() const { return (unsigned)freqs_.size(); }
+
+    void reset();
+    void update(unsigned index, cdouble value);
+    void compute();
+
+    // whether an output has any measured input in its window
+    bool defined(unsigned index) const { return count_[index] > 0; }
+    // smoothed in power, as an amplitude
+    const double *magnitude() const { return out_mag_.data(); }
+    // smoothed in complex
+    const cdouble *response() const { return out_cplx_.data(); }
+
+private:
+    // sums of the prefixes, which take the changes of single elements
+    template <class T> struct Prefix_Tree {
+        std::vector<T> node;
+        void build(const T *values, unsigned n);
+        void add(unsigned index, T delta);
+        // the sum of the elements before `end`
+        T sum(unsigned end) const;
+    };
+
+    void compute_windows();
+    void compute_outputs(unsigned lo, unsigned hi);
+    void rebuild_sums();
+    void invalidate_all();
+
+private:
+    unsigned fraction_ = 0;
+    std::vector<double> freqs_;
+    std::vector<double> weights_;
+    std::vector<unsigned> win_lo_, win_hi_;
+    std::vector<cdouble> values_;
+    std::vector<bool> valid_;
+    // the count of valid inputs is exact, unlike the sums of the weights
+    Prefix_Tree<unsigned> prefix_count_;
+    Prefix_Tree<double> prefix_w_;
+    Prefix_Tree<double> prefix_pow_;
+    Prefix_Tree<cdouble> prefix_cplx_;
+    std::vector<unsigned> count_;
+    std::vector<double> out_mag_;
+    std::vector<cdouble> out_cplx_;
+    // inputs updated since the last computation, unless all are
+    std::vector<unsigned> dirty_;
+    std::vector<bool> dirty_mark_;
+    bool all_dirty_ = true;
+};
+
+//------------------------------------------------------------------------------
+void unwrap_phase(const std::complex<double> *response, double *phase, unsigned n);
+void group_delay(const double *freqs, const double *unwrapped, double *delay, unsigned n);
@@ -0,0 +1,71 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "peak_fit.h"
+#include "windows.h"
+#include "analyzerdefs.h"
+#include <algorithm>
+#include <cmath>
+
+Peak_Fit fit_window_peak(const std::complex<float> *spectrum, unsigned n, double expected, unsigned search, int window)
+{
+    const long last = n / 2;
+    long center = std::lround(expected);
+    long lo = std::max(0l, center - (long)search);
+    long hi = std::min(last, center + (long)search);
+
+    Peak_Fit fit;
+    long peak = std::min(std::max(center, 0l), last);
+    for (long b = lo; b <= hi; ++b) {
+        if (std::norm(spectrum[b]) > std::norm(spectrum[peak]))
+            peak = b;
+    }
+    fit.bin = peak;
+
+    if (peak == 0 || peak == last)
+        return fit;
+
+    double mag = std::abs(spectrum[peak]);
+    double left = std::abs(spectrum[peak - 1]);
+    double right = std::abs(spectrum[peak + 1]);
+    if (mag == 0)
+        return fit;
+
+    double offset;
+    if (window == Analysis::Window_Hann) {
+        // the ratio α of the neighbor to the peak gives the offset (2α-1)/(α+1)
+        double alpha = std::max(left, right) / mag;
+        offset = (2 * alpha - 1) / (alpha + 1);
+    }
+    else {
+        // the neighbors of the wider windows differ by little in ratio to the
+        // peak, but their difference grows fast with the offset x, as
+        // (G(1-x)-G(1+x))/G(x) for the kernel G
+        double rho = std::fabs(right - left) / mag;
+        double lo = 0, hi = 0.5;
+        for (unsigned i = 0; i < 24; ++i) {
+            double x = 0.5 * (lo + hi);
+            double g = std::fabs(window_bin_gain(window, x));
+            double d = std::fabs(window_bin_gain(window, 1 - x)) - std::fabs(window_bin_gain(window, 1 + x));
+            ((d < rho * g) ? lo : hi) = x;
+        }
+        offset = 0.5 * (lo + hi);
+    }
+    offset = std::max(0.0, std::min(offset, 0.5));
+    fit.offset = (right > left) ? offset : -offset;
+    return fit;
+}
+
+std::complex<float> window_bin_value(const std::complex<float> *spectrum, unsigned bin, double offset, int window)
+{
+    return window_tone_value(spectrum[bin], offset, window);
+}
+
+std::complex<float> window_tone_value(std::complex<float> value, double offset, int window)
+{
+    // the window centered at n/2 turns the phase by π·offset
+    std::complex<float> shift = std::polar(window_bin_gain(window, offset), (float)(M_PI * offset));
+    return value / shift;
+}
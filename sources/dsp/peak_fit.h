@@ -0,0 +1,32 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <complex>
+
+//------------------------------------------------------------------------------
+// Location of a tone which falls between the bins of a spectrum computed
+// with a window of n points, of a type in Analysis::Window_Type.
+//
+// The peak is the largest bin within `search` bins of the expected one, and
+// its offset comes from its neighbors, which is exact for a single tone. The
+// flat-top window makes them vary little with the offset, which is less
+// precise than with the others. Only the tones clear of the others and of
+// the noise give a reliable offset.
+struct Peak_Fit {
+    unsigned bin = 0;
+    // from the bin, within ±0.5
+    double offset = 0;
+};
+
+Peak_Fit fit_window_peak(const std::complex<float> *spectrum, unsigned n, double expected, unsigned search, int window);
+
+//------------------------------------------------------------------------------
+// Value which a tone at the given offset from a bin would have at this bin
+// if it fell exactly on it, with the loss and the phase of the window at
+// this offset removed. The loss alone is window_bin_gain().
+std::complex<float> window_bin_value(const std::complex<float> *spectrum, unsigned bin, double offset, int window);
+// the same, of a value read at any frequency, as by a tone detector
+std::complex<float> window_tone_value(std::complex<float> value, double offset, int window);
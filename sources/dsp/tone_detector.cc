@@ -0,0 +1,32 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "tone_detector.h"
+#include "analyzerdefs.h"
+
+template <template <class, unsigned> class D, class R>
+static std::unique_ptr<Tone_Detector> make_detector(unsigned max_tones)
+{
+    // few tones, as for the sweeps of the lowest frequencies, or as many as
+    // the sweep plays at once
+    if (max_tones <= 4)
+        return std::unique_ptr<Tone_Detector>(new D<R, 4>);
+    if (max_tones <= Analysis::max_parallel)
+        return std::unique_ptr<Tone_Detector>(new D<R, Analysis::max_parallel>);
+    return nullptr;
+}
+
+std::unique_ptr<Tone_Detector> make_tone_detector(const std::string &name, unsigned max_tones)
+{
+    if (name == "goertzel")
+        return make_detector<Goertzel_Detector, float>(max_tones);
+    else if (name == "goertzel-double")
+        return make_detector<Goertzel_Detector, double>(max_tones);
+    else if (name == "lockin")
+        return make_detector<Lockin_Detector, float>(max_tones);
+    else if (name == "lockin-double")
+        return make_detector<Lockin_Detector, double>(max_tones);
+    return nullptr;
+}
@@ -0,0 +1,208 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <complex>
+#include <memory>
+#include <string>
+#include <algorithm>
+#include <cmath>
+
+//------------------------------------------------------------------------------
+// Detectors which follow the tones of a step as the samples arrive, rather
+// than from the transform of the whole period. The value at a frequency f,
+// relative to the rate, is Σ w[i]·x[i]·e^{-2πjfi} over the period, which is
+// the bin of the transform for a tone on a bin, and exact between the bins.
+//
+// The variants are instantiated for the precision of the arithmetic and the
+// largest count of tones, so that their inner loop runs over a fixed count of
+// lanes, and they are chosen at the configuration of the processor.
+class Tone_Detector {
+public:
+    virtual ~Tone_Detector() {}
+
+    // the largest count of tones
+    virtual unsigned capacity() const = 0;
+
+    // starts a period of n samples
+    virtual void begin(const double *freqs, unsigned count, unsigned n) = 0;
+    // adds the samples from the position `pos` of the period
+    virtual void push(const float *in, const float *window, unsigned pos, unsigned count) = 0;
+    // the values, once the n samples of the period are in
+    virtual void result(std::complex<float> *out) const = 0;
+};
+
+// the detector named `goertzel` or `lockin`, in single precision, or with the
+// suffix `-double` in double precision, which follows up to `max_tones` tones
+// rounded up to an instantiated capacity, or null for `fft`, for an unknown
+// name, or for more tones than the largest capacity
+std::unique_ptr<Tone_Detector> make_tone_detector(const std::string &name, unsigned max_tones);
+
+//------------------------------------------------------------------------------
+// The recursion of Goertzel, s[i] = x[i] + 2cos(ω)·s[i-1] - s[i-2], which
+// costs one multiplication by tone and sample. Its error grows as the tones
+// go down in frequency, where single precision is not enough.
+template <class R, unsigned Max_Tones>
+class Goertzel_Detector final : public Tone_Detector {
+public:
+    unsigned capacity() const override { return Max_Tones; }
+    void begin(const double *freqs, unsigned count, unsigned n) override;
+    void push(const float *in, const float *window, unsigned pos, unsigned count) override;
+    void result(std::complex<float> *out) const override;
+
+private:
+    unsigned count_ = 0;
+    unsigned n_ = 0;
+    double freq_[Max_Tones] = {};
+    R coef_[Max_Tones] = {};
+    R s1_[Max_Tones] = {};
+    R s2_[Max_Tones] = {};
+};
+
+//------------------------------------------------------------------------------
+// The product with a reference which rotates by e^{-jω} at each sample, and
+// which is computed exactly at regular intervals, so that the error of the
+// rotation does not build up. It is stable in single precision.
+template <class R, unsigned Max_Tones>
+class Lockin_Detector final : public Tone_Detector {
+public:
+    unsigned capacity() const override { return Max_Tones; }
+    void begin(const double *freqs, unsigned count, unsigned n) override;
+    void push(const float *in, const float *window, unsigned pos, unsigned count) override;
+    void result(std::complex<float> *out) const override;
+
+private:
+    void set_reference(unsigned pos);
+
+private:
+    enum { interval = 1024 };
+    unsigned count_ = 0;
+    double freq_[Max_Tones] = {};
+    R rot_re_[Max_Tones] = {};
+    R rot_im_[Max_Tones] = {};
+    R ref_re_[Max_Tones] = {};
+    R ref_im_[Max_Tones] = {};
+    R acc_re_[Max_Tones] = {};
+    R acc_im_[Max_Tones] = {};
+};
+
+//------------------------------------------------------------------------------
+template <class R, unsigned Max_Tones>
+void Goertzel_Detector<R, Max_Tones>::begin(const double *freqs, unsigned count, unsigned n)
+{
+    // the lanes past the count run at zero frequency, and are ignored
+    count_ = std::min(count, Max_Tones);
+    n_ = n;
+    for (unsigned a = 0; a < Max_Tones; ++a) {
+        freq_[a] = (a < count_) ? freqs[a] : 0;
+        coef_[a] = (R)(2 * std::cos(2 * M_PI * freq_[a]));
+        s1_[a] = 0;
+        s2_[a] = 0;
+    }
+}
+
+template <class R, unsigned Max_Tones>
+void Goertzel_Detector<R, Max_Tones>::push(const float *in, const float *window, unsigned pos, unsigned count)
+{
+    R s1[Max_Tones], s2[Max_Tones];
+    std::copy_n(s1_, Max_Tones, s1);
+    std::copy_n(s2_, Max_Tones, s2);
+
+    for (unsigned i = 0; i < count; ++i) {
+        R x = (R)in[i] * (R)window[pos + i];
+        for (unsigned a = 0; a < Max_Tones; ++a) {
+            R s = x + coef_[a] * s1[a] - s2[a];
+            s2[a] = s1[a];
+            s1[a] = s;
+        }
+    }
+
+    std::copy_n(s1, Max_Tones, s1_);
+    std::copy_n(s2, Max_Tones, s2_);
+}
+
+template <class R, unsigned Max_Tones>
+void Goertzel_Detector<R, Max_Tones>::result(std::complex<float> *out) const
+{
+    // s[n-1] - e^{-jω}·s[n-2] is the sum of x[i]·e^{jω(n-1-i)}
+    for (unsigned a = 0; a < count_; ++a) {
+        double w = 2 * M_PI * freq_[a];
+        std::complex<double> y = (double)s1_[a] - std::polar(1.0, -w) * (double)s2_[a];
+        double turns = freq_[a] * (n_ - 1);
+        turns -= std::floor(turns);
+        out[a] = std::complex<float>(y * std::polar(1.0, -2 * M_PI * turns));
+    }
+}
+
+//------------------------------------------------------------------------------
+template <class R, unsigned Max_Tones>
+void Lockin_Detector<R, Max_Tones>::begin(const double *freqs, unsigned count, unsigned n)
+{
+    (void)n;
+    count_ = std::min(count, Max_Tones);
+    for (unsigned a = 0; a < Max_Tones; ++a) {
+        freq_[a] = (a < count_) ? freqs[a] : 0;
+        rot_re_[a] = (R)std::cos(2 * M_PI * freq_[a]);
+        rot_im_[a] = (R)-std::sin(2 * M_PI * freq_[a]);
+        acc_re_[a] = 0;
+        acc_im_[a] = 0;
+    }
+    set_reference(0);
+}
+
+template <class R, unsigned Max_Tones>
+void Lockin_Detector<R, Max_Tones>::push(const float *in, const float *window, unsigned pos, unsigned count)
+{
+    R ref_re[Max_Tones], ref_im[Max_Tones];
+    R acc_re[Max_Tones], acc_im[Max_Tones];
+
+    for (unsigned i = 0; i < count;) {
+        unsigned p = pos + i;
+        if (p % interval == 0)
+            set_reference(p);
+        unsigned m = std::min<unsigned>(count - i, interval - p % interval);
+
+        std::copy_n(ref_re_, Max_Tones, ref_re);
+        std::copy_n(ref_im_, Max_Tones, ref_im);
+        std::copy_n(acc_re_, Max_Tones, acc_re);
+        std::copy_n(acc_im_, Max_Tones, acc_im);
+
+        for (unsigned j = 0; j < m; ++j) {
+            R x = (R)in[i + j] * (R)window[p + j];
+            for (unsigned a = 0; a < Max_Tones; ++a) {
+                acc_re[a] += x * ref_re[a];
+                acc_im[a] += x * ref_im[a];
+                R re = ref_re[a] * rot_re_[a] - ref_im[a] * rot_im_[a];
+                R im = ref_re[a] * rot_im_[a] + ref_im[a] * rot_re_[a];
+                ref_re[a] = re;
+                ref_im[a] = im;
+            }
+        }
+
+        std::copy_n(ref_re, Max_Tones, ref_re_);
+        std::copy_n(ref_im, Max_Tones, ref_im_);
+        std::copy_n(acc_re, Max_Tones, acc_re_);
+        std::copy_n(acc_im, Max_Tones, acc_im_);
+        i += m;
+    }
+}
+
+template <class R, unsigned Max_Tones>
+void Lockin_Detector<R, Max_Tones>::result(std::complex<float> *out) const
+{
+    for (unsigned a = 0; a < count_; ++a)
+        out[a] = std::complex<float>((float)acc_re_[a], (float)acc_im_[a]);
+}
+
+template <class R, unsigned Max_Tones>
+void Lockin_Detector<R, Max_Tones>::set_reference(unsigned pos)
+{
+    for (unsigned a = 0; a < Max_Tones; ++a) {
+        double turns = freq_[a] * pos;
+        turns -= std::floor(turns);
+        ref_re_[a] = (R)std::cos(2 * M_PI * turns);
+        ref_im_[a] = (R)-std::sin(2 * M_PI * turns);
+    }
+}
@@ -0,0 +1,77 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "windows.h"
+#include "analyzerdefs.h"
+#include <cmath>
+
+static const Cosine_Window cosine_windows[Analysis::num_window_types] = {
+    // Hann
+    {2, {0.5, 0.5}},
+    // flat-top, within 0.01 dB over the main lobe
+    {5, {0.21557895, 0.41663158, 0.277263158, 0.083578947, 0.006947368}},
+    // Blackman-Harris of 4 terms, with sidelobes at -92 dB
+    {4, {0.35875, 0.48829, 0.14128, 0.01168}},
+};
+
+const Cosine_Window &cosine_window(int type)
+{
+    if (type < 0 || (unsigned)type >= Analysis::num_window_types)
+        type = Analysis::Window_Hann;
+    return cosine_windows[type];
+}
+
+void generate_window(int type, float *data, unsigned n)
+{
+    const Cosine_Window &w = cosine_window(type);
+    for (unsigned i = 0; i < n; ++i) {
+        double x = 0;
+        for (unsigned k = 0; k < w.terms; ++k) {
+            double c = w.a[k] * std::cos((2 * M_PI * k * i) / n);
+            x += (k & 1) ? -c : c;
+        }
+        data[i] = (float)x;
+    }
+}
+
+double window_sum(int type, unsigned n)
+{
+    return n * cosine_window(type).a[0];
+}
+
+double window_square_sum(int type, unsigned n)
+{
+    // the cosines are orthogonal over the period
+    const Cosine_Window &w = cosine_window(type);
+    double sum = w.a[0] * w.a[0];
+    for (unsigned k = 1; k < w.terms; ++k)
+        sum += 0.5 * w.a[k] * w.a[k];
+    return n * sum;
+}
+
+unsigned window_lobe_bins(int type)
+{
+    return cosine_window(type).terms;
+}
+
+float window_bin_gain(int type, double offset)
+{
+    // each term shifts the kernel of the rectangle, sinc(x), by k bins
+    // either side: sinc(x)·Σ (-1)^k a[k]·x²/(x²-k²) / a[0]
+    const Cosine_Window &w = cosine_window(type);
+    double x = offset;
+    for (unsigned k = 0; k < w.terms; ++k) {
+        // at the zeros of the sinc, the terms of the other bins vanish
+        if (std::fabs(std::fabs(x) - k) < 1e-9)
+            return (float)((k == 0) ? 1 : (w.a[k] / (2 * w.a[0])));
+    }
+
+    double sum = 0;
+    for (unsigned k = 0; k < w.terms; ++k) {
+        double t = w.a[k] * (x * x) / (x * x - (double)(k * k));
+        sum += (k & 1) ? -t : t;
+    }
+    return (float)(std::sin(M_PI * x) / (M_PI * x) * sum / w.a[0]);
+}
@@ -0,0 +1,33 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+//------------------------------------------------------------------------------
+// Windows of the analysis, as sums of cosines which are periodic in n points,
+// w[i] = Σ (-1)^k a[k] cos(2πki/n), so that a tone on a bin of the period
+// leaks into no other bin than the terms of the window allow.
+struct Cosine_Window {
+    unsigned terms;
+    double a[5];
+};
+
+// the type is one of Analysis::Window_Type
+const Cosine_Window &cosine_window(int type);
+
+void generate_window(int type, float *data, unsigned n);
+
+// the sums of the coefficients and of their squares, for n above twice the
+// count of terms
+double window_sum(int type, unsigned n);
+double window_square_sum(int type, unsigned n);
+
+// half-width of the main lobe in bins, beyond which the kernel vanishes at
+// the bins of a tone on a bin
+unsigned window_lobe_bins(int type);
+
+// kernel of the window at an offset in bins from a tone, at 1 for 0, which
+// is exact for n large
+float window_bin_gain(int type, double offset);
@@ -0,0 +1,83 @@
+# measurement engine, which depends on JACK and FFTW, but not on Qt
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/audiosys.cc \
+    $$PWD/audioprocessor.cc \
+    $$PWD/matrixprocessor.cc \
+    $$PWD/processorchannel.cc \
+    $$PWD/multitone.cc \
+    $$PWD/sweepscheduler.cc \
+    $$PWD/sweepcheckpoint.cc \
+    $$PWD/eqexport.cc \
+    $$PWD/workerpool.cc \
+    $$PWD/streamanalyzer.cc \
+    $$PWD/transferanalyzer.cc \
+    $$PWD/bandanalyzer.cc \
+    $$PWD/analyzerdefs.cc \
+    $$PWD/messages.cc \
+    $$PWD/parameters.cc \
+    $$PWD/fftplan.cc \
+    $$PWD/windowcache.cc \
+    $$PWD/rtarena.cc \
+    $$PWD/rtguard.cc \
+    $$PWD/rtprofiler.cc \
+    $$PWD/tracer.cc \
+    $$PWD/dsp/octave_smoother.cc \
+    $$PWD/dsp/adaptive_grid.cc \
+    $$PWD/dsp/peak_fit.cc \
+    $$PWD/dsp/windows.cc \
+    $$PWD/dsp/tone_detector.cc \
+    $$PWD/dsp/eq_fit.cc \
+    $$PWD/dsp/kernels.cc \
+    $$PWD/dsp/kernels_sse2.cc \
+    $$PWD/dsp/kernels_avx2.cc \
+    $$PWD/dsp/kernels_avx512.cc \
+    $$PWD/utility/ring_buffer.cpp
+
+HEADERS += \
+    $$PWD/audiosys.h \
+    $$PWD/audioprocessor.h \
+    $$PWD/matrixprocessor.h \
+    $$PWD/processorchannel.h \
+    $$PWD/multitone.h \
+    $$PWD/sweepscheduler.h \
+    $$PWD/sweepcheckpoint.h \
+    $$PWD/eqexport.h \
+    $$PWD/workerpool.h \
+    $$PWD/streamanalyzer.h \
+    $$PWD/transferanalyzer.h \
+    $$PWD/bandanalyzer.h \
+    $$PWD/analyzerdefs.h \
+    $$PWD/messages.h \
+    $$PWD/parameters.h \
+    $$PWD/fftplan.h \
+    $$PWD/windowcache.h \
+    $$PWD/rtarena.h \
+    $$PWD/rtguard.h \
+    $$PWD/rtprofiler.h \
+    $$PWD/tracer.h \
+    $$PWD/dsp/gain_ramp.h \
+    $$PWD/dsp/octave_smoother.h \
+    $$PWD/dsp/adaptive_grid.h \
+    $$PWD/dsp/peak_fit.h \
+    $$PWD/dsp/windows.h \
+    $$PWD/dsp/tone_detector.h \
+    $$PWD/dsp/eq_fit.h \
+    $$PWD/dsp/kernels.h \
+    $$PWD/dsp/kernels_impl.h \
+    $$PWD/dsp/noise_generator.h \
+    $$PWD/utility/nextpow2.h \
+    $$PWD/utility/ring_buffer.h \
+    $$PWD/utility/counting_bitset.h \
+    $$PWD/utility/counting_bitset.tcc
+
+LIBS += -ljack -lfftw3f
+
+# reports the allocations and the blocking calls of the audio thread
+rt_guard {
+    DEFINES += SP_RT_GUARD
+    LIBS += -ldl
+    QMAKE_LFLAGS += -rdynamic
+}
@@ -0,0 +1,45 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "eqexport.h"
+#include <ostream>
+#include <iomanip>
+#include <cmath>
+
+bool write_eq_apo(std::ostream &out, const Eq_Fit &fit)
+{
+    out << std::fixed << std::setprecision(1);
+    out << "Preamp: " << fit.gain_db << " dB\n";
+    unsigned number = 1;
+    for (const Eq_Section &section : fit.sections) {
+        out << "Filter " << number++ << ": ON PK Fc " << std::setprecision(1) << section.frequency
+            << " Hz Gain " << section.gain_db << " dB Q " << std::setprecision(3) << section.q << '\n';
+    }
+    return bool(out.flush());
+}
+
+bool write_eq_biquads(std::ostream &out, const Eq_Fit &fit, double sample_rate)
+{
+    out << std::setprecision(17);
+    const double gain = std::pow(10.0, fit.gain_db / 20);
+    unsigned number = 1;
+    out << "biquad" << number++ << ",\nb0=" << gain << ",\nb1=0,\nb2=0,\na1=0,\na2=0";
+    for (const Eq_Section &section : fit.sections) {
+        double coefs[5];
+        eq_section_coefficients(section, sample_rate, coefs);
+        out << ",\nbiquad" << number++ << ",\nb0=" << coefs[0] << ",\nb1=" << coefs[1] << ",\nb2=" << coefs[2]
+            << ",\na1=" << -coefs[3] << ",\na2=" << -coefs[4];
+    }
+    out << '\n';
+    return bool(out.flush());
+}
+
+bool write_fir(std::ostream &out, const float *taps, unsigned n)
+{
+    out << std::scientific << std::setprecision(9);
+    for (unsigned i = 0; i < n; ++i)
+        out << taps[i] << '\n';
+    return bool(out.flush());
+}
@@ -0,0 +1,22 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include "dsp/eq_fit.h"
+#include <iosfwd>
+
+//------------------------------------------------------------------------------
+// Writers of a fitted correction, in the formats of common equalizers, which
+// return false on an output error.
+
+// the parametric filters of Equalizer APO, with the gain as preamp
+bool write_eq_apo(std::ostream &out, const Eq_Fit &fit);
+
+// the biquads of miniDSP, whose feedback coefficients have the opposite sign,
+// with the gain as a first section
+bool write_eq_biquads(std::ostream &out, const Eq_Fit &fit, double sample_rate);
+
+// the taps of a FIR filter, one by line
+bool write_fir(std::ostream &out, const float *taps, unsigned n);
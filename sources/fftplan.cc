@@ -0,0 +1,255 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "fftplan.h"
+#include <fftw3.h>
+#include <sys/stat.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <deque>
+#include <map>
+#include <tuple>
+#include <cstdlib>
+#include <cerrno>
+#include <cassert>
+typedef std::complex<float> cfloat;
+
+struct Fft_Plan::Entry {
+    unsigned size = 0;
+    Fft_Type type = Fft_Type::Real_Forward;
+    bool aligned = true;
+    std::atomic<fftwf_plan> plan{nullptr};
+    fftwf_plan estimate = nullptr;
+    fftwf_plan measured = nullptr;
+
+    ~Entry()
+    {
+        if (estimate)
+            fftwf_destroy_plan(estimate);
+        if (measured)
+            fftwf_destroy_plan(measured);
+    }
+};
+
+unsigned Fft_Plan::size() const
+{
+    return e_->size;
+}
+
+bool Fft_Plan::measured() const
+{
+    return e_->plan.load(std::memory_order_acquire) == e_->measured;
+}
+
+void Fft_Plan::execute(float *in, cfloat *out) const
+{
+    assert(e_->type == Fft_Type::Real_Forward);
+    fftwf_plan plan = e_->plan.load(std::memory_order_acquire);
+    fftwf_execute_dft_r2c(plan, in, (fftwf_complex *)out);
+}
+
+void Fft_Plan::execute(cfloat *in, float *out) const
+{
+    assert(e_->type == Fft_Type::Real_Backward);
+    fftwf_plan plan = e_->plan.load(std::memory_order_acquire);
+    fftwf_execute_dft_c2r(plan, (fftwf_complex *)in, out);
+}
+
+//------------------------------------------------------------------------------
+struct Fft_Plan_Cache::Impl {
+    typedef std::tuple<unsigned, Fft_Type, bool> Key;
+    typedef Fft_Plan::Entry Entry;
+
+    // the FFTW planner is not thread-safe, so it is used by one thread at a
+    // time, and the requests for estimates go before the next measurement;
+    // the measurements are not limited in time, which would leave the large
+    // plans near the estimates, and their wisdom unfound by the exact lookup
+    bool planning_ = false;
+    unsigned requests_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::map<Key, std::shared_ptr<Entry>> entries_;
+    std::deque<std::shared_ptr<Entry>> queue_;
+    bool busy_ = false;
+    bool enabled_ = false;
+    bool quit_ = false;
+    std::thread thread_;
+
+    std::string wisdom_path_;
+
+    void run();
+    fftwf_plan make_plan(const Entry &e, unsigned flags);
+    static std::string cache_directory();
+    static bool make_directories(const std::string &path);
+};
+
+Fft_Plan_Cache &Fft_Plan_Cache::instance()
+{
+    static Fft_Plan_Cache cache;
+    return cache;
+}
+
+Fft_Plan_Cache::Fft_Plan_Cache()
+    : P(new Impl)
+{
+    std::string dir = Impl::cache_directory();
+    if (!dir.empty()) {
+        P->wisdom_path_ = dir + "/fftwf-wisdom";
+        fftwf_import_wisdom_from_filename(P->wisdom_path_.c_str());
+    }
+
+    P->thread_ = std::thread([this]() { P->run(); });
+}
+
+Fft_Plan_Cache::~Fft_Plan_Cache()
+{
+    {
+        std::lock_guard<std::mutex> lock(P->mutex_);
+        P->quit_ = true;
+    }
+    P->cond_.notify_all();
+    P->thread_.join();
+}
+
+Fft_Plan Fft_Plan_Cache::get(unsigned size, Fft_Type type, bool aligned)
+{
+    std::unique_lock<std::mutex> lock(P->mutex_);
+
+    Impl::Key key(size, type, aligned);
+    if (!P->entries_.count(key)) {
+        // the measurement in progress holds the planner for a short step at
+        // most, and the next one waits for the requests
+        ++P->requests_;
+        P->cond_.wait(lock, [this]() { return !P->planning_; });
+        --P->requests_;
+        P->cond_.notify_all();
+    }
+
+    // another request may have made it meanwhile
+    std::shared_ptr<Impl::Entry> &slot = P->entries_[key];
+    if (!slot) {
+        std::shared_ptr<Impl::Entry> e(new Impl::Entry);
+        e->size = size;
+        e->type = type;
+        e->aligned = aligned;
+
+        // with wisdom, the measured plan is available at once
+        e->measured = P->make_plan(*e, FFTW_MEASURE|FFTW_WISDOM_ONLY);
+        if (e->measured)
+            e->plan = e->measured;
+        else {
+            e->estimate = P->make_plan(*e, FFTW_ESTIMATE);
+            if (!e->estimate) {
+                P->entries_.erase(key);
+                throw std::bad_alloc();
+            }
+            e->plan = e->estimate;
+            P->queue_.push_back(e);
+            P->cond_.notify_all();
+        }
+        slot = e;
+    }
+
+    Fft_Plan plan;
+    plan.e_ = slot;
+    return plan;
+}
+
+void Fft_Plan_Cache::start_measuring()
+{
+    std::lock_guard<std::mutex> lock(P->mutex_);
+    P->enabled_ = true;
+    P->cond_.notify_all();
+}
+
+void Fft_Plan_Cache::wait_measured()
+{
+    std::unique_lock<std::mutex> lock(P->mutex_);
+    P->enabled_ = true;
+    P->cond_.notify_all();
+    P->cond_.wait(lock, [this]() { return P->queue_.empty() && !P->busy_; });
+}
+
+void Fft_Plan_Cache::Impl::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    for (;;) {
+        cond_.wait(lock, [this]() { return quit_ || (enabled_ && !queue_.empty() && requests_ == 0); });
+        if (quit_)
+            break;
+
+        std::shared_ptr<Entry> e = queue_.front();
+        queue_.pop_front();
+        busy_ = planning_ = true;
+        lock.unlock();
+
+        fftwf_plan measured = make_plan(*e, FFTW_MEASURE);
+        if (measured) {
+            // the estimate stays alive, it may be executing right now
+            e->measured = measured;
+            e->plan.store(measured, std::memory_order_release);
+            if (!wisdom_path_.empty())
+                fftwf_export_wisdom_to_filename(wisdom_path_.c_str());
+        }
+
+        lock.lock();
+        busy_ = planning_ = false;
+        cond_.notify_all();
+    }
+}
+
+fftwf_plan Fft_Plan_Cache::Impl::make_plan(const Entry &e, unsigned flags)
+{
+    const unsigned n = e.size;
+    if (!e.aligned)
+        flags |= FFTW_UNALIGNED;
+
+    // plan on scratch arrays, since the planner may overwrite them
+    std::unique_ptr<float[], void (*)(void *)> real(fftwf_alloc_real(n), &fftwf_free);
+    std::unique_ptr<cfloat[], void (*)(void *)> cplx((cfloat *)fftwf_alloc_complex(n / 2 + 1), &fftwf_free);
+    if (!real || !cplx)
+        throw std::bad_alloc();
+
+    switch (e.type) {
+    case Fft_Type::Real_Forward:
+        return fftwf_plan_dft_r2c_1d(n, real.get(), (fftwf_complex *)cplx.get(), flags);
+    case Fft_Type::Real_Backward:
+        return fftwf_plan_dft_c2r_1d(n, (fftwf_complex *)cplx.get(), real.get(), flags);
+    }
+    return nullptr;
+}
+
+std::string Fft_Plan_Cache::Impl::cache_directory()
+{
+    std::string dir;
+    if (const char *xdg = std::getenv("XDG_CACHE_HOME"))
+        dir = xdg;
+    else if (const char *home = std::getenv("HOME"))
+        dir = std::string(home) + "/.cache";
+    else
+        return std::string();
+
+    dir += "/spectral-profiler";
+    if (!make_directories(dir))
+        return std::string();
+    return dir;
+}
+
+bool Fft_Plan_Cache::Impl::make_directories(const std::string &path)
+{
+    // each component in turn, as the cache directory may not exist yet
+    for (size_t pos = path.find('/', 1);; pos = path.find('/', pos + 1)) {
+        std::string dir = path.substr(0, pos);
+        if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+            return false;
+        if (pos == std::string::npos)
+            return true;
+    }
+}
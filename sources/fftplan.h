@@ -0,0 +1,64 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <complex>
+#include <memory>
+
+enum class Fft_Type {
+    Real_Forward,
+    Real_Backward,
+};
+
+//------------------------------------------------------------------------------
+// Handle to a FFTW plan shared through the plan cache.
+//
+// The plan executes on the arrays given at each call, which must have the
+// alignment which the plan was requested for, and the arrays of any call are
+// allowed to overlap with none of the others. Execution is real-time safe.
+class Fft_Plan {
+public:
+    Fft_Plan() {}
+
+    explicit operator bool() const { return e_ != nullptr; }
+    unsigned size() const;
+    bool measured() const;
+
+    void execute(float *in, std::complex<float> *out) const;
+    void execute(std::complex<float> *in, float *out) const;
+
+private:
+    struct Entry;
+    std::shared_ptr<Entry> e_;
+    friend class Fft_Plan_Cache;
+};
+
+//------------------------------------------------------------------------------
+// Cache of FFTW plans keyed by size, type and alignment.
+//
+// A plan of estimate quality is returned immediately, and it is replaced by a
+// measured plan when a background thread has finished the planning. Wisdom is
+// saved to the user cache directory, to speed up the later runs.
+// The planner is not reentrant, so the background planning only starts when
+// asked, to not hold back the plans requested during the initialization, and
+// afterwards the requests go before the next measurement.
+class Fft_Plan_Cache {
+public:
+    static Fft_Plan_Cache &instance();
+    ~Fft_Plan_Cache();
+
+    Fft_Plan get(unsigned size, Fft_Type type, bool aligned = true);
+
+    void start_measuring();
+    // wait until all plans are measured
+    void wait_measured();
+
+private:
+    Fft_Plan_Cache();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> P;
+};
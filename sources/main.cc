@@ -5,32 +5,141 @@
 
 #include "application.h"
 #include "mainwindow.h"
+#include "measurement.h"
+#include "controlserver.h"
 #include "audiosys.h"
 #include "audioprocessor.h"
+#include "matrixprocessor.h"
 #include "analyzerdefs.h"
+#include "parameters.h"
+#include "fftplan.h"
+#include "rtprofiler.h"
+#include "tracer.h"
 #include <QMessageBox>
+#include <QTimer>
+#include <QStandardPaths>
+#include <QDir>
+#include <vector>
+#include <memory>
+#include <cstdio>
 
 int main(int argc, char *argv[])
 {
     Application app(argc, argv);
 
+    Audio_Sys::set_client_name(app.applicationName().toStdString());
     Audio_Sys &sys = Audio_Sys::instance();
     if (!sys) {
         QMessageBox::warning(nullptr, app.tr("Error"), app.tr("Cannot start the JACK audio system"));
         return 1;
     }
 
-    Analysis::sample_rate = sys.sample_rate();
+    Parameter_Block::instance().set_sample_rate(sys.sample_rate());
 
-    Audio_Processor proc;
-    app.setAudioProcessor(proc);
-    proc.start();
+    QStringList args = app.arguments();
+    int trace_arg = args.indexOf("--trace");
+    if (trace_arg != -1 && trace_arg + 1 < args.size())
+        Tracer::instance().start(args[trace_arg + 1].toStdString());
 
-    MainWindow window;
-    app.setMainWindow(window);
-    window.show();
+    // independent measurement loops, one per device under test
+    unsigned num_loops = 1;
+    int loops_arg = args.indexOf("--loops");
+    if (loops_arg != -1 && loops_arg + 1 < args.size())
+        num_loops = std::max(1, std::min(args[loops_arg + 1].toInt(), (int)Audio_Sys::max_loops));
+
+    // the sweeps in progress are kept here, to be resumed at the next run
+    QString data_dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (!data_dir.isEmpty() && !QDir().mkpath(data_dir))
+        data_dir.clear();
+
+    std::vector<std::unique_ptr<Audio_Processor>> procs;
+    std::vector<std::unique_ptr<Measurement>> measurements;
+    std::vector<std::unique_ptr<MainWindow>> windows;
+
+    // the ports are all registered before the client is activated, since the
+    // callback reads the loops without synchronization
+    while (sys.loop_count() < num_loops) {
+        if (!sys.add_loop()) {
+            QMessageBox::warning(nullptr, app.tr("Error"), app.tr("Cannot register the ports of loop %1").arg(sys.loop_count() + 1));
+            num_loops = sys.loop_count();
+            break;
+        }
+    }
+
+    for (unsigned loop = 0; loop < num_loops; ++loop) {
+        Audio_Processor *proc = new Audio_Processor(loop);
+        procs.emplace_back(proc);
+        if (loop == 0 && !proc->memory_locked())
+            fprintf(stderr, "warning: cannot lock the audio buffers in memory, the memlock limit may be too low\n");
+        Measurement *measurement = new Measurement;
+        measurements.emplace_back(measurement);
+        measurement->setAudioProcessor(*proc);
+        if (!data_dir.isEmpty())
+            measurement->setCheckpoint(data_dir + QString("/checkpoint-%1.dat").arg(loop + 1));
+        proc->start();
+
+        MainWindow *window = new MainWindow(*measurement);
+        windows.emplace_back(window);
+        measurement->setMainWindow(*window);
+        if (num_loops > 1)
+            window->setWindowTitle(app.tr("%1 - Loop %2").arg(app.applicationName()).arg(loop + 1));
+        window->show();
+    }
+
+    // the crosstalk between the loops is measured from the first window
+    std::unique_ptr<Matrix_Processor> matrix;
+    if (procs.size() > 1) {
+        matrix.reset(new Matrix_Processor(procs.size()));
+        matrix->start();
+        measurements[0]->setMatrixProcessor(*matrix);
+        windows[0]->enableMatrixMode(matrix->channels());
+    }
+
+    // the remote control, for the automation of test racks
+    std::unique_ptr<ControlServer> server;
+    int control_arg = args.indexOf("--control");
+    if (control_arg != -1 && control_arg + 1 < args.size()) {
+        server.reset(new ControlServer);
+        if (!server->listen(args[control_arg + 1]))
+            QMessageBox::warning(nullptr, app.tr("Error"), app.tr("Cannot listen on the control socket: %1").arg(server->errorString()));
+        for (size_t i = 0; i < measurements.size(); ++i)
+            server->addLoop(*measurements[i], *windows[i]);
+    }
+
+    // the server can change its rate or its period as it runs, and then the
+    // processors are rebuilt for it, with the cycles silent meanwhile
+    QTimer tm_config;
+    QObject::connect(&tm_config, &QTimer::timeout, [&]() {
+        if (!sys.config_changed())
+            return;
+        unsigned serial = sys.suspend();
+        Parameter_Block::instance().set_sample_rate(sys.sample_rate());
+        for (const std::unique_ptr<Audio_Processor> &proc : procs)
+            proc->reconfigure();
+        if (matrix)
+            matrix->reconfigure();
+        for (const std::unique_ptr<Measurement> &measurement : measurements)
+            measurement->audioReconfigured();
+        sys.resume(serial);
+    });
+    tm_config.start(50);
+
+    // refine the FFT plans in the background, now that all are created
+    Fft_Plan_Cache::instance().start_measuring();
 
     int code = app.exec();
     sys.stop();
+
+    if (!Tracer::instance().save())
+        QMessageBox::warning(nullptr, app.tr("Output error"), app.tr("Could not save the trace."));
+
+    if (args.contains("--dump-callback-stats")) {
+        for (const std::unique_ptr<Audio_Processor> &proc : procs) {
+            if (procs.size() > 1)
+                printf("loop %u\n", proc->loop() + 1);
+            fputs(proc->profiler().report().c_str(), stdout);
+        }
+    }
+
     return code;
 }
@@ -5,10 +5,15 @@
 
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
-#include "application.h"
+#include "measurement.h"
 #include "analyzerdefs.h"
+#include "parameters.h"
+#include "waterfallview.h"
+#include <QLabel>
+#include <QMenuBar>
 #include <qwt_scale_engine.h>
 #include <qwt_plot_curve.h>
+#include <qwt_plot_histogram.h>
 #include <qwt_plot_marker.h>
 #include <qwt_plot_grid.h>
 #include <qwt_plot_legenditem.h>
@@ -22,17 +27,28 @@ struct MainWindow::Impl {
     QwtPlotCurve *curve_lo_phase_ = nullptr;
     QwtPlotCurve *curve_hi_mag_ = nullptr;
     QwtPlotCurve *curve_hi_phase_ = nullptr;
+    QwtPlotCurve *curve_coherence_ = nullptr;
+    QwtPlotHistogram *histogram_bands_ = nullptr;
     QwtPlotMarker *marker_mag_ = nullptr;
     QwtPlotMarker *marker_phase_ = nullptr;
     QwtPlotLegendItem *legend_mag_ = nullptr;
     QwtPlotLegendItem *legend_phase_ = nullptr;
+    WaterfallView *waterfall_ = nullptr;
+    QLabel *lbl_load_ = nullptr;
+    int phase_view_ = Analysis::Phase_Wrapped;
+    int mode_ = Analysis::Mode_Sweep;
+    void setup_phase_view(int view);
+    void setup_curve_titles();
+    void setup_mode(int mode);
 };
 
-MainWindow::MainWindow(QWidget *parent)
+MainWindow::MainWindow(Measurement &measurement, QWidget *parent)
     : QMainWindow(parent), P(new Impl)
 {
     P->ui.setupUi(this);
 
+    Measurement *meas = &measurement;
+
     for (QwtPlot *plt : {P->ui.pltAmplitude, P->ui.pltPhase}) {
         plt->setAxisScale(QwtPlot::xBottom, Analysis::freq_range_min, Analysis::freq_range_max);
         plt->setAxisScaleEngine(QwtPlot::xBottom, new QwtLogScaleEngine);
@@ -75,11 +91,17 @@ MainWindow::MainWindow(QWidget *parent)
     class PhasePicker : public QwtPlotPicker {
     public:
         using QwtPlotPicker::QwtPlotPicker;
+        const int *view_ = nullptr;
 
         QwtText trackerText(const QPoint &pos) const override
         {
             QPointF xy = invTransform(pos);
-            QwtText text(QString::fromUtf8(u8"%0 Hz\n%1 π")
+            bool delay = *view_ == Analysis::Phase_Group_Delay;
+            QwtText text(delay ?
+                         QString::fromUtf8(u8"%0 Hz\n%1 ms")
+                         .arg(xy.x(), 0, 'f', 2)
+                         .arg(xy.y(), 0, 'f', 3) :
+                         QString::fromUtf8(u8"%0 Hz\n%1 π")
                          .arg(xy.x(), 0, 'f', 2)
                          .arg(xy.y() * (1.0 / M_PI), 0, 'f', 2));
             QColor bg(Qt::yellow);
@@ -91,8 +113,8 @@ MainWindow::MainWindow(QWidget *parent)
 
     AmpPicker *amp_picker = new AmpPicker(QwtPlot::xBottom, QwtPlot::yLeft, QwtPicker::CrossRubberBand, QwtPicker::AlwaysOn, P->ui.pltAmplitude->canvas());
     PhasePicker *phase_picker = new PhasePicker(QwtPlot::xBottom, QwtPlot::yLeft, QwtPicker::CrossRubberBand, QwtPicker::AlwaysOn, P->ui.pltPhase->canvas());
+    phase_picker->view_ = &P->phase_view_;
     Q_UNUSED(amp_picker);
-    Q_UNUSED(phase_picker);
     ///
 
     QwtPlotCurve *curve_hi_mag = P->curve_hi_mag_ = new QwtPlotCurve(tr("Hi Signal Gain"));
@@ -104,6 +126,20 @@ MainWindow::MainWindow(QWidget *parent)
     curve_hi_phase->setSymbol(sym_hi_phase);
     curve_hi_phase->attach(P->ui.pltPhase);
 
+    QwtPlotCurve *curve_coherence = P->curve_coherence_ = new QwtPlotCurve(tr("Coherence"));
+    curve_coherence->attach(P->ui.pltAmplitude);
+    curve_coherence->setYAxis(QwtPlot::yRight);
+    curve_coherence->setPen(Qt::cyan, 0.0, Qt::DotLine);
+    curve_coherence->setVisible(false);
+    P->ui.pltAmplitude->setAxisScale(QwtPlot::yRight, 0.0, 1.0);
+
+    QwtPlotHistogram *histogram_bands = P->histogram_bands_ = new QwtPlotHistogram(tr("Band Level"));
+    histogram_bands->attach(P->ui.pltAmplitude);
+    histogram_bands->setPen(Qt::white, 0.0, Qt::SolidLine);
+    histogram_bands->setBrush(QColor(Qt::yellow).darker(150));
+    histogram_bands->setBaseline(Analysis::rta_range_min);
+    histogram_bands->setVisible(false);
+
     QwtPlotMarker *marker_mag = P->marker_mag_ = new QwtPlotMarker;
     marker_mag->attach(P->ui.pltAmplitude);
     marker_mag->setLineStyle(QwtPlotMarker::VLine);
@@ -135,43 +171,145 @@ MainWindow::MainWindow(QWidget *parent)
         x->setFont(f);
     }
 
+    WaterfallView *waterfall = P->waterfall_ = new WaterfallView;
+    waterfall->setMagnitudeRange(Analysis::db_range_min, Analysis::db_range_max);
+    P->ui.verticalLayout_3->addWidget(waterfall);
+
     P->ui.pltAmplitude->setAxisScale(QwtPlot::yLeft, Analysis::db_range_min, Analysis::db_range_max);
     P->ui.pltPhase->setAxisScale(QwtPlot::yLeft, -M_PI, +M_PI);
 
-    P->ui.sl_gain->setValue(20 * std::log10(Analysis::global_gain));
+    P->ui.sl_gain->setValue(20 * std::log10(Parameter_Block::instance().gain()));
+
+    connect(P->ui.btn_startSweep, &QAbstractButton::clicked, meas, &Measurement::setSweepActive);
+    connect(P->ui.btn_save, &QAbstractButton::clicked, meas, &Measurement::saveProfile);
+
+    QLabel *lbl_load = P->lbl_load_ = new QLabel;
+    statusBar()->addPermanentWidget(lbl_load);
 
-    connect(P->ui.btn_startSweep, &QAbstractButton::clicked, theApplication, &Application::setSweepActive);
-    connect(P->ui.btn_save, &QAbstractButton::clicked, theApplication, &Application::saveProfile);
+    QMenu *menu_tools = menuBar()->addMenu(tr("&Tools"));
+    QAction *act_stats = menu_tools->addAction(tr("Dump &callback statistics"));
+    connect(act_stats, &QAction::triggered, meas, &Measurement::dumpCallbackStatistics);
+    QAction *act_fit = menu_tools->addAction(tr("&Fit a correction..."));
+    connect(act_fit, &QAction::triggered, meas, &Measurement::fitCorrection);
+    QAction *act_restart = menu_tools->addAction(tr("&Restart the sweep"));
+    connect(act_restart, &QAction::triggered, meas, &Measurement::restartSweep);
 
     connect(
         P->ui.sl_gain, &QwtSlider::valueChanged,
-        this, [](double v) { Analysis::global_gain = std::pow(10.0, v * 0.05); });
+        this, [](double v) { Parameter_Block::instance().set_gain(std::pow(10.0, v * 0.05)); });
 
     P->ui.btn_lo->setChecked(true);
     P->ui.btn_hi->setChecked(true);
 
     connect(
         P->ui.btn_lo, &QCheckBox::clicked,
-        this, [this](bool checked) {
-            theApplication->setSweepEnabled(checked, P->ui.btn_hi->isChecked());
-            P->curve_lo_mag_->setVisible(checked);
+        this, [this, meas](bool checked) {
+            meas->setSweepEnabled(checked, P->ui.btn_hi->isChecked());
+            P->curve_lo_mag_->setVisible(checked && P->mode_ != Analysis::Mode_Rta);
             P->curve_lo_phase_->setVisible(checked);
         });
     connect(
         P->ui.btn_hi, &QCheckBox::clicked,
-        this, [this](bool checked) {
-            theApplication->setSweepEnabled(P->ui.btn_lo->isChecked(), checked);
-            P->curve_hi_mag_->setVisible(checked);
+        this, [this, meas](bool checked) {
+            meas->setSweepEnabled(P->ui.btn_lo->isChecked(), checked);
+            P->curve_hi_mag_->setVisible(checked && P->mode_ != Analysis::Mode_Rta);
             P->curve_hi_phase_->setVisible(checked);
         });
 
-    P->ui.sp_parallel->setRange(1, Analysis::max_bins_at_once);
+    P->ui.sp_parallel->setRange(0, Analysis::max_parallel);
+    P->ui.sp_parallel->setSpecialValueText(tr("Auto"));
     connect(
         P->ui.sp_parallel, QOverload<int>::of(&QSpinBox::valueChanged),
-        this, [](int num) { theApplication->setFreqsAtOnce(num); });
+        this, [meas](int num) { meas->setFreqsAtOnce(num); });
+
+    connect(
+        P->ui.chk_adaptive, &QCheckBox::toggled,
+        this, [meas](bool checked) { meas->setAdaptiveSweep(checked); });
+
+    P->ui.sp_uncertainty->setRange(0, Analysis::max_target_uncertainty);
+    P->ui.sp_uncertainty->setSpecialValueText(tr("Fixed"));
+    connect(
+        P->ui.sp_uncertainty, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+        this, [meas](double db) { meas->setTargetUncertainty(db); });
+
+    P->ui.cb_window->addItem(tr("Hann"), Analysis::Window_Hann);
+    P->ui.cb_window->addItem(tr("Flat-top"), Analysis::Window_Flat_Top);
+    P->ui.cb_window->addItem(tr("Blackman-Harris"), Analysis::Window_Blackman_Harris);
+    connect(
+        P->ui.cb_window, QOverload<int>::of(&QComboBox::currentIndexChanged),
+        this, [this, meas](int index) {
+                  int window = P->ui.cb_window->itemData(index).toInt();
+                  meas->setAnalysisWindow(window);
+              });
+
+    P->ui.cb_mode->addItem(tr("Stepped sine"), Analysis::Mode_Sweep);
+    P->ui.cb_mode->addItem(tr("Dual channel"), Analysis::Mode_Transfer);
+    P->ui.cb_mode->addItem(tr("Real-time analyzer"), Analysis::Mode_Rta);
+    connect(
+        P->ui.cb_mode, QOverload<int>::of(&QComboBox::currentIndexChanged),
+        this, [this, meas](int index) {
+                  int mode = P->ui.cb_mode->itemData(index).toInt();
+                  P->setup_mode(mode);
+                  meas->setMeasurementMode(mode);
+              });
+
+    P->ui.cb_noise->addItem(tr("Pink"), Analysis::Noise_Pink);
+    P->ui.cb_noise->addItem(tr("White"), Analysis::Noise_White);
+    P->ui.cb_noise->addItem(tr("Periodic pink"), Analysis::Noise_Periodic_Pink);
+    connect(
+        P->ui.cb_noise, QOverload<int>::of(&QComboBox::currentIndexChanged),
+        this, [this, meas](int index) {
+                  int noise = P->ui.cb_noise->itemData(index).toInt();
+                  meas->setNoiseType(noise);
+              });
+
+    static const unsigned band_fractions[] = {3, 1, 6, 12, 24};
+    for (unsigned fraction : band_fractions)
+        P->ui.cb_bands->addItem(QString::fromUtf8(u8"1/%0 oct").arg(fraction), fraction);
+    connect(
+        P->ui.cb_bands, QOverload<int>::of(&QComboBox::currentIndexChanged),
+        this, [this, meas](int index) {
+                  unsigned fraction = P->ui.cb_bands->itemData(index).toUInt();
+                  meas->setBandResolution(fraction);
+              });
+
+    P->ui.cb_averaging->addItem(tr("Slow"), 1.0);
+    P->ui.cb_averaging->addItem(tr("Fast"), 0.125);
+    P->ui.cb_averaging->addItem(tr("10 s"), 10.0);
+    P->ui.cb_averaging->addItem(tr("Infinite"), 0.0);
+    connect(
+        P->ui.cb_averaging, QOverload<int>::of(&QComboBox::currentIndexChanged),
+        this, [this, meas](int index) {
+                  float seconds = P->ui.cb_averaging->itemData(index).toFloat();
+                  meas->setRtaTimeConstant(seconds);
+              });
 
+    static const unsigned smoothing_fractions[] = {0, 3, 6, 12, 24, 48};
+    for (unsigned fraction : smoothing_fractions) {
+        QString text = fraction ? QString::fromUtf8(u8"1/%0 oct").arg(fraction) : tr("None");
+        P->ui.cb_smoothing->addItem(text, fraction);
+    }
     connect(
-        theApplication, &Application::sweepPhaseChanged,
+        P->ui.cb_smoothing, QOverload<int>::of(&QComboBox::currentIndexChanged),
+        this, [this, meas](int index) {
+                  unsigned fraction = P->ui.cb_smoothing->itemData(index).toUInt();
+                  meas->setSmoothing(fraction);
+              });
+
+    P->ui.cb_phase_view->addItem(tr("Wrapped"), Analysis::Phase_Wrapped);
+    P->ui.cb_phase_view->addItem(tr("Unwrapped"), Analysis::Phase_Unwrapped);
+    P->ui.cb_phase_view->addItem(tr("Group delay"), Analysis::Phase_Group_Delay);
+    connect(
+        P->ui.cb_phase_view, QOverload<int>::of(&QComboBox::currentIndexChanged),
+        this, [this, meas](int index) {
+                  int view = P->ui.cb_phase_view->itemData(index).toInt();
+                  P->setup_phase_view(view);
+                  P->setup_curve_titles();
+                  meas->setPhaseView(view);
+              });
+
+    connect(
+        meas, &Measurement::sweepPhaseChanged,
         this, [this](int spl) {
                   const char *text;
                   switch (spl) {
@@ -187,6 +325,61 @@ MainWindow::~MainWindow()
 {
 }
 
+void MainWindow::enableMatrixMode(unsigned channels)
+{
+    P->ui.cb_mode->addItem(tr("Crosstalk matrix (%1 loops)").arg(channels), Analysis::Mode_Matrix);
+}
+
+bool MainWindow::selectMode(int mode)
+{
+    int index = P->ui.cb_mode->findData(mode);
+    if (index == -1)
+        return false;
+    P->ui.cb_mode->setCurrentIndex(index);
+    return true;
+}
+
+void MainWindow::selectLevels(bool lo, bool hi)
+{
+    if (P->ui.btn_lo->isChecked() != lo)
+        P->ui.btn_lo->click();
+    if (P->ui.btn_hi->isChecked() != hi)
+        P->ui.btn_hi->click();
+}
+
+void MainWindow::selectParallel(unsigned count)
+{
+    P->ui.sp_parallel->setValue(count);
+}
+
+void MainWindow::selectAdaptive(bool adaptive)
+{
+    P->ui.chk_adaptive->setChecked(adaptive);
+}
+
+void MainWindow::selectUncertainty(double db)
+{
+    P->ui.sp_uncertainty->setValue(db);
+}
+
+void MainWindow::selectWindow(int window)
+{
+    int index = P->ui.cb_window->findData(window);
+    if (index != -1)
+        P->ui.cb_window->setCurrentIndex(index);
+}
+
+void MainWindow::selectGain(double db)
+{
+    P->ui.sl_gain->setValue(db);
+}
+
+void MainWindow::selectSweepActive(bool active)
+{
+    if (P->ui.btn_startSweep->isChecked() != active)
+        P->ui.btn_startSweep->click();
+}
+
 void MainWindow::showCurrentFrequency(float f)
 {
     QString text;
@@ -215,12 +408,15 @@ void MainWindow::showProgress(float progress)
 void MainWindow::showPlotData(
     const double *freqs, double freqmark,
     const double *lo_mags, const double *lo_phases,
-    const double *hi_mags, const double *hi_phases, unsigned n)
+    const double *hi_mags, const double *hi_phases,
+    const double *coherence, unsigned n)
 {
     P->curve_lo_mag_->setRawSamples(freqs, lo_mags, n);
     P->curve_lo_phase_->setRawSamples(freqs, lo_phases, n);
     P->curve_hi_mag_->setRawSamples(freqs, hi_mags, n);
     P->curve_hi_phase_->setRawSamples(freqs, hi_phases, n);
+    if (coherence)
+        P->curve_coherence_->setRawSamples(freqs, coherence, n);
 
     P->marker_mag_->setXValue(freqmark);
     P->marker_phase_->setXValue(freqmark);
@@ -228,3 +424,119 @@ void MainWindow::showPlotData(
     P->ui.pltAmplitude->replot();
     P->ui.pltPhase->replot();
 }
+
+void MainWindow::showWaterfallColumn(const double *mags, unsigned n)
+{
+    P->waterfall_->addColumn(mags, n);
+}
+
+void MainWindow::clearWaterfall()
+{
+    P->waterfall_->clear();
+}
+
+void MainWindow::Impl::setup_phase_view(int view)
+{
+    phase_view_ = view;
+
+    QwtPlot *plt = ui.pltPhase;
+    if (view == Analysis::Phase_Wrapped)
+        plt->setAxisScale(QwtPlot::yLeft, -M_PI, +M_PI);
+    else
+        plt->setAxisAutoScale(QwtPlot::yLeft);
+}
+
+void MainWindow::Impl::setup_mode(int mode)
+{
+    mode_ = mode;
+
+    bool transfer = mode == Analysis::Mode_Transfer;
+    bool rta = mode == Analysis::Mode_Rta;
+
+    setup_curve_titles();
+    curve_coherence_->setVisible(transfer);
+    ui.pltAmplitude->enableAxis(QwtPlot::yRight, transfer);
+
+    histogram_bands_->setVisible(rta);
+    curve_lo_mag_->setVisible(!rta && ui.btn_lo->isChecked());
+    curve_hi_mag_->setVisible(!rta && ui.btn_hi->isChecked());
+    if (rta)
+        ui.pltAmplitude->setAxisScale(QwtPlot::yLeft, Analysis::rta_range_min, Analysis::rta_range_max);
+    else
+        ui.pltAmplitude->setAxisScale(QwtPlot::yLeft, Analysis::db_range_min, Analysis::db_range_max);
+    ui.pltAmplitude->replot();
+
+    QString text, description;
+    switch (mode) {
+    default:
+        text = MainWindow::tr("Start response analysis");
+        description = MainWindow::tr("Run a frequency sweep across the analysis range");
+        break;
+    case Analysis::Mode_Transfer:
+        text = MainWindow::tr("Start transfer analysis");
+        description = MainWindow::tr("Compare the measurement input with the reference input");
+        break;
+    case Analysis::Mode_Rta:
+        text = MainWindow::tr("Start real-time analysis");
+        description = MainWindow::tr("Play noise and analyze the input in fractional-octave bands");
+        break;
+    case Analysis::Mode_Matrix:
+        text = MainWindow::tr("Start matrix analysis");
+        description = MainWindow::tr("Play on all outputs at once and analyze every input");
+        break;
+    }
+    ui.btn_startSweep->setText(text);
+    ui.btn_startSweep->setDescription(description);
+}
+
+void MainWindow::Impl::setup_curve_titles()
+{
+    bool transfer = mode_ == Analysis::Mode_Transfer;
+    bool matrix = mode_ == Analysis::Mode_Matrix;
+    bool delay = phase_view_ == Analysis::Phase_Group_Delay;
+
+    QString lo = transfer ? QString("H2") : matrix ? MainWindow::tr("Crosstalk") : MainWindow::tr("Lo Signal");
+    QString hi = transfer ? QString("H1") : matrix ? MainWindow::tr("Direct") : MainWindow::tr("Hi Signal");
+    QString gain = MainWindow::tr("Gain");
+    QString phase = delay ? MainWindow::tr("Group Delay") : MainWindow::tr("Phase");
+
+    curve_lo_mag_->setTitle(lo + ' ' + gain);
+    curve_hi_mag_->setTitle(hi + ' ' + gain);
+    curve_lo_phase_->setTitle(lo + ' ' + phase);
+    curve_hi_phase_->setTitle(hi + ' ' + phase);
+}
+
+void MainWindow::showBands(const double *centers, const double *levels, unsigned n, unsigned fraction)
+{
+    const double half_band = std::exp2(0.5 / fraction);
+
+    QVector<QwtIntervalSample> samples(n);
+    for (unsigned b = 0; b < n; ++b) {
+        double fc = centers[b];
+        samples[b] = QwtIntervalSample(levels[b], fc / half_band, fc * half_band);
+    }
+
+    P->histogram_bands_->setSamples(samples);
+    P->ui.pltAmplitude->replot();
+}
+
+void MainWindow::showAutoParallelism(const unsigned *lo, const unsigned *hi, unsigned regions)
+{
+    auto format = [regions](const unsigned *density) -> QString {
+        QStringList list;
+        for (unsigned r = 0; r < regions; ++r)
+            list.append(density[r] ? QString::number(density[r]) : QString("?"));
+        return list.join(' ');
+    };
+
+    P->ui.sp_parallel->setToolTip(
+        tr("Automatic parallelism by region, from low to high frequency\nLo: %1\nHi: %2")
+        .arg(format(lo)).arg(format(hi)));
+}
+
+void MainWindow::showCallbackLoad(double load, double worst_load, unsigned long xruns)
+{
+    P->lbl_load_->setText(
+        tr("DSP load %1% (worst %2%), %3 xruns")
+        .arg(100 * load, 0, 'f', 1).arg(100 * worst_load, 0, 'f', 1).arg(xruns));
+}
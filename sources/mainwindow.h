@@ -5,21 +5,40 @@
 
 #include <QMainWindow>
 #include <memory>
+class Measurement;
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
 
 public:
-    explicit MainWindow(QWidget *parent = nullptr);
+    explicit MainWindow(Measurement &measurement, QWidget *parent = nullptr);
     ~MainWindow();
 
+    void enableMatrixMode(unsigned channels);
+
+    // operate the controls, as the user would, for the remote control
+    bool selectMode(int mode);
+    void selectLevels(bool lo, bool hi);
+    void selectParallel(unsigned count);
+    void selectAdaptive(bool adaptive);
+    void selectUncertainty(double db);
+    void selectWindow(int window);
+    void selectGain(double db);
+    void selectSweepActive(bool active);
+
     void showCurrentFrequency(float f);
     void showLevels(float in, float out);
     void showProgress(float progress);
     void showPlotData(
         const double *freqs, double freqmark,
         const double *lo_mags, const double *lo_phases,
-        const double *hi_mags, const double *hi_phases, unsigned n);
+        const double *hi_mags, const double *hi_phases,
+        const double *coherence, unsigned n);
+    void showWaterfallColumn(const double *mags, unsigned n);
+    void clearWaterfall();
+    void showBands(const double *centers, const double *levels, unsigned n, unsigned fraction);
+    void showAutoParallelism(const unsigned *lo, const unsigned *hi, unsigned regions);
+    void showCallbackLoad(double load, double worst_load, unsigned long xruns);
 
 private:
     struct Impl;
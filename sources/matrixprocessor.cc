@@ -0,0 +1,314 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "matrixprocessor.h"
+#include "audiosys.h"
+#include "analyzerdefs.h"
+#include "messages.h"
+#include "processorchannel.h"
+#include "multitone.h"
+#include "rtprofiler.h"
+#include "rtarena.h"
+#include "dsp/kernels.h"
+#include "utility/nextpow2.h"
+#include "utility/ring_buffer.h"
+#include <algorithm>
+#include <complex>
+#include <cstdlib>
+#include <cmath>
+#include <cassert>
+
+struct Matrix_Processor::Impl {
+    void configure();
+    static bool process(const float *const *in, float *const *out, unsigned nloops, unsigned n, void *userdata);
+    void process_message(const Basic_Message &hmsg);
+    void generate(float *const *out, unsigned n);
+    void collect(const float *const *in, unsigned n);
+    void analyze_next();
+    bool send_result();
+    void update_level(float *const *out, unsigned n);
+
+    unsigned channels_ = 0;
+
+    // the kernels for this processor, chosen before the audio thread runs
+    const Dsp_Kernels *kernels_ = nullptr;
+
+    // peak level of the outputs, which decays with the release of the meter
+    float amp_decay_ = 0;
+    float out_amp_ = 0;
+
+    // the messages and the parameters of the cycle, shared with the
+    // control thread
+    Processor_Channel channel_;
+
+    // the buffers of the audio thread, in memory locked at configuration
+    Rt_Arena arena_;
+
+    Message_Buffer result_buf_;
+
+    bool active_ = false;
+    bool gen_can_start_ = false;
+    bool gen_has_finished_ = false;
+    int gen_spl_ = Analysis::Signal_Lo;
+    uint32_t gen_version_ = 0;
+    uint64_t frames_ = 0;
+    unsigned fft_size_ = 0;
+
+    // the tones of all the outputs, and their analysis at every input, of
+    // which one period at most is analyzed per cycle
+    Multitone_Generator gen_;
+    Multitone_Analyzer analyzers_[Analysis::max_matrix_channels];
+    unsigned next_analyzed_ = 0;
+
+    std::unique_ptr<Rt_Profiler> profiler_;
+};
+
+Matrix_Processor::Matrix_Processor(unsigned channels)
+    : P(new Impl)
+{
+    P->channels_ = std::min<unsigned>(channels, Analysis::max_matrix_channels);
+    P->profiler_.reset(new Rt_Profiler(Analysis::sample_rate));
+    P->configure();
+}
+
+Matrix_Processor::~Matrix_Processor()
+{
+}
+
+void Matrix_Processor::Impl::configure()
+{
+    const unsigned channels = channels_;
+    const float sr = Analysis::sample_rate;
+
+    kernels_ = &dsp_kernels();
+    amp_decay_ = std::exp(-1 / (50e-3f * sr));
+
+    const unsigned fft_size = nextpow2(std::ceil(0.5f * sr));
+    const unsigned nb = Analysis::max_bins_at_once;
+    const size_t result_size = Messages::NotifyMatrixAnalysis::size_for(nb, channels);
+
+    Rt_Arena &arena = arena_;
+    arena.reset(
+        Processor_Channel::footprint() +
+        Rt_Arena::footprint<uint8_t>(result_size) +
+        Multitone_Generator::footprint(nb) +
+        channels * Multitone_Analyzer::footprint(nb, fft_size));
+
+    channel_.configure(arena, sr);
+    result_buf_.attach(arena.allocate<uint8_t>(result_size), result_size);
+
+    // the transform by default, or the detector named by the environment
+    fft_size_ = fft_size;
+    gen_.configure(arena, nb, fft_size, channels);
+    for (unsigned c = 0; c < channels; ++c)
+        analyzers_[c].configure(arena, nb, fft_size, getenv("SP_DETECTOR"));
+}
+
+void Matrix_Processor::start()
+{
+    Audio_Sys &sys = Audio_Sys::instance();
+    sys.start_group(&Impl::process, this);
+}
+
+void Matrix_Processor::reconfigure()
+{
+    std::unique_ptr<Impl> impl(new Impl);
+    impl->channels_ = P->channels_;
+    impl->profiler_ = std::move(P->profiler_);
+    impl->profiler_->set_sample_rate(Analysis::sample_rate);
+    impl->configure();
+    P = std::move(impl);
+}
+
+unsigned Matrix_Processor::channels() const
+{
+    return P->channels_;
+}
+
+unsigned Matrix_Processor::fft_size() const
+{
+    return P->fft_size_;
+}
+
+const Rt_Profiler &Matrix_Processor::profiler() const
+{
+    return *P->profiler_;
+}
+
+void Matrix_Processor::send_message(const Basic_Message &hmsg)
+{
+    P->channel_.send_message(hmsg);
+}
+
+Basic_Message *Matrix_Processor::receive_message()
+{
+    return P->channel_.receive_message();
+}
+
+bool Matrix_Processor::Impl::process(const float *const *in, float *const *out, unsigned nloops, unsigned n, void *userdata)
+{
+    Matrix_Processor *self = (Matrix_Processor *)userdata;
+    Impl *P = self->P.get();
+    Rt_Profiler &prof = *P->profiler_;
+
+    prof.begin_cycle(n);
+
+    {
+        Rt_Profiler::Scope scope(prof, Rt_Profiler::Stage_Messages);
+        P->channel_.update_parameters();
+        P->channel_.handle_messages([P](const Basic_Message &hmsg) { P->process_message(hmsg); });
+    }
+
+    // leave the loops to their own processing while inactive
+    if (!P->active_ || nloops < P->channels_) {
+        P->channel_.gain_ramp().skip(n);
+        P->frames_ += n;
+        prof.end_cycle();
+        return false;
+    }
+
+    for (unsigned c = 0; c < nloops; ++c)
+        std::fill_n(out[c], n, 0);
+
+    if (P->gen_can_start_) {
+        {
+            Rt_Profiler::Scope scope(prof, Rt_Profiler::Stage_Collect);
+            P->collect(in, n);
+        }
+        Rt_Profiler::Scope scope(prof, Rt_Profiler::Stage_Response);
+        P->analyze_next();
+        if (!P->gen_has_finished_)
+            P->gen_has_finished_ = P->send_result();
+    }
+
+    // the capture starts in silence, once the gain has settled
+    if (!P->gen_can_start_ && P->out_amp_ < Analysis::silence_threshold && !P->channel_.gain_ramp().active()) {
+        P->gen_can_start_ = true;
+        P->gen_version_ = P->channel_.params().version;
+        P->gen_.mark_start();
+        for (unsigned c = 0, channels = P->channels_; c < channels; ++c)
+            P->analyzers_[c].start_capture(P->frames_ + n);
+    }
+
+    if (P->gen_can_start_) {
+        Rt_Profiler::Scope scope(prof, Rt_Profiler::Stage_Generate);
+        P->generate(out, n);
+    }
+    else
+        P->channel_.gain_ramp().skip(n);
+
+    {
+        Rt_Profiler::Scope scope(prof, Rt_Profiler::Stage_Levels);
+        P->update_level(out, n);
+    }
+
+    P->frames_ += n;
+
+    prof.end_cycle();
+    return true;
+}
+
+void Matrix_Processor::Impl::process_message(const Basic_Message &hmsg)
+{
+    float sr = channel_.params().sample_rate;
+    unsigned channels = channels_;
+
+    switch (hmsg.tag) {
+    case Message_Tag::RequestMatrixAnalysis: {
+        auto *msg = (Messages::RequestMatrixAnalysis *)&hmsg;
+        active_ = true;
+        gen_can_start_ = false;
+        gen_has_finished_ = false;
+        gen_spl_ = msg->spl;
+        gen_.set_tones(msg->frequency(), msg->output(), msg->num_bins, sr);
+        for (unsigned c = 0; c < channels; ++c)
+            analyzers_[c].begin_step(gen_, msg->window, msg->uncertainty, frames_);
+        next_analyzed_ = 0;
+        break;
+    }
+    case Message_Tag::RequestStop:
+        active_ = false;
+        for (unsigned c = 0; c < channels; ++c)
+            analyzers_[c].end_sweep();
+        break;
+    default:
+        assert(false);
+        break;
+    }
+}
+
+void Matrix_Processor::Impl::generate(float *const *out, unsigned n)
+{
+    gen_.generate(out, n);
+
+    // the same gain for all outputs
+    const float amp = Analysis::spl_amplitude(gen_spl_);
+    for (unsigned i = 0; i < n; ++i) {
+        const float g = amp * channel_.gain_ramp().process();
+        for (unsigned c = 0, channels = channels_; c < channels; ++c)
+            out[c][i] *= g;
+    }
+}
+
+void Matrix_Processor::Impl::collect(const float *const *in, unsigned n)
+{
+    // an input which waits for the analysis of its period starts the next
+    // one later, as the analyzer places each period by its first frame
+    for (unsigned c = 0, channels = channels_; c < channels; ++c)
+        analyzers_[c].collect(in[c], n, frames_);
+}
+
+void Matrix_Processor::Impl::analyze_next()
+{
+    // spread the transforms over the cycles, in turn among the inputs
+    const unsigned channels = channels_;
+    for (unsigned i = 0; i < channels; ++i) {
+        unsigned c = (next_analyzed_ + i) % channels;
+        if (analyzers_[c].block_ready()) {
+            analyzers_[c].analyze_block();
+            next_analyzed_ = c + 1;
+            return;
+        }
+    }
+}
+
+bool Matrix_Processor::Impl::send_result()
+{
+    const unsigned channels = channels_;
+    for (unsigned c = 0; c < channels; ++c) {
+        if (!analyzers_[c].complete())
+            return false;
+    }
+
+    Ring_Buffer &rb_out = channel_.output();
+    const unsigned num_bins = gen_.count();
+    if (Messages::NotifyMatrixAnalysis::size_for(num_bins, channels) >= rb_out.size_free())
+        return false;
+
+    auto &msg = result_buf_.emplace<Messages::NotifyMatrixAnalysis>(num_bins, channels);
+    msg.spl = gen_spl_;
+    msg.version = (channel_.params().version == gen_version_) ? gen_version_ : 0;
+    const float amp = Analysis::spl_amplitude(gen_spl_) * channel_.gain_ramp().current();
+    for (unsigned c = 0; c < channels; ++c)
+        analyzers_[c].compute_response(msg.response(c), nullptr, amp);
+    float *frequency = msg.frequency();
+    unsigned *output = msg.output();
+    for (unsigned a = 0; a < num_bins; ++a) {
+        frequency[a] = gen_.frequency(a) * channel_.params().sample_rate;
+        output[a] = gen_.output(a);
+    }
+    rb_out.put((uint8_t *)&msg, msg.size);
+    return true;
+}
+
+void Matrix_Processor::Impl::update_level(float *const *out, unsigned n)
+{
+    // the envelope of the loudest output is the loudest of their envelopes
+    float out_amp = 0;
+    for (unsigned c = 0, channels = channels_; c < channels; ++c)
+        out_amp = std::max(out_amp, kernels_->peak_envelope(out[c], n, amp_decay_, out_amp_));
+
+    out_amp_ = out_amp;
+}
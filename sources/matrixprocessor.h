@@ -0,0 +1,37 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <memory>
+struct Basic_Message;
+class Rt_Profiler;
+
+//------------------------------------------------------------------------------
+// Measurement of the transfer matrix between the outputs and the inputs of
+// several loops. All outputs play at once, each at its own set of frequencies,
+// and all inputs are analyzed at every frequency played, in the same way as
+// the sweep of a single loop.
+class Matrix_Processor {
+public:
+    explicit Matrix_Processor(unsigned channels);
+    ~Matrix_Processor();
+    void start();
+
+    // rebuilds the buffers for the current rate, while the audio system
+    // holds the cycles, and drops the step in progress
+    void reconfigure();
+
+    unsigned channels() const;
+    unsigned fft_size() const;
+
+    const Rt_Profiler &profiler() const;
+
+    void send_message(const Basic_Message &hmsg);
+    Basic_Message *receive_message();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> P;
+};
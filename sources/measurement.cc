@@ -0,0 +1,977 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "measurement.h"
+#include "mainwindow.h"
+#include "audioprocessor.h"
+#include "matrixprocessor.h"
+#include "transferanalyzer.h"
+#include "bandanalyzer.h"
+#include "rtprofiler.h"
+#include "tracer.h"
+#include "sweepscheduler.h"
+#include "sweepcheckpoint.h"
+#include "analyzerdefs.h"
+#include "messages.h"
+#include "eqexport.h"
+#include "dsp/octave_smoother.h"
+#include "dsp/eq_fit.h"
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QTimer>
+#include <QDebug>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <algorithm>
+#include <iomanip>
+#include <complex>
+#include <cmath>
+#include <cassert>
+typedef std::complex<float> cfloat;
+typedef std::complex<double> cdouble;
+
+struct Measurement::Impl {
+    Measurement *self_ = nullptr;
+    Audio_Processor *proc_ = nullptr;
+    Matrix_Processor *matrix_ = nullptr;
+    MainWindow *mainwindow_ = nullptr;
+    QTimer *tm_rtupdates_ = nullptr;
+    QTimer *tm_nextsweep_ = nullptr;
+
+    Sweep_Checkpoint checkpoint_;
+    Sweep_Scheduler sched_;
+    double an_waterfall_[Analysis::sweep_length] = {};
+
+    std::unique_ptr<double[]> an_lo_plot_mags_;
+    std::unique_ptr<double[]> an_lo_plot_phases_;
+    std::unique_ptr<double[]> an_hi_plot_mags_;
+    std::unique_ptr<double[]> an_hi_plot_phases_;
+
+    Octave_Smoother an_lo_smoother_;
+    Octave_Smoother an_hi_smoother_;
+    std::unique_ptr<double[]> an_unwrapped_;
+    int phase_view_ = Analysis::Phase_Wrapped;
+
+    std::unique_ptr<double[]> an_coherence_;
+    std::unique_ptr<float[]> an_coherence_buf_;
+
+    // transfer matrix on the coarse grid, by point, input and output
+    unsigned mx_channels_ = 0;
+    unsigned mx_pass_ = 0;
+    // the noise floor of the inputs, which sets the length of the captures,
+    // is measured at the start of the sweep
+    bool mx_noise_due_ = true;
+    unsigned mx_points_[Analysis::max_bins_at_once] = {};
+    unsigned mx_outputs_[Analysis::max_bins_at_once] = {};
+    unsigned mx_num_points_ = 0;
+    std::unique_ptr<cfloat[]> mx_response_;
+    std::unique_ptr<bool[]> mx_valid_;
+
+    int rta_noise_ = Analysis::Noise_Pink;
+    unsigned rta_num_bands_ = 0;
+    double rta_centers_[Analysis::max_bands] = {};
+    double rta_levels_[Analysis::max_bands] = {};
+
+    bool sweep_active_ = false;
+    int mode_ = Analysis::Mode_Sweep;
+    // the rate which the grid was made for
+    double sample_rate_ = 0;
+
+    unsigned rt_stats_countdown_ = 0;
+    uint32_t trace_step_ = 0;
+    Message_Buffer request_buf_;
+    void set_sweep_phase(int spl);
+    void schedule_next_sweep();
+    void show_auto_parallelism();
+    void reset_grid();
+    void regrid_smoothers();
+    void show_resumed_sweep();
+    const double *waterfall_column(const double *plot_mags);
+    void update_plot_data(int spl);
+    void update_transfer_function();
+    unsigned plan_matrix_step(unsigned *points, unsigned *outputs);
+    void matrix_result(const Messages::NotifyMatrixAnalysis &msg);
+    void start_noise_analysis();
+};
+
+Measurement::Measurement(QObject *parent)
+    : QObject(parent), P(new Impl)
+{
+    P->self_ = this;
+
+    QTimer *tm;
+
+    tm = P->tm_rtupdates_ = new QTimer(this);
+    connect(tm, &QTimer::timeout, this, &Measurement::realtimeUpdateTick);
+    tm->start(50);
+
+    tm = P->tm_nextsweep_ = new QTimer(this);
+    tm->setSingleShot(true);
+    connect(tm, &QTimer::timeout, this, &Measurement::nextSweepTick);
+}
+
+Measurement::~Measurement()
+{
+}
+
+void Measurement::setAudioProcessor(Audio_Processor &proc)
+{
+    P->proc_ = &proc;
+
+    const unsigned nc = Analysis::sweep_capacity;
+    P->an_lo_plot_mags_.reset(new double[nc]());
+    P->an_lo_plot_phases_.reset(new double[nc]());
+    P->an_hi_plot_mags_.reset(new double[nc]());
+    P->an_hi_plot_phases_.reset(new double[nc]());
+    P->an_unwrapped_.reset(new double[nc]());
+
+    P->an_coherence_.reset(new double[nc]());
+    P->an_coherence_buf_.reset(new float[nc]());
+
+    // the generator rounds the frequencies to the bins of the analysis
+    P->sched_.set_resolution(Analysis::sample_rate / proc.fft_size());
+    P->sample_rate_ = Analysis::sample_rate;
+
+    P->reset_grid();
+    proc.transfer_analyzer().set_frequencies(P->sched_.frequencies(), P->sched_.size(), Analysis::sample_rate);
+}
+
+void Measurement::setMatrixProcessor(Matrix_Processor &proc)
+{
+    P->matrix_ = &proc;
+
+    const unsigned nc = proc.channels();
+    const unsigned size = Analysis::sweep_length * nc * nc;
+    P->mx_channels_ = nc;
+    P->mx_response_.reset(new cfloat[size]());
+    P->mx_valid_.reset(new bool[size]());
+}
+
+void Measurement::setMainWindow(MainWindow &win)
+{
+    P->mainwindow_ = &win;
+}
+
+void Measurement::setCheckpoint(const QString &path)
+{
+    if (!P->checkpoint_.open(path.toStdString())) {
+        qWarning() << "Cannot open the sweep checkpoint" << path;
+        return;
+    }
+    P->sched_.set_checkpoint(&P->checkpoint_);
+}
+
+void Measurement::audioReconfigured()
+{
+    Audio_Processor &proc = *P->proc_;
+
+    // at the same rate, the grid and the results stay, and the step lost with
+    // the old processors is measured again, as one disturbed by a change of
+    // parameters; the other modes start their analysis over
+    if (Analysis::sample_rate == P->sample_rate_) {
+        proc.transfer_analyzer().set_frequencies(P->sched_.frequencies(), P->sched_.size(), Analysis::sample_rate);
+        proc.start_analyzers();
+        if (!P->sweep_active_)
+            return;
+        if (P->mode_ == Analysis::Mode_Sweep || P->mode_ == Analysis::Mode_Matrix)
+            P->schedule_next_sweep();
+        else {
+            setSweepActive(false);
+            setSweepActive(true);
+        }
+        return;
+    }
+
+    bool active = P->sweep_active_;
+    if (active)
+        setSweepActive(false);
+
+    // the grid restarts at the resolution of the new rate, and the checkpoint
+    // of the old rate is not resumed
+    P->sched_.set_resolution(Analysis::sample_rate / proc.fft_size());
+    P->sample_rate_ = Analysis::sample_rate;
+    P->reset_grid();
+    proc.transfer_analyzer().set_frequencies(P->sched_.frequencies(), P->sched_.size(), Analysis::sample_rate);
+    proc.start_analyzers();
+
+    if (P->matrix_) {
+        const unsigned nc = P->mx_channels_;
+        const unsigned size = Analysis::sweep_length * nc * nc;
+        std::fill_n(P->mx_response_.get(), size, cfloat());
+        std::fill_n(P->mx_valid_.get(), size, false);
+        P->mx_pass_ = 0;
+        P->mx_noise_due_ = true;
+    }
+
+    P->update_plot_data(Analysis::Signal_Lo);
+    P->update_plot_data(Analysis::Signal_Hi);
+    replotResponses();
+    P->mainwindow_->showProgress(0);
+    if (active)
+        setSweepActive(true);
+}
+
+void Measurement::setSweepEnabled(bool lo, bool hi)
+{
+    Sweep_Scheduler &sched = P->sched_;
+    bool was_lo = sched.level_enabled(Analysis::Signal_Lo);
+    bool was_hi = sched.level_enabled(Analysis::Signal_Hi);
+    if (lo == was_lo && hi == was_hi)
+        return;
+
+    bool disabled = !was_lo && !was_hi;
+    sched.set_levels(lo, hi);
+    P->mainwindow_->showProgress(0);
+
+    if (disabled) {
+        int next = sched.next_level(sched.level());
+        if (next != -1) {
+            P->set_sweep_phase(next);
+            P->schedule_next_sweep();
+        }
+    }
+}
+
+void Measurement::setFreqsAtOnce(unsigned count)
+{
+    P->sched_.set_freqs_at_once(count);
+    if (count == 0)
+        P->show_auto_parallelism();
+}
+
+void Measurement::setAdaptiveSweep(bool adaptive)
+{
+    if (P->sched_.adaptive() == adaptive)
+        return;
+
+    bool active = P->sweep_active_;
+    if (active)
+        setSweepActive(false);
+    P->sched_.set_adaptive(adaptive);
+    P->reset_grid();
+    P->update_plot_data(Analysis::Signal_Lo);
+    P->update_plot_data(Analysis::Signal_Hi);
+    replotResponses();
+    if (active)
+        setSweepActive(true);
+}
+
+void Measurement::setTargetUncertainty(double db)
+{
+    P->sched_.set_target_uncertainty(db);
+}
+
+void Measurement::setAnalysisWindow(int window)
+{
+    P->sched_.set_window(window);
+}
+
+void Measurement::setMeasurementMode(int mode)
+{
+    if (P->mode_ == mode)
+        return;
+
+    bool active = P->sweep_active_;
+    if (active)
+        setSweepActive(false);
+    P->mode_ = mode;
+    // the dual channel and matrix analyses work on the coarse grid
+    bool coarse = mode == Analysis::Mode_Transfer || mode == Analysis::Mode_Matrix;
+    if (coarse && P->sched_.size() != Analysis::sweep_length)
+        P->reset_grid();
+    if (active)
+        setSweepActive(true);
+}
+
+void Measurement::setNoiseType(int noise)
+{
+    P->rta_noise_ = noise;
+    if (P->sweep_active_ && P->mode_ == Analysis::Mode_Rta)
+        P->start_noise_analysis();
+}
+
+void Measurement::setBandResolution(unsigned fraction)
+{
+    P->proc_->band_analyzer().set_resolution(fraction);
+}
+
+void Measurement::setRtaTimeConstant(float seconds)
+{
+    P->proc_->band_analyzer().set_time_constant(seconds);
+}
+
+void Measurement::setSmoothing(unsigned fraction)
+{
+    P->an_lo_smoother_.set_fraction(fraction);
+    P->an_hi_smoother_.set_fraction(fraction);
+    P->update_plot_data(Analysis::Signal_Lo);
+    P->update_plot_data(Analysis::Signal_Hi);
+    replotResponses();
+}
+
+void Measurement::setPhaseView(int view)
+{
+    P->phase_view_ = view;
+    P->update_plot_data(Analysis::Signal_Lo);
+    P->update_plot_data(Analysis::Signal_Hi);
+    replotResponses();
+}
+
+void Measurement::setSweepActive(bool active)
+{
+    if (P->sweep_active_ == active)
+        return;
+
+    P->sweep_active_ = active;
+    if (!active) {
+        P->tm_nextsweep_->stop();
+
+        Messages::RequestStop msg;
+        P->proc_->send_message(msg);
+        if (P->matrix_)
+            P->matrix_->send_message(msg);
+    }
+    else if (P->mode_ == Analysis::Mode_Rta) {
+        P->proc_->band_analyzer().request_reset();
+        P->start_noise_analysis();
+    }
+    else if (P->mode_ == Analysis::Mode_Transfer) {
+        P->proc_->transfer_analyzer().request_reset();
+
+        Messages::RequestTransferAnalysis msg;
+        P->proc_->send_message(msg);
+    }
+    else {
+        if (P->mode_ == Analysis::Mode_Sweep && P->sched_.resume())
+            P->show_resumed_sweep();
+        else
+            P->sched_.restart();
+        P->mx_pass_ = 0;
+        P->mx_noise_due_ = true;
+        P->mainwindow_->showProgress(P->sched_.completion());
+        P->schedule_next_sweep();
+    }
+}
+
+void Measurement::restartSweep()
+{
+    P->sched_.restart();
+    if (P->checkpoint_.is_open())
+        P->checkpoint_.clear();
+    P->mx_pass_ = 0;
+    P->mx_noise_due_ = true;
+    P->mainwindow_->clearWaterfall();
+    P->mainwindow_->showProgress(0);
+}
+
+static bool read_curve(const QString &filename, std::vector<double> &freqs, std::vector<double> &values)
+{
+    std::ifstream file(filename.toLocal8Bit().data());
+    std::string line;
+    while (std::getline(file, line)) {
+        double f, v;
+        if (std::sscanf(line.c_str(), "%lf %lf", &f, &v) != 2 || !(f > 0))
+            continue;
+        if (!freqs.empty() && f <= freqs.back())
+            return false;
+        freqs.push_back(f);
+        values.push_back(v);
+    }
+    return !file.bad() && !freqs.empty();
+}
+
+void Measurement::fitCorrection()
+{
+    if (P->mode_ != Analysis::Mode_Sweep) {
+        QMessageBox::warning(P->mainwindow_, tr("Correction"), tr("The correction is fitted to the responses of the sweep."));
+        return;
+    }
+
+    QString filename = QFileDialog::getSaveFileName(
+        P->mainwindow_, tr("Save correction"),
+        QString(),
+        tr("Correction (*.correction)"));
+
+    if (filename.isEmpty())
+        return;
+
+    // the target is flat, unless a curve of frequencies and levels in dB is given
+    QString target_filename = QFileDialog::getOpenFileName(
+        P->mainwindow_, tr("Open target curve, or cancel for a flat target"),
+        QString(),
+        tr("Curve (*.dat *.txt)"));
+
+    const Sweep_Scheduler &sched = P->sched_;
+    const unsigned ns = sched.size();
+    const double *freqs = sched.frequencies();
+
+    std::vector<double> target;
+    if (!target_filename.isEmpty()) {
+        std::vector<double> curve_freqs, curve_values;
+        if (!read_curve(target_filename, curve_freqs, curve_values)) {
+            QMessageBox::warning(P->mainwindow_, tr("Input error"), tr("Could not read the target curve."));
+            return;
+        }
+        target.resize(ns);
+        resample_curve(curve_freqs.data(), curve_values.data(), (unsigned)curve_freqs.size(), freqs, target.data(), ns);
+    }
+
+    QDir(filename).mkpath(".");
+
+    Eq_Fit_Params params;
+    params.sample_rate = Analysis::sample_rate;
+    const unsigned fir_taps = 4096;
+    std::vector<float> taps(fir_taps);
+
+    // the curves as shown, with their smoothing
+    const double *plot_mags[] = {P->an_lo_plot_mags_.get(), P->an_hi_plot_mags_.get()};
+    const char *names[] = {"lo", "hi"};
+    QString summary;
+
+    for (int spl : {Analysis::Signal_Lo, Analysis::Signal_Hi}) {
+        if (!sched.level_enabled(spl))
+            continue;
+        Eq_Fit fit = fit_eq(freqs, plot_mags[spl], sched.valid(spl), target.empty() ? nullptr : target.data(), ns, params);
+        design_min_phase_fir(fit.frequencies.data(), fit.correction_db.data(), (unsigned)fit.frequencies.size(),
+                             params.sample_rate, taps.data(), fir_taps);
+
+        QString base = filename + "/" + names[spl];
+        std::ofstream apo((base + "-eq.txt").toLocal8Bit().data());
+        std::ofstream biquads((base + "-biquads.txt").toLocal8Bit().data());
+        std::ofstream fir((base + "-fir.txt").toLocal8Bit().data());
+        if (!write_eq_apo(apo, fit) || !write_eq_biquads(biquads, fit, params.sample_rate) ||
+            !write_fir(fir, taps.data(), fir_taps)) {
+            QMessageBox::warning(P->mainwindow_, tr("Output error"), tr("Could not save the correction."));
+            return;
+        }
+        summary += tr("%1: %2 sections, preamp %3 dB, %4 dB rms of error\n")
+            .arg(names[spl]).arg(fit.sections.size()).arg(fit.gain_db, 0, 'f', 1).arg(fit.error_db, 0, 'f', 2);
+    }
+
+    QMessageBox box(QMessageBox::Information, tr("Correction"),
+                    tr("The correction was saved."),
+                    QMessageBox::Ok, P->mainwindow_);
+    box.setDetailedText(summary);
+    box.exec();
+}
+
+void Measurement::saveProfile()
+{
+    QString filename = QFileDialog::getSaveFileName(
+        P->mainwindow_, tr("Save profile"),
+        QString(),
+        tr("Profile (*.profile)"));
+
+    if (filename.isEmpty())
+        return;
+
+    QDir(filename).mkpath(".");
+
+    const Sweep_Scheduler &sched = P->sched_;
+    const double *freqs = sched.frequencies();
+    const cfloat *responses[] = {
+        sched.response(Analysis::Signal_Lo),
+        sched.response(Analysis::Signal_Hi),
+    };
+    const float *snrs[] = {
+        sched.snr(Analysis::Signal_Lo),
+        sched.snr(Analysis::Signal_Hi),
+    };
+    bool response_enabled[] = {
+        sched.level_enabled(Analysis::Signal_Lo),
+        sched.level_enabled(Analysis::Signal_Hi),
+    };
+    bool sweep = P->mode_ == Analysis::Mode_Sweep;
+    bool transfer = P->mode_ == Analysis::Mode_Transfer;
+    bool matrix = P->mode_ == Analysis::Mode_Matrix;
+    const char *response_names[] = {
+        transfer ? "h2" : matrix ? "crosstalk" : "lo",
+        transfer ? "h1" : matrix ? "direct" : "hi",
+    };
+
+    for (unsigned r = 0; r < 2; ++r) {
+        if (!response_enabled[r])
+            continue;
+        std::ofstream file((filename + "/" + response_names[r] + ".dat").toLocal8Bit().data());
+        file << std::scientific << std::setprecision(10);
+        for (unsigned i = 0; i < sched.size(); ++i) {
+            double freq = freqs[i];
+            cfloat response = responses[r][i];
+            file << freq << ' ' << std::abs(response) << ' ' << std::arg(response);
+            // the stepped sine adds the SNR of the point, and the uncertainty in dB
+            if (sweep) {
+                double snr = snrs[r][i];
+                file << ' ' << snr << ' ' << Analysis::snr_uncertainty_db(snr);
+            }
+            file << '\n';
+        }
+        if (!file.flush()) {
+            QMessageBox::warning(P->mainwindow_, tr("Output error"), tr("Could not save profile data."));
+            return;
+        }
+    }
+
+    if (P->mode_ == Analysis::Mode_Rta) {
+        std::ofstream file((filename + "/bands.dat").toLocal8Bit().data());
+        file << std::scientific << std::setprecision(10);
+        for (unsigned b = 0; b < P->rta_num_bands_; ++b)
+            file << P->rta_centers_[b] << ' ' << P->rta_levels_[b] << '\n';
+        if (!file.flush()) {
+            QMessageBox::warning(P->mainwindow_, tr("Output error"), tr("Could not save profile data."));
+            return;
+        }
+    }
+
+    if (matrix) {
+        // one line per frequency, with all outputs to the first input, then the second...
+        const unsigned nc = P->mx_channels_;
+        std::ofstream file((filename + "/matrix.dat").toLocal8Bit().data());
+        file << std::scientific << std::setprecision(10);
+        for (unsigned i = 0; i < Analysis::sweep_length; ++i) {
+            file << freqs[i];
+            for (unsigned e = 0; e < nc * nc; ++e) {
+                cfloat response = P->mx_response_[i * nc * nc + e];
+                file << ' ' << std::abs(response) << ' ' << std::arg(response);
+            }
+            file << '\n';
+        }
+        if (!file.flush()) {
+            QMessageBox::warning(P->mainwindow_, tr("Output error"), tr("Could not save profile data."));
+            return;
+        }
+    }
+
+    if (transfer) {
+        std::ofstream file((filename + "/coherence.dat").toLocal8Bit().data());
+        file << std::scientific << std::setprecision(10);
+        for (unsigned i = 0; i < sched.size(); ++i)
+            file << freqs[i] << ' ' << P->an_coherence_[i] << '\n';
+        if (!file.flush()) {
+            QMessageBox::warning(P->mainwindow_, tr("Output error"), tr("Could not save profile data."));
+            return;
+        }
+    }
+}
+
+void Measurement::realtimeUpdateTick()
+{
+    Audio_Processor &proc = *P->proc_;
+
+    Tracer &tracer = Tracer::instance();
+    tracer.collect();
+
+    while (Basic_Message *hmsg = proc.receive_message()) {
+        switch (hmsg->tag) {
+        case Message_Tag::NotifyFrequencyAnalysis: {
+            auto *msg = (Messages::NotifyFrequencyAnalysis *)hmsg;
+
+            int spl = msg->spl;
+            if (spl == -1)
+                return;
+
+            tracer.event(Tracer::Track_Gui, Tracer::Phase_Async_End, "result wait", P->trace_step_);
+
+            Sweep_Scheduler &sched = P->sched_;
+
+            // the step disturbed by a change of parameters is measured again,
+            // while the other points stay valid
+            if (msg->version == 0) {
+                if (P->sweep_active_)
+                    P->schedule_next_sweep();
+                break;
+            }
+
+            if (sched.measuring_noise()) {
+                sched.finish_step(spl);
+                if (P->sweep_active_)
+                    P->schedule_next_sweep();
+                break;
+            }
+
+            if (sched.probing()) {
+                if (sched.probe(spl, msg->residual))
+                    P->show_auto_parallelism();
+                if (P->sweep_active_)
+                    P->schedule_next_sweep();
+                break;
+            }
+
+            tracer.event(Tracer::Track_Gui, Tracer::Phase_Begin, "update");
+
+            sched.store(*msg);
+
+            Octave_Smoother &smoother = (spl == Analysis::Signal_Hi) ?
+                P->an_hi_smoother_ : P->an_lo_smoother_;
+            const cfloat *response = sched.response(spl);
+            const float *step_frequency = msg->frequency();
+            const cfloat *step_response = msg->response();
+            const float *step_snr = msg->snr();
+            for (unsigned a = 0; a < sched.step_size(); ++a) {
+                unsigned index = sched.step_points()[a];
+                smoother.update(index, response[index]);
+                emit pointMeasured(spl, step_frequency[a], std::abs(step_response[a]), std::arg(step_response[a]), step_snr[a]);
+            }
+
+            P->update_plot_data(spl);
+            const double *plot_mags = ((spl == Analysis::Signal_Hi) ?
+                                       P->an_hi_plot_mags_ : P->an_lo_plot_mags_).get();
+
+            Sweep_Scheduler::Outcome outcome = sched.finish_step(spl);
+            if (outcome.refined)
+                P->regrid_smoothers();
+            if (outcome.sweep_done)
+                emit sweepCompleted(spl);
+            if (outcome.sweep_done && spl == sched.display_level())
+                P->mainwindow_->showWaterfallColumn(P->waterfall_column(plot_mags), Analysis::sweep_length);
+            if (outcome.level_changed)
+                emit sweepPhaseChanged(sched.level());
+
+            P->mainwindow_->showProgress(sched.completion());
+
+            replotResponses();
+
+            tracer.event(Tracer::Track_Gui, Tracer::Phase_End, "update");
+
+            if (P->sweep_active_)
+                P->schedule_next_sweep();
+            break;
+        }
+        case Message_Tag::NotifyBandLevels: {
+            auto *msg = (Messages::NotifyBandLevels *)hmsg;
+
+            if (P->mode_ != Analysis::Mode_Rta)
+                break;
+
+            unsigned num_bands = Band_Analyzer::band_centers(
+                msg->fraction, P->rta_centers_, Analysis::max_bands);
+            num_bands = std::min(num_bands, msg->num_bands);
+            for (unsigned b = 0; b < num_bands; ++b)
+                P->rta_levels_[b] = msg->level[b];
+            P->rta_num_bands_ = num_bands;
+
+            P->mainwindow_->showBands(P->rta_centers_, P->rta_levels_, num_bands, msg->fraction);
+            break;
+        }
+        default:
+            assert(false);
+            break;
+        }
+    }
+
+    while (Basic_Message *hmsg = P->matrix_ ? P->matrix_->receive_message() : nullptr) {
+        switch (hmsg->tag) {
+        case Message_Tag::NotifyMatrixAnalysis: {
+            auto *msg = (Messages::NotifyMatrixAnalysis *)hmsg;
+            if (msg->version != 0)
+                P->matrix_result(*msg);
+            replotResponses();
+            if (P->sweep_active_)
+                P->schedule_next_sweep();
+            break;
+        }
+        default:
+            assert(false);
+            break;
+        }
+    }
+
+    if (P->mode_ == Analysis::Mode_Transfer && P->sweep_active_)
+        P->update_transfer_function();
+
+    MainWindow &window = *P->mainwindow_;
+    window.showLevels(proc.input_level(), proc.output_level());
+
+    // the callback load is refreshed once a second
+    if (P->rt_stats_countdown_-- == 0) {
+        P->rt_stats_countdown_ = 20;
+        const Rt_Profiler &prof = proc.profiler();
+        Rt_Profiler::Stats st = prof.stats(Rt_Profiler::Stage_Cycle);
+        window.showCallbackLoad(st.mean_load, st.worst_load, prof.xruns());
+    }
+}
+
+void Measurement::dumpCallbackStatistics()
+{
+    std::string report = P->proc_->profiler().report();
+    if (P->matrix_)
+        report += "matrix:\n" + P->matrix_->profiler().report();
+    fputs(report.c_str(), stdout);
+    fflush(stdout);
+
+    QMessageBox box(QMessageBox::Information, tr("Callback statistics"),
+                    tr("The timings of the audio callback were written to the standard output."),
+                    QMessageBox::Ok, P->mainwindow_);
+    box.setDetailedText(QString::fromStdString(report));
+    box.exec();
+}
+
+void Measurement::nextSweepTick()
+{
+    Audio_Processor &proc = *P->proc_;
+
+    Tracer &tracer = Tracer::instance();
+    tracer.event(Tracer::Track_Gui, Tracer::Phase_Async_End, "timer", P->trace_step_ + 1);
+    uint32_t step = ++P->trace_step_;
+
+    if (P->mode_ == Analysis::Mode_Matrix) {
+        unsigned count = P->mx_num_points_ =
+            P->mx_noise_due_ ? 0 : P->plan_matrix_step(P->mx_points_, P->mx_outputs_);
+        auto &msg = P->request_buf_.emplace<Messages::RequestMatrixAnalysis>(count);
+        msg.spl = P->sched_.display_level();
+        msg.uncertainty = P->sched_.target_uncertainty();
+        msg.window = P->sched_.window();
+        float *frequency = msg.frequency();
+        for (unsigned a = 0; a < count; ++a) {
+            frequency[a] = P->sched_.frequencies()[P->mx_points_[a]];
+            msg.output()[a] = P->mx_outputs_[a];
+        }
+        P->matrix_->send_message(msg);
+        if (count > 0)
+            P->mainwindow_->showCurrentFrequency(frequency[0]);
+        return;
+    }
+
+    auto &msg = P->sched_.plan(P->request_buf_);
+    tracer.event(Tracer::Track_Gui, Tracer::Phase_Async_Begin, "queue", step);
+    proc.send_message(msg);
+
+    if (msg.num_bins > 0)
+        P->mainwindow_->showCurrentFrequency(msg.frequency()[0]);
+}
+
+void Measurement::replotResponses()
+{
+    const Sweep_Scheduler &sched = P->sched_;
+    const unsigned ns = sched.size();
+    bool transfer = P->mode_ == Analysis::Mode_Transfer;
+    P->mainwindow_->showPlotData
+        (sched.frequencies(), sched.frequencies()[sched.index()],
+         P->an_lo_plot_mags_.get(), P->an_lo_plot_phases_.get(),
+         P->an_hi_plot_mags_.get(), P->an_hi_plot_phases_.get(),
+         transfer ? P->an_coherence_.get() : nullptr,
+         ns);
+}
+
+void Measurement::Impl::set_sweep_phase(int spl)
+{
+    if (sched_.set_level(spl))
+        emit self_->sweepPhaseChanged(spl);
+}
+
+void Measurement::Impl::schedule_next_sweep()
+{
+    Tracer &tracer = Tracer::instance();
+    tracer.event(Tracer::Track_Gui, Tracer::Phase_Async_Begin, "timer", trace_step_ + 1);
+    tm_nextsweep_->start(0);
+}
+
+void Measurement::Impl::show_auto_parallelism()
+{
+    mainwindow_->showAutoParallelism(
+        sched_.auto_density(Analysis::Signal_Lo), sched_.auto_density(Analysis::Signal_Hi),
+        Analysis::parallel_regions);
+}
+
+void Measurement::Impl::reset_grid()
+{
+    sched_.reset_grid();
+    regrid_smoothers();
+
+    // the columns of the old grid do not line up with the new
+    if (mainwindow_)
+        mainwindow_->clearWaterfall();
+}
+
+void Measurement::Impl::regrid_smoothers()
+{
+    const unsigned ns = sched_.size();
+    const double *freqs = sched_.frequencies();
+
+    Octave_Smoother *smoothers[] = {&an_lo_smoother_, &an_hi_smoother_};
+    for (int spl : {Analysis::Signal_Lo, Analysis::Signal_Hi}) {
+        Octave_Smoother &smoother = *smoothers[spl];
+        const cfloat *response = sched_.response(spl);
+        const bool *valid = sched_.valid(spl);
+        smoother.set_grid(freqs, ns);
+        for (unsigned i = 0; i < ns; ++i) {
+            if (valid[i])
+                smoother.update(i, response[i]);
+        }
+        update_plot_data(spl);
+    }
+}
+
+void Measurement::Impl::show_resumed_sweep()
+{
+    // the grid and the level may differ from those before
+    regrid_smoothers();
+    emit self_->sweepPhaseChanged(sched_.level());
+    self_->replotResponses();
+}
+
+const double *Measurement::Impl::waterfall_column(const double *plot_mags)
+{
+    // the history keeps the rows of the coarse grid
+    unsigned row = 0;
+    const bool *coarse = sched_.coarse();
+    for (unsigned i = 0; i < sched_.size() && row < Analysis::sweep_length; ++i) {
+        if (coarse[i])
+            an_waterfall_[row++] = plot_mags[i];
+    }
+    return an_waterfall_;
+}
+
+void Measurement::Impl::update_plot_data(int spl)
+{
+    const unsigned ns = sched_.size();
+    bool hi = spl == Analysis::Signal_Hi;
+
+    Octave_Smoother &smoother = hi ? an_hi_smoother_ : an_lo_smoother_;
+    double *plot_mags = (hi ? an_hi_plot_mags_ : an_lo_plot_mags_).get();
+    double *plot_phases = (hi ? an_hi_plot_phases_ : an_lo_plot_phases_).get();
+
+    smoother.compute();
+    const double *mags = smoother.magnitude();
+    const cdouble *cplx = smoother.response();
+
+    for (unsigned i = 0; i < ns; ++i)
+        plot_mags[i] = smoother.defined(i) ? (20 * std::log10(mags[i])) : 0.0;
+
+    switch (phase_view_) {
+    default:
+        for (unsigned i = 0; i < ns; ++i)
+            plot_phases[i] = std::arg(cplx[i]);
+        break;
+    case Analysis::Phase_Unwrapped:
+        unwrap_phase(cplx, plot_phases, ns);
+        break;
+    case Analysis::Phase_Group_Delay: {
+        double *unwrapped = an_unwrapped_.get();
+        unwrap_phase(cplx, unwrapped, ns);
+        group_delay(sched_.frequencies(), unwrapped, plot_phases, ns);
+        for (unsigned i = 0; i < ns; ++i)
+            plot_phases[i] *= 1e3;  // in ms
+        break;
+    }
+    }
+}
+
+void Measurement::Impl::update_transfer_function()
+{
+    const unsigned ns = sched_.size();
+    cfloat *h1 = sched_.response(Analysis::Signal_Hi);
+    cfloat *h2 = sched_.response(Analysis::Signal_Lo);
+    float *coherence = an_coherence_buf_.get();
+
+    Transfer_Analyzer &analyzer = proc_->transfer_analyzer();
+    if (!analyzer.fetch(h1, h2, coherence))
+        return;
+
+    for (unsigned i = 0; i < ns; ++i) {
+        an_hi_smoother_.update(i, h1[i]);
+        an_lo_smoother_.update(i, h2[i]);
+        an_coherence_[i] = coherence[i];
+    }
+
+    update_plot_data(Analysis::Signal_Lo);
+    update_plot_data(Analysis::Signal_Hi);
+
+    const double *plot_mags = ((sched_.display_level() == Analysis::Signal_Hi) ?
+                               an_hi_plot_mags_ : an_lo_plot_mags_).get();
+    mainwindow_->showWaterfallColumn(waterfall_column(plot_mags), Analysis::sweep_length);
+
+    self_->replotResponses();
+}
+
+unsigned Measurement::Impl::plan_matrix_step(unsigned *points, unsigned *outputs)
+{
+    const unsigned nc = mx_channels_;
+
+    // interleave the outputs, and rotate them at each pass, so that every
+    // output has played every frequency after as many passes as outputs
+    unsigned per_output = std::max(1u, std::min(sched_.freqs_at_once(), Analysis::max_parallel / nc));
+    per_output = std::max(1u, std::min(per_output, sched_.max_spread(per_output * nc) / nc));
+    const unsigned count = per_output * nc;
+    for (unsigned a = 0; a < count; ++a) {
+        points[a] = Analysis::nth_bin_position(sched_.index(), a, count);
+        outputs[a] = (a + mx_pass_) % nc;
+    }
+    return count;
+}
+
+void Measurement::Impl::matrix_result(const Messages::NotifyMatrixAnalysis &msg)
+{
+    // the noise floor is not a step of the sweep
+    if (msg.num_bins == 0) {
+        mx_noise_due_ = false;
+        return;
+    }
+
+    const unsigned nc = mx_channels_;
+    const unsigned ns = Analysis::sweep_length;
+    cfloat *matrix = mx_response_.get();
+    bool *valid = mx_valid_.get();
+    double *freqs = sched_.frequencies();
+    cfloat *direct = sched_.response(Analysis::Signal_Hi);
+    cfloat *crosstalk = sched_.response(Analysis::Signal_Lo);
+    Sweep_Scheduler::Progress &progress = sched_.progress();
+
+    const float *frequency = msg.frequency();
+    const unsigned *outputs = msg.output();
+    unsigned done_bins = std::min(msg.num_bins, mx_num_points_);
+    for (unsigned a = 0; a < done_bins; ++a) {
+        unsigned point = mx_points_[a];
+        unsigned output = outputs[a];
+        freqs[point] = frequency[a];
+        for (unsigned input = 0; input < std::min(nc, msg.channels); ++input) {
+            unsigned e = (point * nc + input) * nc + output;
+            matrix[e] = msg.response(input)[a];
+            valid[e] = true;
+        }
+        progress.set(point);
+    }
+
+    // display the direct path of the first loop and its worst crosstalk
+    for (unsigned i = 0; i < ns; ++i) {
+        const cfloat *row = &matrix[i * nc * nc];
+        const bool *row_valid = &valid[i * nc * nc];
+        if (row_valid[0]) {
+            direct[i] = row[0];
+            an_hi_smoother_.update(i, row[0]);
+        }
+        unsigned worst = 0;
+        for (unsigned output = 1; output < nc; ++output) {
+            if (row_valid[output] && (worst == 0 || std::abs(row[output]) > std::abs(row[worst])))
+                worst = output;
+        }
+        if (worst != 0) {
+            crosstalk[i] = row[worst];
+            an_lo_smoother_.update(i, row[worst]);
+        }
+    }
+
+    update_plot_data(Analysis::Signal_Lo);
+    update_plot_data(Analysis::Signal_Hi);
+
+    if (progress.count() == ns) {
+        progress.reset();
+        mx_pass_ = (mx_pass_ + 1) % nc;
+        if (mx_pass_ == 0)
+            mainwindow_->showWaterfallColumn(waterfall_column(an_hi_plot_mags_.get()), ns);
+    }
+    sched_.set_index((sched_.index() + 1) % ns);
+
+    mainwindow_->showProgress((mx_pass_ * ns + progress.count()) * (1.0 / (nc * ns)));
+}
+
+void Measurement::Impl::start_noise_analysis()
+{
+    Messages::RequestNoiseAnalysis msg;
+    msg.spl = sched_.display_level();
+    msg.noise = rta_noise_;
+    proc_->send_message(msg);
+}
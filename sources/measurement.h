@@ -0,0 +1,66 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <QObject>
+#include <memory>
+class Audio_Processor;
+class Matrix_Processor;
+class MainWindow;
+
+//------------------------------------------------------------------------------
+// Measurement loop of one device under test, with its own audio processor,
+// window, schedule and results.
+class Measurement : public QObject {
+    Q_OBJECT
+
+public:
+    explicit Measurement(QObject *parent = nullptr);
+    ~Measurement();
+
+    void setAudioProcessor(Audio_Processor &proc);
+    void setMatrixProcessor(Matrix_Processor &proc);
+    void setMainWindow(MainWindow &win);
+    // the file which keeps the sweep in progress across restarts
+    void setCheckpoint(const QString &path);
+    // the processors were rebuilt for another rate of the audio system, and
+    // what they were measuring is lost
+    void audioReconfigured();
+
+    void setSweepEnabled(bool lo, bool hi);
+    void setFreqsAtOnce(unsigned count);
+    void setAdaptiveSweep(bool adaptive);
+    void setTargetUncertainty(double db);
+    void setAnalysisWindow(int window);
+    void setMeasurementMode(int mode);
+    void setNoiseType(int noise);
+    void setBandResolution(unsigned fraction);
+    void setRtaTimeConstant(float seconds);
+    void setSmoothing(unsigned fraction);
+    void setPhaseView(int view);
+
+signals:
+    void sweepPhaseChanged(int spl);
+    void pointMeasured(int spl, double frequency, double magnitude, double phase, double snr);
+    void sweepCompleted(int spl);
+
+public slots:
+    void setSweepActive(bool active);
+    void restartSweep();
+    void saveProfile();
+    void fitCorrection();
+    void dumpCallbackStatistics();
+
+protected slots:
+    void realtimeUpdateTick();
+    void nextSweepTick();
+
+private:
+    void replotResponses();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> P;
+};
@@ -4,30 +4,41 @@
 //          http://www.boost.org/LICENSE_1_0.txt)
 
 #include "messages.h"
-#include <cassert>
+#include <algorithm>
 
-namespace Messages {
+void Message_Buffer::reserve(size_t capacity)
+{
+    if (capacity <= capacity_)
+        return;
+    storage_.reset(new uint8_t[capacity]);
+    data_ = storage_.get();
+    capacity_ = capacity;
+}
 
-size_t size_of(Message_Tag tag)
+void Message_Buffer::attach(uint8_t *data, size_t capacity)
 {
-    size_t size = 0;
-    switch (tag) {
-    #define HANDLE_CASE(x) case Message_Tag::x: size = sizeof(x); break;
-    EACH_MESSAGE_TYPE(HANDLE_CASE)
-    #undef HANDLE_CASE
-    default:
-        assert(false);
-    }
-    return size;
+    storage_.reset();
+    data_ = data;
+    capacity_ = capacity;
 }
 
-uint8_t *allocate_buffer()
+namespace Messages {
+
+size_t max_size()
 {
+    const unsigned nb = Analysis::max_bins_at_once;
+    const unsigned nc = Analysis::max_matrix_channels;
+
     size_t size = 0;
-    #define COMPUTE_MAX(x) size = (size < sizeof(Messages::x)) ? sizeof(Messages::x) : size;
+    #define COMPUTE_MAX(x) size = std::max(size, sizeof(Messages::x));
     EACH_MESSAGE_TYPE(COMPUTE_MAX)
     #undef COMPUTE_MAX
-    return new uint8_t[size];
+
+    size = std::max(size, RequestAnalyzeFrequency::size_for(nb));
+    size = std::max(size, RequestMatrixAnalysis::size_for(nb));
+    size = std::max(size, NotifyFrequencyAnalysis::size_for(nb));
+    size = std::max(size, NotifyMatrixAnalysis::size_for(nb, nc));
+    return size;
 }
 
 }  // namespace Messages
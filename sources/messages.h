@@ -6,13 +6,20 @@
 #pragma once
 #include "analyzerdefs.h"
 #include <complex>
+#include <memory>
+#include <new>
 #include <cstddef>
 #include <cstdint>
 
 #define EACH_MESSAGE_TYPE(F)                    \
     F(RequestAnalyzeFrequency)                  \
     F(RequestStop)                              \
-    F(NotifyFrequencyAnalysis)
+    F(RequestTransferAnalysis)                  \
+    F(RequestNoiseAnalysis)                     \
+    F(RequestMatrixAnalysis)                    \
+    F(NotifyFrequencyAnalysis)                  \
+    F(NotifyBandLevels)                         \
+    F(NotifyMatrixAnalysis)
 
 enum class Message_Tag {
     #define DECLARE_MEMBER(x) x,
@@ -22,40 +29,166 @@ enum class Message_Tag {
 
 struct Basic_Message {
     Basic_Message()
-        : tag() {}
-    explicit Basic_Message(Message_Tag tag)
-        : tag(tag) {}
+        : tag(), size(sizeof(Basic_Message)) {}
+    Basic_Message(Message_Tag tag, size_t size)
+        : tag(tag), size(size) {}
     const Message_Tag tag;
+    // in bytes, with the payload of a message of variable length
+    uint32_t size;
 };
 
-template <Message_Tag Tag>
+template <class T, Message_Tag Tag>
 struct Basic_Message_T : public Basic_Message {
     Basic_Message_T()
-        : Basic_Message(Tag) {}
+        : Basic_Message(Tag, sizeof(T)) {}
 };
 
+// a message followed by arrays sized by its members, which is constructed
+// in a Message_Buffer rather than copied
+template <class T, Message_Tag Tag>
+struct Variable_Message_T : public Basic_Message_T<T, Tag> {
+    Variable_Message_T() {}
+    Variable_Message_T(const Variable_Message_T &) = delete;
+    Variable_Message_T &operator=(const Variable_Message_T &) = delete;
+
+protected:
+    template <class U> U *payload(size_t offset) const
+    {
+        static_assert(alignof(U) <= alignof(T), "misaligned payload");
+        return (U *)((const uint8_t *)this + sizeof(T) + offset);
+    }
+};
+
+//------------------------------------------------------------------------------
+// Storage of a message of variable length, which grows unless it was
+// reserved for the largest beforehand, as for use in the audio thread.
+class Message_Buffer {
+public:
+    explicit Message_Buffer(size_t capacity = 0) { reserve(capacity); }
+    void reserve(size_t capacity);
+    size_t capacity() const { return capacity_; }
+
+    // uses the given storage, as long as the messages fit in it
+    void attach(uint8_t *data, size_t capacity);
+
+    template <class T, class... Args> T &emplace(Args... args)
+    {
+        reserve(T::size_for(args...));
+        return *new (data_) T(args...);
+    }
+
+private:
+    uint8_t *data_ = nullptr;
+    std::unique_ptr<uint8_t[]> storage_;
+    size_t capacity_ = 0;
+};
+
+//------------------------------------------------------------------------------
 namespace Messages {
     #define DEFMESSAGE(t)                                   \
-        struct t : public Basic_Message_T<Message_Tag::t>
+        struct t : public Basic_Message_T<t, Message_Tag::t>
+    #define DEFVARMESSAGE(t)                                \
+        struct t : public Variable_Message_T<t, Message_Tag::t>
 
-    DEFMESSAGE(RequestAnalyzeFrequency) {
-        int spl;
+    DEFVARMESSAGE(RequestAnalyzeFrequency) {
+        explicit RequestAnalyzeFrequency(unsigned num_bins)
+            : num_bins(num_bins) { size = size_for(num_bins); }
+        static size_t size_for(unsigned num_bins)
+            { return sizeof(RequestAnalyzeFrequency) + num_bins * sizeof(float); }
+
+        int spl = 0;
+        // a step without frequencies captures the noise floor
         unsigned num_bins;
-        float frequency[Analysis::max_bins_at_once];
+        // the uncertainty in dB which sets the length of the capture from the
+        // noise floor, or 0 for a capture of one period
+        float uncertainty = 0;
+        // the window of the analysis, of Analysis::Window_Type
+        int window = Analysis::Window_Hann;
+
+        float *frequency() const { return payload<float>(0); }
     };
 
     DEFMESSAGE(RequestStop) {
     };
 
-    DEFMESSAGE(NotifyFrequencyAnalysis) {
+    DEFMESSAGE(RequestTransferAnalysis) {
+    };
+
+    DEFMESSAGE(RequestNoiseAnalysis) {
         int spl;
+        int noise;
+    };
+
+    DEFVARMESSAGE(RequestMatrixAnalysis) {
+        explicit RequestMatrixAnalysis(unsigned num_bins)
+            : num_bins(num_bins) { size = size_for(num_bins); }
+        static size_t size_for(unsigned num_bins)
+            { return sizeof(RequestMatrixAnalysis) + num_bins * (sizeof(float) + sizeof(unsigned)); }
+
+        int spl = 0;
+        // a step without frequencies captures the noise floor at every input
+        unsigned num_bins;
+        // the uncertainty in dB which sets the length of the capture, as for
+        // RequestAnalyzeFrequency
+        float uncertainty = 0;
+        int window = Analysis::Window_Hann;
+
+        float *frequency() const { return payload<float>(0); }
+        // the output which plays each frequency
+        unsigned *output() const { return payload<unsigned>(num_bins * sizeof(float)); }
+    };
+
+    DEFVARMESSAGE(NotifyFrequencyAnalysis) {
+        explicit NotifyFrequencyAnalysis(unsigned num_bins)
+            : num_bins(num_bins) { size = size_for(num_bins); }
+        static size_t size_for(unsigned num_bins)
+            { return sizeof(NotifyFrequencyAnalysis) + num_bins * (2 * sizeof(float) + sizeof(std::complex<float>)); }
+
+        int spl = 0;
+        unsigned num_bins;
+        // power at the bins not excited, relative to the excited bins
+        float residual = 0;
+        // version of the parameters during all the step, 0 if they changed
+        uint32_t version = 0;
+        // periods of the analysis which the capture lasted
+        unsigned blocks = 1;
+        // ratio of the clock of the loop to ours, minus one, if compensated
+        float drift = 0;
+
+        float *frequency() const { return payload<float>(0); }
+        std::complex<float> *response() const { return payload<std::complex<float>>(num_bins * sizeof(float)); }
+        // power of the tone relative to the noise floor, 0 if not measured
+        float *snr() const { return payload<float>(num_bins * (sizeof(float) + sizeof(std::complex<float>))); }
+    };
+
+    DEFMESSAGE(NotifyBandLevels) {
+        unsigned fraction;
+        unsigned num_bands;
+        float level[Analysis::max_bands];
+    };
+
+    DEFVARMESSAGE(NotifyMatrixAnalysis) {
+        NotifyMatrixAnalysis(unsigned num_bins, unsigned channels)
+            : num_bins(num_bins), channels(channels) { size = size_for(num_bins, channels); }
+        static size_t size_for(unsigned num_bins, unsigned channels)
+            { return sizeof(NotifyMatrixAnalysis) + num_bins * (sizeof(float) + sizeof(unsigned) + channels * sizeof(std::complex<float>)); }
+
+        int spl = 0;
         unsigned num_bins;
-        float frequency[Analysis::max_bins_at_once];
-        std::complex<float> response[Analysis::max_bins_at_once];
+        unsigned channels;
+        // version of the parameters during all the step, 0 if they changed
+        uint32_t version = 0;
+
+        float *frequency() const { return payload<float>(0); }
+        unsigned *output() const { return payload<unsigned>(num_bins * sizeof(float)); }
+        // response of each input to the frequency of its output
+        std::complex<float> *response(unsigned input) const
+            { return payload<std::complex<float>>(num_bins * (sizeof(float) + sizeof(unsigned) + input * sizeof(std::complex<float>))); }
     };
 
     #undef DEFMESSAGE
+    #undef DEFVARMESSAGE
 
-    size_t size_of(Message_Tag tag);
-    uint8_t *allocate_buffer();
+    // the largest message, with the payloads at their capacity
+    size_t max_size();
 }
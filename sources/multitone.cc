@@ -0,0 +1,428 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "multitone.h"
+#include "windowcache.h"
+#include "rtarena.h"
+#include "dsp/kernels.h"
+#include "dsp/peak_fit.h"
+#include "dsp/windows.h"
+#include "dsp/tone_detector.h"
+#include <algorithm>
+#include <cmath>
+typedef std::complex<float> cfloat;
+
+size_t Multitone_Generator::footprint(unsigned max_tones)
+{
+    return
+        2 * Rt_Arena::footprint<float>(max_tones) +
+        2 * Rt_Arena::footprint<uint32_t>(max_tones) +
+        Rt_Arena::footprint<unsigned>(max_tones);
+}
+
+void Multitone_Generator::configure(Rt_Arena &arena, unsigned max_tones, unsigned fft_size, unsigned outputs)
+{
+    kernels_ = &dsp_kernels();
+    fft_size_ = fft_size;
+    outputs_ = std::max(1u, std::min<unsigned>(outputs, Analysis::max_matrix_channels));
+    max_tones_ = max_tones;
+
+    freq_ = arena.allocate<float>(max_tones);
+    output_ = arena.allocate<unsigned>(max_tones);
+    increment_ = arena.allocate<uint32_t>(max_tones);
+    phase_ = arena.allocate<uint32_t>(max_tones);
+    starting_phase_ = arena.allocate<float>(max_tones);
+}
+
+void Multitone_Generator::set_tones(const float *frequency, const unsigned *output, unsigned count, float sample_rate)
+{
+    const unsigned fft_size = fft_size_;
+    count = count_ = std::min(count, max_tones_);
+
+    unsigned tones[Analysis::max_matrix_channels] = {};
+    for (unsigned a = 0; a < count; ++a) {
+        unsigned bin = std::lround(fft_size * frequency[a] / sample_rate);
+        bin = std::min(bin, fft_size / 2);
+        freq_[a] = (float)bin / fft_size;
+        output_[a] = output ? std::min(output[a], outputs_ - 1) : 0;
+        increment_[a] = phase_increment((double)bin / fft_size);
+        phase_[a] = 0;
+        starting_phase_[a] = 0;
+        ++tones[output_[a]];
+    }
+
+    // compensate for level increase caused by sum of sines, per output
+    for (unsigned c = 0; c < outputs_; ++c) {
+        float rms_single = M_SQRT1_2;
+        float rms_sum = std::sqrt((M_SQRT1_2 * M_SQRT1_2) * tones[c]);
+        compensate_[c] = tones[c] ? (rms_single / rms_sum) : 0;
+    }
+}
+
+void Multitone_Generator::mark_start()
+{
+    for (unsigned a = 0, count = count_; a < count; ++a)
+        starting_phase_[a] = phase_turns(phase_[a]);
+}
+
+void Multitone_Generator::generate(float *const *out, unsigned n)
+{
+    for (unsigned a = 0, count = count_; a < count; ++a) {
+        const unsigned c = output_[a];
+        kernels_->oscillator(out[c], n, &phase_[a], increment_[a], compensate_[c]);
+    }
+}
+
+cfloat Multitone_Generator::start_value(unsigned a, float amp) const
+{
+    return std::polar(amp * compensate_[output_[a]], 2 * (float)M_PI * starting_phase_[a]);
+}
+
+//------------------------------------------------------------------------------
+Multitone_Analyzer::Multitone_Analyzer()
+{
+}
+
+Multitone_Analyzer::~Multitone_Analyzer()
+{
+}
+
+size_t Multitone_Analyzer::footprint(unsigned max_tones, unsigned fft_size)
+{
+    return
+        Rt_Arena::footprint<cfloat>(max_tones) +
+        2 * Rt_Arena::footprint<unsigned>(max_tones) +
+        Rt_Arena::footprint<float>(max_tones) +
+        Rt_Arena::footprint<double>(Analysis::max_parallel) +
+        Rt_Arena::footprint<cfloat>(Analysis::max_parallel) +
+        2 * Rt_Arena::footprint<float>(fft_size) +
+        Rt_Arena::footprint<float>(fft_size / 2 + 1) +
+        Rt_Arena::footprint<cfloat>(fft_size / 2 + 1);
+}
+
+void Multitone_Analyzer::configure(Rt_Arena &arena, unsigned max_tones, unsigned fft_size, const char *detector)
+{
+    kernels_ = &dsp_kernels();
+
+    len_ = fft_size;
+    buf_ = arena.allocate<float>(fft_size);
+
+    sum_ = arena.allocate<cfloat>(max_tones);
+    peak_ = arena.allocate<unsigned>(max_tones);
+    window_gain_ = arena.allocate<float>(max_tones);
+    residual_bins_ = arena.allocate<unsigned>(max_tones);
+    detector_freq_ = arena.allocate<double>(Analysis::max_parallel);
+    detector_value_ = arena.allocate<cfloat>(Analysis::max_parallel);
+
+    // periodic, for the exact location of the tones between the bins
+    for (unsigned w = 0; w < Analysis::num_window_types; ++w)
+        windows_[w] = &Window_Cache::instance().get(w, fft_size);
+    window_ = noise_window_ = windows_[Analysis::Window_Hann];
+
+    fft_real_ = arena.allocate<float>(fft_size);
+    fft_cplx_ = arena.allocate<cfloat>(fft_size / 2 + 1);
+    noise_floor_ = arena.allocate<float>(fft_size / 2 + 1);
+
+    fft_plan_ = Fft_Plan_Cache::instance().get(fft_size, Fft_Type::Real_Forward);
+
+    if (detector && detector[0]) {
+        detectors_[0] = make_tone_detector(detector, 4);
+        detectors_[1] = make_tone_detector(detector, Analysis::max_parallel);
+    }
+}
+
+void Multitone_Analyzer::begin_step(const Multitone_Generator &gen, int window, float uncertainty, uint64_t frame)
+{
+    const unsigned count = gen.count();
+    gen_ = &gen;
+
+    for (unsigned a = 0; a < count; ++a)
+        sum_[a] = 0;
+    fill_ = 0;
+    target_snr_ = Analysis::uncertainty_snr(uncertainty);
+    window_ = windows_[std::min<unsigned>(window, Analysis::num_window_types - 1)];
+
+    // the smallest detector which follows all the tones, if any
+    detector_ = nullptr;
+    for (const std::unique_ptr<Tone_Detector> &detector : detectors_) {
+        if (!detector_ && detector && count > 0 && count <= detector->capacity())
+            detector_ = detector.get();
+    }
+    blocks_ = 1;
+    blocks_done_ = 0;
+
+    // the phase of the drift counts from the start of the sweep
+    if (!drift_tracking_) {
+        drift_tracking_ = true;
+        drift_origin_ = frame;
+    }
+}
+
+void Multitone_Analyzer::end_sweep()
+{
+    drift_tracking_ = false;
+    drift_ = 0;
+    drift_weight_ = 0;
+}
+
+void Multitone_Analyzer::start_capture(uint64_t frame)
+{
+    capture_start_ = frame;
+}
+
+unsigned Multitone_Analyzer::collect(const float *in, unsigned n, uint64_t frame)
+{
+    float *buf = buf_;
+    const unsigned len = len_;
+    unsigned fill = fill_;
+
+    if (blocks_done_ == blocks_)
+        return 0;
+
+    n = std::min(n, len - fill);
+    if (fill == 0 && n > 0) {
+        block_start_ = frame;
+        if (detector_)
+            begin_detection();
+    }
+    if (Tone_Detector *detector = detector_)
+        detector->push(in, window_->data, fill, n);
+    for (unsigned i = 0; i < n; ++i)
+        buf[fill++] = in[i];
+
+    fill_ = fill;
+    return n;
+}
+
+void Multitone_Analyzer::begin_detection()
+{
+    // the tones where the drift of the clock puts them at this period
+    const double ratio = 1 + drift();
+    const unsigned count = gen_->count();
+    for (unsigned a = 0; a < count; ++a)
+        detector_freq_[a] = gen_->frequency(a) * ratio;
+    detector_->begin(detector_freq_, count, len_);
+}
+
+void Multitone_Analyzer::analyze_block()
+{
+    const unsigned n = len_;
+    const cfloat *cplx = fft_cplx_;
+    const Multitone_Generator &gen = *gen_;
+
+    compute_spectrum();
+
+    const unsigned count = gen.count();
+    if (count == 0)
+        compute_noise_floor(cplx);
+
+    // one drift for the whole block, which places the tones, turns back
+    // their phase, and corrects the detectors tuned before it was known
+    update_drift(cplx);
+    const double drift = this->drift();
+
+    if (detector_)
+        detector_->result(detector_value_);
+
+    // the tones repeat every period, so the spectra add coherently, once
+    // brought back to the phases at the start of the capture, and to the clock
+    // at the start of the sweep
+    const uint64_t offset = (block_start_ - capture_start_) % n;
+    const uint64_t elapsed = block_start_ - drift_origin_;
+    for (unsigned a = 0; a < count; ++a) {
+        const double k = std::round(n * gen.frequency(a));
+        const double pos = k * (1 + drift);
+        const unsigned bin = std::min<long>(std::lround(pos), n / 2);
+        double turns = k * ((double)offset / n) + k * drift * ((double)elapsed / n);
+        turns -= std::floor(turns);
+        // a detector is the bin at its own frequency, off the tone by as much
+        // as the drift changed since the start of the period
+        cfloat value = detector_ ?
+            window_tone_value(detector_value_[a], pos - n * detector_freq_[a], window_->type) :
+            window_bin_value(cplx, bin, pos - bin, window_->type);
+        sum_[a] += value * std::polar(1.0f, (float)(-2 * M_PI * turns));
+        peak_[a] = bin;
+        window_gain_[a] = window_bin_gain(window_->type, pos - bin);
+    }
+
+    if (blocks_done_++ == 0)
+        blocks_ = required_blocks(cplx);
+    if (blocks_done_ < blocks_)
+        fill_ = 0;
+}
+
+void Multitone_Analyzer::compute_spectrum()
+{
+    const unsigned n = len_;
+
+    float *real = fft_real_;
+    cfloat *cplx = fft_cplx_;
+
+    kernels_->multiply(real, buf_, window_->data, n);
+    fft_plan_.execute(real, cplx);
+}
+
+void Multitone_Analyzer::compute_noise_floor(const cfloat *cplx)
+{
+    // the power of one capture, averaged over the neighboring bins
+    const int nb = len_ / 2 + 1;
+    const int half = 4;
+    float *floor = noise_floor_;
+
+    // the input of the transform is free once it ran
+    float *power = fft_real_;
+    kernels_->power(power, cplx, nb);
+
+    double sum = 0;
+    for (int b = 0; b < std::min(half, nb); ++b)
+        sum += power[b];
+    for (int b = 0; b < nb; ++b) {
+        int lo = b - half, hi = b + half;
+        if (hi < nb)
+            sum += power[hi];
+        if (lo - 1 >= 0)
+            sum -= power[lo - 1];
+        unsigned count = std::min(hi, nb - 1) - std::max(lo, 0) + 1;
+        floor[b] = std::max(sum, 0.0) / count;
+    }
+
+    noise_valid_ = true;
+    noise_window_ = window_;
+}
+
+float Multitone_Analyzer::noise_scale() const
+{
+    // the power of the noise in a bin follows the sum of the squares of the
+    // window, in case the step has another than the noise floor
+    if (window_ == noise_window_)
+        return 1;
+    return (float)(window_->square_sum / noise_window_->square_sum);
+}
+
+void Multitone_Analyzer::update_drift(const cfloat *cplx)
+{
+    const unsigned n = len_;
+    const Multitone_Generator &gen = *gen_;
+
+    // the offsets relative to the frequencies, weighted by their precision,
+    // which is known from the SNR once the noise floor is
+    if (!noise_valid_)
+        return;
+
+    // the image at the negative frequency biases the offsets of the lowest
+    // tones, and other errors than noise dominate at high SNR
+    const double min_bin = 16;
+    const double max_snr = 1e8;
+
+    const float scale = noise_scale();
+    double sum = 0, weight = 0;
+    for (unsigned a = 0, count = gen.count(); a < count; ++a) {
+        const double k = std::round(n * gen.frequency(a));
+        if (k < min_bin)
+            continue;
+        unsigned search = 1 + (unsigned)(k * Analysis::max_clock_drift);
+        Peak_Fit fit = fit_window_peak(cplx, n, k * (1 + drift_), search, window_->type);
+        double snr = std::norm(cplx[fit.bin]) / (scale * noise_floor_[fit.bin] + 1e-30f);
+        double w = k * k * std::min(snr, max_snr);
+        sum += w * ((fit.bin + fit.offset - k) / k);
+        weight += w;
+    }
+    if (weight == 0)
+        return;
+
+    // the recent periods count most, to follow a drift which changes
+    drift_weight_ *= 0.98;
+    drift_ = (drift_ * drift_weight_ + sum) / (drift_weight_ + weight);
+    drift_weight_ += weight;
+}
+
+double Multitone_Analyzer::drift() const
+{
+    // the offset of a tone has a deviation near 1/√SNR bins, so the weight
+    // is the inverse of the variance of the estimate; the drift is
+    // compensated only if far above its deviation
+    double deviation = 1 / std::sqrt(drift_weight_ + 1e-30);
+    double drift = drift_;
+    if (std::fabs(drift) < std::max(Analysis::min_clock_drift, 5 * deviation))
+        return 0;
+    return drift;
+}
+
+unsigned Multitone_Analyzer::required_blocks(const cfloat *cplx) const
+{
+    const float target = target_snr_;
+    if (target <= 0 || !noise_valid_)
+        return 1;
+
+    // averaging over k periods divides the power of the noise by k
+    const float scale = noise_scale();
+    float weakest = INFINITY;
+    for (unsigned a = 0, count = gen_->count(); a < count; ++a) {
+        unsigned bin = peak_[a];
+        float snr = std::norm(cplx[bin]) / (scale * noise_floor_[bin] + 1e-30f);
+        weakest = std::min(weakest, snr);
+    }
+
+    float blocks = std::ceil(target / weakest);
+    return (unsigned)std::max(1.0f, std::min(blocks, (float)Analysis::max_capture_blocks));
+}
+
+void Multitone_Analyzer::compute_response(cfloat *response, float *snr, float amp) const
+{
+    const Multitone_Generator &gen = *gen_;
+    const unsigned blocks = blocks_done_;
+    const float amplitude_scale = window_->amplitude_scale();
+    const float scale = noise_scale();
+
+    for (unsigned a = 0, count = gen.count(); a < count; ++a) {
+        unsigned bin = peak_[a];
+        cfloat mean = sum_[a] / (float)blocks;
+        cfloat h_out = mean * amplitude_scale;
+        cfloat h_in = gen.start_value(a, amp);
+        response[a] = h_out / h_in;
+        if (snr) {
+            float seen = std::norm(mean * window_gain_[a]);
+            snr[a] = noise_valid_ ? (blocks * seen / (scale * noise_floor_[bin] + 1e-30f)) : 0;
+        }
+    }
+}
+
+float Multitone_Analyzer::compute_residual() const
+{
+    const unsigned n = len_;
+    const unsigned count = gen_->count();
+    const cfloat *cplx = fft_cplx_;
+    if (count == 0)
+        return 0;
+
+    unsigned *bins = residual_bins_;
+    double excited = 0;
+    for (unsigned a = 0; a < count; ++a) {
+        bins[a] = peak_[a];
+        excited += std::norm(cplx[bins[a]]);
+    }
+    std::sort(bins, bins + count);
+
+    // look one third octave around the excited span, away from the main lobes
+    const unsigned guard = 2;
+    unsigned lo = std::max(1l, std::lround(bins[0] * 0.7937));
+    unsigned hi = std::min<unsigned>(std::lround(bins[count - 1] * 1.2599), n / 2);
+
+    double other = 0;
+    unsigned num_other = 0;
+    unsigned a = 0;
+    for (unsigned b = lo; b <= hi; ++b) {
+        while (a < count && bins[a] + guard < b)
+            ++a;
+        if (a < count && b + guard >= bins[a])
+            continue;
+        other += std::norm(cplx[b]);
+        ++num_other;
+    }
+
+    if (num_other == 0 || excited == 0)
+        return 0;
+    return (float)((other / num_other) / (excited / count));
+}
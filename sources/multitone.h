@@ -0,0 +1,165 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include "analyzerdefs.h"
+#include "fftplan.h"
+#include <complex>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+class Rt_Arena;
+class Tone_Detector;
+struct Dsp_Kernels;
+struct Window_Table;
+
+//------------------------------------------------------------------------------
+// Bank of oscillators which play the tones of a step on the centers of the
+// bins of the analysis, each on one of the outputs, which are compensated for
+// the level increase of the sum of their tones.
+class Multitone_Generator {
+public:
+    // the memory it takes from the arena of the processor
+    static size_t footprint(unsigned max_tones);
+    void configure(Rt_Arena &arena, unsigned max_tones, unsigned fft_size, unsigned outputs);
+
+    // the tones of a step in Hz, and the output of each, or the first for all
+    // if `output` is null
+    void set_tones(const float *frequency, const unsigned *output, unsigned count, float sample_rate);
+    // notes the phases at the start of the capture, which the responses refer to
+    void mark_start();
+    // adds the tones to the outputs, at the amplitude 1 for the sum
+    void generate(float *const *out, unsigned n);
+
+    unsigned count() const { return count_; }
+    unsigned fft_size() const { return fft_size_; }
+    // the frequency of a tone, relative to the rate
+    float frequency(unsigned a) const { return freq_[a]; }
+    unsigned output(unsigned a) const { return output_[a]; }
+    // the tone at the start of the capture, for the amplitude `amp` of the sum
+    std::complex<float> start_value(unsigned a, float amp) const;
+
+private:
+    const Dsp_Kernels *kernels_ = nullptr;
+    unsigned fft_size_ = 0;
+    unsigned outputs_ = 0;
+    unsigned max_tones_ = 0;
+
+    unsigned count_ = 0;
+    float *freq_ = nullptr;
+    unsigned *output_ = nullptr;
+    uint32_t *increment_ = nullptr;
+    uint32_t *phase_ = nullptr;
+    float *starting_phase_ = nullptr;
+    float compensate_[Analysis::max_matrix_channels] = {};
+};
+
+//------------------------------------------------------------------------------
+// Analysis of one input at the tones of a generator. The capture lasts as
+// many periods of the analysis as the weakest tone requires to reach the
+// target SNR over the noise floor, and their spectra are averaged once
+// brought back to the clock of the generator, which the drift of the clock of
+// the loop is estimated against.
+//
+// The periods of the capture need not follow each other, since each one is
+// placed by its first frame.
+class Multitone_Analyzer {
+public:
+    Multitone_Analyzer();
+    ~Multitone_Analyzer();
+
+    // the memory it takes from the arena of the processor
+    static size_t footprint(unsigned max_tones, unsigned fft_size);
+    // the detector named `detector` follows the tones, if not null or empty,
+    // rather than the transform
+    void configure(Rt_Arena &arena, unsigned max_tones, unsigned fft_size, const char *detector);
+
+    // starts a step of the tones of `gen`, which the analyzer refers to until
+    // the next; a step without tones measures the noise floor
+    void begin_step(const Multitone_Generator &gen, int window, float uncertainty, uint64_t frame);
+    // forgets the drift, since the loop may change before the next sweep
+    void end_sweep();
+    // the first frame of the capture, where the generator marked its phases
+    void start_capture(uint64_t frame);
+
+    // takes up to n samples, which start at the frame `frame`, and returns
+    // how many, which is none while a period waits for its analysis
+    unsigned collect(const float *in, unsigned n, uint64_t frame);
+    bool block_ready() const { return fill_ == len_ && blocks_done_ < blocks_; }
+    void analyze_block();
+    bool complete() const { return blocks_done_ == blocks_; }
+
+    unsigned blocks() const { return blocks_; }
+    // ratio of the clock of the loop to ours, minus one, if compensated
+    double drift() const;
+
+    // the responses to the tones played at the amplitude `amp` of the sum,
+    // and their SNR, 0 if the noise floor is not measured
+    void compute_response(std::complex<float> *response, float *snr, float amp) const;
+    // power at the bins not excited, relative to the excited bins
+    float compute_residual() const;
+
+private:
+    typedef std::complex<float> cfloat;
+
+    void begin_detection();
+    void compute_spectrum();
+    void compute_noise_floor(const cfloat *cplx);
+    void update_drift(const cfloat *cplx);
+    unsigned required_blocks(const cfloat *cplx) const;
+    float noise_scale() const;
+
+private:
+    const Dsp_Kernels *kernels_ = nullptr;
+    const Multitone_Generator *gen_ = nullptr;
+
+    // the capture, one period of the analysis
+    float *buf_ = nullptr;
+    unsigned len_ = 0;
+    unsigned fill_ = 0;
+    uint64_t capture_start_ = 0;
+    uint64_t block_start_ = 0;
+
+    float target_snr_ = 0;
+    unsigned blocks_ = 1;
+    unsigned blocks_done_ = 1;
+    cfloat *sum_ = nullptr;
+
+    // where the tones were found in the last period, and the loss of the
+    // window there
+    unsigned *peak_ = nullptr;
+    float *window_gain_ = nullptr;
+    unsigned *residual_bins_ = nullptr;
+
+    // ratio of the clock of the loop to ours, minus one, from the offsets of
+    // the tones off their bins, and the frame its phase counts from
+    double drift_ = 0;
+    double drift_weight_ = 0;
+    uint64_t drift_origin_ = 0;
+    bool drift_tracking_ = false;
+
+    // power of the noise at the bins of the analysis, with the generator muted,
+    // and the window it was measured with
+    float *noise_floor_ = nullptr;
+    bool noise_valid_ = false;
+    const Window_Table *noise_window_ = nullptr;
+
+    // the tables of all the windows at the size of the analysis, and the one
+    // which the current step selected
+    const Window_Table *windows_[Analysis::num_window_types] = {};
+    const Window_Table *window_ = nullptr;
+
+    float *fft_real_ = nullptr;
+    cfloat *fft_cplx_ = nullptr;
+    Fft_Plan fft_plan_;
+
+    // the detectors which follow the tones as they arrive, of few tones and
+    // of as many as a sweep plays; the transform still gives the drift, the
+    // noise floor and the residual
+    std::unique_ptr<Tone_Detector> detectors_[2];
+    Tone_Detector *detector_ = nullptr;
+    double *detector_freq_ = nullptr;
+    cfloat *detector_value_ = nullptr;
+};
@@ -0,0 +1,70 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "parameters.h"
+#include "analyzerdefs.h"
+
+Parameter_Block &Parameter_Block::instance()
+{
+    static Parameter_Block block;
+    return block;
+}
+
+Parameter_Block::Parameter_Block()
+{
+    Parameters p;
+    gain_.store(p.gain, std::memory_order_relaxed);
+    sample_rate_.store(p.sample_rate, std::memory_order_relaxed);
+    version_.store(p.version, std::memory_order_relaxed);
+}
+
+Parameters Parameter_Block::load() const
+{
+    Parameters p;
+    uint32_t seq1, seq2;
+    do {
+        seq1 = seq_.load(std::memory_order_acquire);
+        p.gain = gain_.load(std::memory_order_relaxed);
+        p.sample_rate = sample_rate_.load(std::memory_order_relaxed);
+        p.version = version_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        seq2 = seq_.load(std::memory_order_relaxed);
+    } while ((seq1 & 1) || seq1 != seq2);
+    return p;
+}
+
+void Parameter_Block::set_gain(float gain)
+{
+    Parameters p = load();
+    if (p.gain == gain)
+        return;
+    p.gain = gain;
+    store(p);
+}
+
+void Parameter_Block::set_sample_rate(float rate)
+{
+    Analysis::sample_rate = rate;
+
+    Parameters p = load();
+    if (p.sample_rate == rate)
+        return;
+    p.sample_rate = rate;
+    store(p);
+}
+
+void Parameter_Block::store(const Parameters &p)
+{
+    uint32_t version = p.version + 1;
+    version += (version == 0);
+
+    uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    gain_.store(p.gain, std::memory_order_relaxed);
+    sample_rate_.store(p.sample_rate, std::memory_order_relaxed);
+    version_.store(version, std::memory_order_relaxed);
+    seq_.store(seq + 2, std::memory_order_release);
+}
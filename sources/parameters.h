@@ -0,0 +1,46 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+//------------------------------------------------------------------------------
+// Parameters of the measurement which the audio threads follow while running.
+struct Parameters {
+    float gain = 0.5f;
+    float sample_rate = 0;
+    // changes with every update, and never 0
+    uint32_t version = 1;
+};
+
+//------------------------------------------------------------------------------
+// Block of the current parameters, published as a sequence lock.
+//
+// There is one writer, the control thread, and the audio threads read a
+// consistent snapshot without lock, retrying when they meet a write.
+class Parameter_Block {
+public:
+    static Parameter_Block &instance();
+
+    Parameters load() const;
+    float gain() const { return load().gain; }
+    uint32_t version() const { return load().version; }
+
+    // the setters make a new version, unless the value is the same
+    void set_gain(float gain);
+    // the rate also goes to Analysis::sample_rate, for the sizing of buffers
+    void set_sample_rate(float rate);
+
+private:
+    Parameter_Block();
+    void store(const Parameters &p);
+
+private:
+    std::atomic<uint32_t> seq_{0};
+    std::atomic<float> gain_;
+    std::atomic<float> sample_rate_;
+    std::atomic<uint32_t> version_;
+};
@@ -0,0 +1,69 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "processorchannel.h"
+#include "rtarena.h"
+#include <algorithm>
+#include <thread>
+#include <cmath>
+
+size_t Processor_Channel::footprint()
+{
+    return 2 * Rt_Arena::footprint<uint8_t>(Messages::max_size());
+}
+
+void Processor_Channel::configure(Rt_Arena &arena, float sample_rate)
+{
+    params_ = Parameter_Block::instance().load();
+    gain_ramp_.length(std::lround(10e-3f * sample_rate));
+    gain_ramp_.jump(params_.gain);
+
+    // room for two messages of the largest size
+    const size_t msg_size = Messages::max_size();
+    const size_t rb_size = std::max<size_t>(8192, 2 * msg_size);
+    rb_in_.reset(new Ring_Buffer(rb_size));
+    rb_out_.reset(new Ring_Buffer(rb_size));
+
+    rb_in_buf_ = arena.allocate<uint8_t>(msg_size);
+    rb_out_buf_ = arena.allocate<uint8_t>(msg_size);
+}
+
+void Processor_Channel::send_message(const Basic_Message &hmsg)
+{
+    Ring_Buffer &rb = *rb_in_;
+    while (!rb.put((uint8_t *)&hmsg, hmsg.size))
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+}
+
+Basic_Message *Processor_Channel::receive_message()
+{
+    return receive_message(*rb_out_);
+}
+
+Basic_Message *Processor_Channel::receive_message(Ring_Buffer &rb)
+{
+    Basic_Message *msg = (Basic_Message *)rb_out_buf_;
+
+    if (!rb.peek(*msg))
+        return nullptr;
+
+    size_t size = msg->size;
+    if (rb.size_used() < size)
+        return nullptr;
+
+    rb.get((uint8_t *)msg, size);
+    return msg;
+}
+
+void Processor_Channel::update_parameters()
+{
+    Parameters params = Parameter_Block::instance().load();
+    if (params.version == params_.version)
+        return;
+
+    if (params.gain != params_.gain)
+        gain_ramp_.target(params.gain);
+    params_ = params;
+}
@@ -0,0 +1,61 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include "messages.h"
+#include "parameters.h"
+#include "dsp/gain_ramp.h"
+#include "utility/ring_buffer.h"
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+class Rt_Arena;
+
+//------------------------------------------------------------------------------
+// What a processor shares with the control thread: the rings of the messages
+// in both directions, and the parameters of the cycle with the gain which
+// ramps to theirs.
+class Processor_Channel {
+public:
+    // the memory it takes from the arena of the processor
+    static size_t footprint();
+    void configure(Rt_Arena &arena, float sample_rate);
+
+    // the control side, which waits for room to send
+    void send_message(const Basic_Message &hmsg);
+    Basic_Message *receive_message();
+    // receives from another ring of the processor, into the same buffer
+    Basic_Message *receive_message(Ring_Buffer &rb);
+
+    // the audio side, once per cycle
+    void update_parameters();
+    template <class F> void handle_messages(F process);
+    Ring_Buffer &output() { return *rb_out_; }
+
+    const Parameters &params() const { return params_; }
+    Gain_Ramp<float> &gain_ramp() { return gain_ramp_; }
+
+private:
+    Parameters params_;
+    Gain_Ramp<float> gain_ramp_;
+
+    std::unique_ptr<Ring_Buffer> rb_in_;
+    std::unique_ptr<Ring_Buffer> rb_out_;
+    uint8_t *rb_in_buf_ = nullptr;
+    uint8_t *rb_out_buf_ = nullptr;
+};
+
+template <class F> void Processor_Channel::handle_messages(F process)
+{
+    Ring_Buffer &rb_in = *rb_in_;
+    Basic_Message *hmsg = (Basic_Message *)rb_in_buf_;
+    while (rb_in.peek(*hmsg)) {
+        size_t size = hmsg->size;
+        if (rb_in.size_used() < size)
+            break;
+        rb_in.get((uint8_t *)hmsg, size);
+        process(*hmsg);
+    }
+}
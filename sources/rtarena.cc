@@ -0,0 +1,51 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "rtarena.h"
+#include <new>
+#include <sys/mman.h>
+
+Rt_Arena::~Rt_Arena()
+{
+    release();
+}
+
+void Rt_Arena::reset(size_t capacity)
+{
+    release();
+    if (capacity == 0)
+        return;
+
+    // anonymous pages come zero-filled, and aligned beyond our needs
+    void *data = mmap(nullptr, capacity, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED)
+        throw std::bad_alloc();
+
+    data_ = (uint8_t *)data;
+    cap_ = capacity;
+    locked_ = mlock(data, capacity) == 0;
+}
+
+void *Rt_Arena::allocate_bytes(size_t size)
+{
+    if (size > cap_ - used_)
+        throw std::bad_alloc();
+    void *ptr = data_ + used_;
+    used_ += size;
+    return ptr;
+}
+
+void Rt_Arena::release()
+{
+    if (!data_)
+        return;
+    if (locked_)
+        munlock(data_, cap_);
+    munmap(data_, cap_);
+    data_ = nullptr;
+    cap_ = 0;
+    used_ = 0;
+    locked_ = false;
+}
@@ -0,0 +1,55 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+
+//------------------------------------------------------------------------------
+// Memory of the buffers which the audio thread uses, as one block allocated
+// and locked in RAM at configuration, then released all at once.
+//
+// The buffers are zero-filled, and aligned for the SIMD code of FFTW. If the
+// system refuses to lock the block, it works the same but may page out.
+class Rt_Arena {
+public:
+    enum { alignment = 64 };
+
+    Rt_Arena() {}
+    ~Rt_Arena();
+    Rt_Arena(const Rt_Arena &) = delete;
+    Rt_Arena &operator=(const Rt_Arena &) = delete;
+
+    // the space taken by a buffer of n elements
+    template <class T> static size_t footprint(size_t n)
+        { return (n * sizeof(T) + alignment - 1) & ~(size_t)(alignment - 1); }
+
+    // replaces the block, which invalidates the buffers taken from the last
+    void reset(size_t capacity);
+
+    // throws bad_alloc if the capacity is exceeded
+    template <class T> T *allocate(size_t n);
+
+    size_t capacity() const { return cap_; }
+    size_t used() const { return used_; }
+    bool locked() const { return locked_; }
+
+private:
+    void *allocate_bytes(size_t size);
+    void release();
+
+private:
+    uint8_t *data_ = nullptr;
+    size_t cap_ = 0;
+    size_t used_ = 0;
+    bool locked_ = false;
+};
+
+template <class T> T *Rt_Arena::allocate(size_t n)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "rt_arena: T must be trivially copyable");
+    return (T *)allocate_bytes(footprint<T>(n));
+}
@@ -0,0 +1,198 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "rtguard.h"
+
+#if !defined(SP_RT_GUARD)
+
+unsigned long Rt_Guard::violations()
+{
+    return 0;
+}
+
+void Rt_Guard::enter()
+{
+}
+
+void Rt_Guard::leave()
+{
+}
+
+#else
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <unistd.h>
+
+extern "C" {
+void *__libc_malloc(size_t);
+void *__libc_calloc(size_t, size_t);
+void *__libc_realloc(void *, size_t);
+void *__libc_memalign(size_t, size_t);
+void __libc_free(void *);
+ssize_t __write(int, const void *, size_t);
+ssize_t __read(int, void *, size_t);
+int __nanosleep(const struct timespec *, struct timespec *);
+}
+
+// without constructor, for use before the static initialization
+static __thread unsigned guard_depth;
+static __thread bool guard_reporting;
+static std::atomic<unsigned long> guard_violations{0};
+
+enum { max_reports = 32 };
+
+static void check(const char *call)
+{
+    if (guard_depth == 0 || guard_reporting)
+        return;
+
+    guard_reporting = true;
+    unsigned long count = ++guard_violations;
+    if (count <= max_reports) {
+        char line[128];
+        int len = snprintf(line, sizeof(line), "rt-guard: %s in the audio callback\n", call);
+        if (len > 0)
+            __write(2, line, len);
+        void *frames[32];
+        int depth = backtrace(frames, 32);
+        backtrace_symbols_fd(frames, depth, 2);
+    }
+    guard_reporting = false;
+}
+
+template <class F> static F next_symbol(F &fn, const char *name)
+{
+    if (!fn)
+        fn = (F)dlsym(RTLD_NEXT, name);
+    return fn;
+}
+
+__attribute__((constructor)) static void guard_init()
+{
+    // the first trace loads the unwinder, which allocates
+    void *frames[1];
+    backtrace(frames, 1);
+}
+
+__attribute__((destructor)) static void guard_fini()
+{
+    unsigned long count = guard_violations.load();
+    if (count > 0)
+        fprintf(stderr, "rt-guard: %lu unsafe calls in the audio callback\n", count);
+}
+
+unsigned long Rt_Guard::violations()
+{
+    return guard_violations.load();
+}
+
+void Rt_Guard::enter()
+{
+    ++guard_depth;
+}
+
+void Rt_Guard::leave()
+{
+    --guard_depth;
+}
+
+//------------------------------------------------------------------------------
+extern "C" {
+
+void *malloc(size_t size)
+{
+    check("malloc");
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    check("calloc");
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    check("realloc");
+    return __libc_realloc(ptr, size);
+}
+
+int posix_memalign(void **ptr, size_t align, size_t size)
+{
+    check("posix_memalign");
+    void *mem = __libc_memalign(align, size);
+    if (!mem)
+        return ENOMEM;
+    *ptr = mem;
+    return 0;
+}
+
+void *aligned_alloc(size_t align, size_t size)
+{
+    check("aligned_alloc");
+    return __libc_memalign(align, size);
+}
+
+void free(void *ptr)
+{
+    if (ptr)
+        check("free");
+    __libc_free(ptr);
+}
+
+int pthread_mutex_lock(pthread_mutex_t *mutex)
+{
+    check("pthread_mutex_lock");
+    static int (*fn)(pthread_mutex_t *);
+    return next_symbol(fn, "pthread_mutex_lock")(mutex);
+}
+
+int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
+{
+    check("pthread_cond_wait");
+    // the default version, rather than the old one of dlsym
+    static int (*fn)(pthread_cond_t *, pthread_mutex_t *);
+    if (!fn)
+        fn = (int (*)(pthread_cond_t *, pthread_mutex_t *))dlvsym(RTLD_NEXT, "pthread_cond_wait", "GLIBC_2.3.2");
+    return fn(cond, mutex);
+}
+
+int nanosleep(const struct timespec *req, struct timespec *rem)
+{
+    check("nanosleep");
+    return __nanosleep(req, rem);
+}
+
+int usleep(useconds_t usec)
+{
+    check("usleep");
+    struct timespec req;
+    req.tv_sec = usec / 1000000;
+    req.tv_nsec = (usec % 1000000) * 1000;
+    return __nanosleep(&req, nullptr);
+}
+
+ssize_t read(int fd, void *buf, size_t count)
+{
+    check("read");
+    return __read(fd, buf, count);
+}
+
+ssize_t write(int fd, const void *buf, size_t count)
+{
+    check("write");
+    return __write(fd, buf, count);
+}
+
+}  // extern "C"
+
+#endif
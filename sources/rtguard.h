@@ -0,0 +1,35 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+//------------------------------------------------------------------------------
+// Detector of the calls which are not safe in the audio callback.
+//
+// In the build with `CONFIG += rt_guard`, the program interposes the memory
+// allocator and some blocking calls, and when the thread is in a guarded
+// scope, it reports each of these calls on the standard error with a stack
+// trace. In the normal build, the scope does nothing.
+class Rt_Guard {
+public:
+    class Scope {
+    public:
+#if defined(SP_RT_GUARD)
+        Scope() { enter(); }
+        ~Scope() { leave(); }
+#else
+        Scope() {}
+#endif
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+    // count of the calls detected since the start
+    static unsigned long violations();
+
+private:
+    static void enter();
+    static void leave();
+};
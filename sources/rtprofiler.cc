@@ -0,0 +1,124 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "rtprofiler.h"
+#include <thread>
+#include <cstdio>
+
+Rt_Profiler::Rt_Profiler(float sample_rate)
+    : sample_rate_(sample_rate)
+{
+    for (Histogram &h : hist_) {
+        for (std::atomic<uint32_t> &b : h.bucket)
+            b.store(0, std::memory_order_relaxed);
+        h.count.store(0, std::memory_order_relaxed);
+        h.sum.store(0, std::memory_order_relaxed);
+        h.worst.store(0, std::memory_order_relaxed);
+        h.worst_load.store(0, std::memory_order_relaxed);
+        h.xruns.store(0, std::memory_order_relaxed);
+    }
+
+#if defined(__i386__) || defined(__x86_64__)
+    // calibrate the time stamp counter against the steady clock
+    typedef std::chrono::steady_clock clock;
+    clock::time_point t1 = clock::now();
+    Tick c1 = now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    clock::time_point t2 = clock::now();
+    Tick c2 = now();
+    double seconds = std::chrono::duration<double>(t2 - t1).count();
+    ticks_per_second_ = (c2 - c1) / seconds;
+#else
+    ticks_per_second_ = 1e9;
+#endif
+}
+
+const char *Rt_Profiler::stage_name(int stage)
+{
+    switch (stage) {
+    case Stage_Messages: return "handle_messages";
+    case Stage_Generate: return "generate";
+    case Stage_Collect: return "collect";
+    case Stage_Response: return "compute_response";
+    case Stage_Stream: return "stream_push";
+    case Stage_Levels: return "update_levels";
+    case Stage_Cycle: return "cycle";
+    default: return "unknown";
+    }
+}
+
+void Rt_Profiler::xrun()
+{
+    xruns_.fetch_add(1, std::memory_order_relaxed);
+}
+
+Rt_Profiler::Tick Rt_Profiler::bucket_value(unsigned b)
+{
+    if (b < (1u << sub_bits))
+        return b;
+    unsigned msb = (b >> sub_bits) + sub_bits - 1;
+    Tick sub = b & ((1u << sub_bits) - 1);
+    return (sub | (1u << sub_bits)) << (msb - sub_bits);
+}
+
+Rt_Profiler::Stats Rt_Profiler::stats(int stage) const
+{
+    Stats st;
+    const Histogram &h = hist_[stage];
+    const double us_per_tick = 1e6 / ticks_per_second_;
+
+    uint32_t counts[num_buckets];
+    uint64_t total = 0;
+    for (unsigned b = 0; b < num_buckets; ++b)
+        total += counts[b] = h.bucket[b].load(std::memory_order_relaxed);
+
+    st.count = total;
+    st.worst_us = h.worst.load(std::memory_order_relaxed) * us_per_tick;
+    st.worst_load = h.worst_load.load(std::memory_order_relaxed) * 1e-6;
+    st.xruns = h.xruns.load(std::memory_order_relaxed);
+    if (total == 0)
+        return st;
+
+    uint64_t sum = h.sum.load(std::memory_order_relaxed);
+    st.mean_us = sum * us_per_tick / total;
+    if (uint64_t budget = budget_sum_.load(std::memory_order_relaxed))
+        st.mean_load = (double)sum / budget;
+
+    const double quantiles[] = {0.5, 0.99, 0.999};
+    double *results[] = {&st.p50_us, &st.p99_us, &st.p999_us};
+    uint64_t cumul = 0;
+    unsigned q = 0;
+    for (unsigned b = 0; b < num_buckets && q < 3; ++b) {
+        cumul += counts[b];
+        while (q < 3 && cumul >= quantiles[q] * total)
+            *results[q++] = bucket_value(b) * us_per_tick;
+    }
+
+    return st;
+}
+
+std::string Rt_Profiler::report() const
+{
+    std::string text;
+    char line[256];
+
+    snprintf(line, sizeof(line), "%-18s %10s %9s %9s %9s %9s %9s %7s %7s %6s\n",
+             "stage", "count", "mean us", "p50 us", "p99 us", "p99.9 us", "worst us",
+             "load%", "worst%", "xruns");
+    text.append(line);
+
+    for (unsigned s = 0; s < Stage_Count; ++s) {
+        Stats st = stats(s);
+        snprintf(line, sizeof(line), "%-18s %10llu %9.2f %9.2f %9.2f %9.2f %9.2f %7.2f %7.2f %6lu\n",
+                 stage_name(s), (unsigned long long)st.count, st.mean_us,
+                 st.p50_us, st.p99_us, st.p999_us, st.worst_us,
+                 100 * st.mean_load, 100 * st.worst_load, st.xruns);
+        text.append(line);
+    }
+
+    snprintf(line, sizeof(line), "total xruns: %lu\n", xruns());
+    text.append(line);
+    return text;
+}
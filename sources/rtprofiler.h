@@ -0,0 +1,193 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <atomic>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#if defined(__i386__) || defined(__x86_64__)
+#    include <x86intrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Timing of the stages of the audio callback.
+//
+// The real-time thread records the duration of each stage into preallocated
+// log-scale histograms, with relaxed atomics only, and other threads read the
+// statistics whenever they want. A cycle which overruns its period is counted
+// by the real-time thread itself, and blamed on its longest stage; the xruns
+// notified by the server are only counted, since they may come from elsewhere.
+class Rt_Profiler {
+public:
+    enum Stage {
+        Stage_Messages,
+        Stage_Generate,
+        Stage_Collect,
+        Stage_Response,
+        Stage_Stream,
+        Stage_Levels,
+        Stage_Cycle,
+        Stage_Count,
+    };
+
+    typedef uint64_t Tick;
+
+    explicit Rt_Profiler(float sample_rate);
+
+    static const char *stage_name(int stage);
+    static Tick now();
+    double ticks_per_second() const { return ticks_per_second_; }
+
+    // to call while the real-time thread is held, the statistics are kept
+    void set_sample_rate(float sample_rate) { sample_rate_ = sample_rate; }
+
+    // called by the real-time thread
+    void begin_cycle(unsigned nframes);
+    void end_cycle();
+    void begin(Stage stage);
+    void end(Stage stage);
+
+    // called by the xrun notification
+    void xrun();
+
+    struct Stats {
+        uint64_t count = 0;
+        double mean_us = 0;
+        double p50_us = 0;
+        double p99_us = 0;
+        double p999_us = 0;
+        double worst_us = 0;
+        double mean_load = 0;  // fraction of the period
+        double worst_load = 0;
+        unsigned long xruns = 0;
+    };
+
+    Stats stats(int stage) const;
+    unsigned long xruns() const { return xruns_.load(std::memory_order_relaxed); }
+    std::string report() const;
+
+    class Scope {
+    public:
+        Scope(Rt_Profiler &prof, Stage stage) : prof_(prof), stage_(stage) { prof.begin(stage); }
+        ~Scope() { prof_.end(stage_); }
+    private:
+        Rt_Profiler &prof_;
+        Stage stage_;
+    };
+
+private:
+    // 8 buckets per octave of ticks
+    enum { sub_bits = 3, num_buckets = 64 << sub_bits };
+    static unsigned bucket_of(Tick t);
+    static Tick bucket_value(unsigned b);
+
+    struct Histogram {
+        std::atomic<uint32_t> bucket[num_buckets];
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum;
+        std::atomic<uint64_t> worst;
+        std::atomic<uint32_t> worst_load; // per 10⁶
+        std::atomic<unsigned long> xruns;
+    };
+
+    double ticks_per_second_ = 0;
+    float sample_rate_ = 0;
+
+    Histogram hist_[Stage_Count];
+    std::atomic<uint64_t> budget_sum_{0};
+    std::atomic<unsigned long> xruns_{0};
+
+    // owned by the real-time thread
+    Tick cycle_budget_ = 0;
+    Tick stage_start_[Stage_Count] = {};
+    Tick stage_time_[Stage_Count] = {};
+
+    void record(Stage stage, Tick t);
+    void count_overrun(Stage stage);
+};
+
+//------------------------------------------------------------------------------
+inline Rt_Profiler::Tick Rt_Profiler::now()
+{
+#if defined(__i386__) || defined(__x86_64__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+inline void Rt_Profiler::begin_cycle(unsigned nframes)
+{
+    cycle_budget_ = (Tick)(nframes * ticks_per_second_ / sample_rate_);
+    for (unsigned s = 0; s < Stage_Count; ++s)
+        stage_time_[s] = 0;
+    stage_start_[Stage_Cycle] = now();
+}
+
+inline void Rt_Profiler::end_cycle()
+{
+    Tick t = now() - stage_start_[Stage_Cycle];
+    stage_time_[Stage_Cycle] = t;
+    record(Stage_Cycle, t);
+
+    int longest = -1;
+    for (unsigned s = 0; s < Stage_Cycle; ++s) {
+        if (longest == -1 || stage_time_[s] > stage_time_[longest])
+            longest = s;
+    }
+    budget_sum_.fetch_add(cycle_budget_, std::memory_order_relaxed);
+
+    if (cycle_budget_ > 0 && t > cycle_budget_) {
+        count_overrun(Stage_Cycle);
+        if (longest != -1)
+            count_overrun((Stage)longest);
+    }
+}
+
+inline void Rt_Profiler::begin(Stage stage)
+{
+    stage_start_[stage] = now();
+}
+
+inline void Rt_Profiler::end(Stage stage)
+{
+    Tick t = now() - stage_start_[stage];
+    stage_time_[stage] += t;
+    record(stage, t);
+}
+
+inline unsigned Rt_Profiler::bucket_of(Tick t)
+{
+    if (t < (1u << sub_bits))
+        return (unsigned)t;
+    unsigned msb = 63 - __builtin_clzll(t);
+    unsigned sub = (unsigned)(t >> (msb - sub_bits)) & ((1u << sub_bits) - 1);
+    return ((msb - sub_bits + 1) << sub_bits) | sub;
+}
+
+inline void Rt_Profiler::record(Stage stage, Tick t)
+{
+    Histogram &h = hist_[stage];
+    // single writer, so these need no atomic read-modify-write
+    std::atomic<uint32_t> &bucket = h.bucket[bucket_of(t)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    h.count.store(h.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    h.sum.store(h.sum.load(std::memory_order_relaxed) + t, std::memory_order_relaxed);
+    if (t > h.worst.load(std::memory_order_relaxed))
+        h.worst.store(t, std::memory_order_relaxed);
+    if (cycle_budget_ > 0) {
+        uint32_t load = (uint32_t)(t * 1000000 / cycle_budget_);
+        if (load > h.worst_load.load(std::memory_order_relaxed))
+            h.worst_load.store(load, std::memory_order_relaxed);
+    }
+}
+
+inline void Rt_Profiler::count_overrun(Stage stage)
+{
+    std::atomic<unsigned long> &xruns = hist_[stage].xruns;
+    xruns.store(xruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
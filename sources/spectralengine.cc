@@ -0,0 +1,295 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "spectralengine.h"
+#include "audiosys.h"
+#include "audioprocessor.h"
+#include "sweepscheduler.h"
+#include "sweepcheckpoint.h"
+#include "analyzerdefs.h"
+#include "parameters.h"
+#include "messages.h"
+#include "dsp/eq_fit.h"
+#include <deque>
+#include <vector>
+#include <memory>
+#include <new>
+#include <algorithm>
+#include <cmath>
+
+struct sp_engine {
+    std::unique_ptr<Audio_Processor> proc_;
+    Sweep_Checkpoint checkpoint_;
+    Sweep_Scheduler sched_;
+    bool active_ = false;
+    bool waiting_ = false;
+    unsigned sweeps_ = 0;
+    // the rate which the grid was made for
+    double sample_rate_ = 0;
+    Message_Buffer request_buf_;
+    std::deque<sp_point> points_;
+};
+
+static bool engine_exists = false;
+
+sp_engine *sp_engine_create(const char *client_name)
+{
+    if (engine_exists)
+        return nullptr;
+
+    if (client_name)
+        Audio_Sys::set_client_name(client_name);
+    Audio_Sys &sys = Audio_Sys::instance();
+    if (!sys)
+        return nullptr;
+
+    Parameter_Block::instance().set_sample_rate(sys.sample_rate());
+
+    std::unique_ptr<sp_engine> engine(new (std::nothrow) sp_engine);
+    if (!engine)
+        return nullptr;
+
+    try {
+        engine->proc_.reset(new Audio_Processor);
+    }
+    catch (std::bad_alloc &) {
+        return nullptr;
+    }
+
+    // the generator rounds the frequencies to the bins of the analysis
+    engine->sched_.set_resolution(Analysis::sample_rate / engine->proc_->fft_size());
+    engine->sample_rate_ = Analysis::sample_rate;
+    engine->proc_->start();
+
+    engine_exists = true;
+    return engine.release();
+}
+
+void sp_engine_destroy(sp_engine *engine)
+{
+    if (!engine)
+        return;
+    Audio_Sys::instance().stop();
+    delete engine;
+    engine_exists = false;
+}
+
+void sp_engine_default_config(sp_config *config)
+{
+    config->lo_enable = 1;
+    config->hi_enable = 1;
+    config->parallel = 1;
+    config->adaptive = 0;
+    config->uncertainty_db = 0;
+    config->window = SP_WINDOW_HANN;
+    config->gain_db = 20 * std::log10(Parameter_Block::instance().gain());
+}
+
+int sp_engine_configure(sp_engine *engine, const sp_config *config)
+{
+    if (config->parallel > Analysis::max_parallel)
+        return -1;
+    if (!(config->uncertainty_db >= 0 && config->uncertainty_db <= Analysis::max_target_uncertainty))
+        return -1;
+    if (config->window < 0 || (unsigned)config->window >= Analysis::num_window_types)
+        return -1;
+
+    Sweep_Scheduler &sched = engine->sched_;
+    sched.set_levels(config->lo_enable, config->hi_enable);
+    sched.set_freqs_at_once(config->parallel);
+    if (sched.adaptive() != (bool)config->adaptive)
+        sched.set_adaptive(config->adaptive);
+    sched.set_target_uncertainty(config->uncertainty_db);
+    sched.set_window(config->window);
+    Parameter_Block::instance().set_gain(std::pow(10.0, config->gain_db * 0.05));
+
+    int next = sched.next_level(sched.level());
+    if (next != -1)
+        sched.set_level(next);
+    return 0;
+}
+
+int sp_engine_set_checkpoint(sp_engine *engine, const char *path)
+{
+    engine->sched_.set_checkpoint(nullptr);
+    engine->checkpoint_.close();
+    if (!path)
+        return 0;
+    if (!engine->checkpoint_.open(path))
+        return -1;
+    engine->sched_.set_checkpoint(&engine->checkpoint_);
+    return 0;
+}
+
+void sp_engine_start(sp_engine *engine)
+{
+    // a step dropped by the last stop gets no result
+    engine->active_ = true;
+    engine->waiting_ = false;
+    if (!engine->sched_.resume())
+        engine->sched_.restart();
+}
+
+void sp_engine_restart(sp_engine *engine)
+{
+    if (engine->checkpoint_.is_open())
+        engine->checkpoint_.clear();
+    engine->active_ = true;
+    engine->waiting_ = false;
+    engine->sched_.restart();
+}
+
+void sp_engine_stop(sp_engine *engine)
+{
+    engine->active_ = false;
+    // the processor drops the step in progress, without a result
+    engine->waiting_ = false;
+
+    Messages::RequestStop msg;
+    engine->proc_->send_message(msg);
+}
+
+unsigned sp_engine_poll(sp_engine *engine, sp_point *points, unsigned max_points)
+{
+    Audio_Processor &proc = *engine->proc_;
+    Sweep_Scheduler &sched = engine->sched_;
+
+    // the server changed its rate or its period, and the step in progress is
+    // lost with the buffers of the processor, which are rebuilt for it; it is
+    // sent again below, and the grid only starts over at a new rate
+    Audio_Sys &sys = Audio_Sys::instance();
+    if (sys.config_changed()) {
+        unsigned serial = sys.suspend();
+        Parameter_Block::instance().set_sample_rate(sys.sample_rate());
+        proc.reconfigure();
+        proc.start_analyzers();
+        if (Analysis::sample_rate != engine->sample_rate_) {
+            engine->sample_rate_ = Analysis::sample_rate;
+            sched.set_resolution(Analysis::sample_rate / proc.fft_size());
+            sched.reset_grid();
+            if (engine->active_ && !sched.resume())
+                sched.restart();
+        }
+        engine->waiting_ = false;
+        sys.resume(serial);
+    }
+
+    while (Basic_Message *hmsg = proc.receive_message()) {
+        if (hmsg->tag != Message_Tag::NotifyFrequencyAnalysis)
+            continue;
+
+        auto *msg = (Messages::NotifyFrequencyAnalysis *)hmsg;
+        engine->waiting_ = false;
+
+        // the step disturbed by a change of parameters is measured again
+        if (msg->version == 0)
+            continue;
+
+        int spl = msg->spl;
+        if (sched.probing()) {
+            sched.probe(spl, msg->residual);
+            continue;
+        }
+
+        sched.store(*msg);
+        const float *frequency = msg->frequency();
+        const Sweep_Scheduler::cfloat *response = msg->response();
+        const float *snr = msg->snr();
+        for (unsigned a = 0; a < sched.step_size(); ++a) {
+            sp_point point;
+            point.level = spl;
+            point.frequency = frequency[a];
+            point.magnitude = std::abs(response[a]);
+            point.phase = std::arg(response[a]);
+            point.snr = snr[a];
+            point.uncertainty_db = Analysis::snr_uncertainty_db(snr[a]);
+            engine->points_.push_back(point);
+        }
+
+        if (sched.finish_step(spl).sweep_done)
+            ++engine->sweeps_;
+    }
+
+    if (engine->active_ && !engine->waiting_ && sched.next_level(sched.level()) != -1) {
+        proc.send_message(sched.plan(engine->request_buf_));
+        engine->waiting_ = true;
+    }
+
+    std::deque<sp_point> &queue = engine->points_;
+    unsigned count = 0;
+    for (; count < max_points && !queue.empty(); ++count) {
+        points[count] = queue.front();
+        queue.pop_front();
+    }
+    return count;
+}
+
+unsigned sp_engine_sweeps_completed(const sp_engine *engine)
+{
+    return engine->sweeps_;
+}
+
+double sp_engine_progress(const sp_engine *engine)
+{
+    return engine->sched_.completion();
+}
+
+unsigned sp_engine_response(
+    const sp_engine *engine, int level,
+    double *frequencies, double *magnitudes, double *phases, unsigned max_points)
+{
+    if (level != SP_LEVEL_LO && level != SP_LEVEL_HI)
+        return 0;
+
+    const Sweep_Scheduler &sched = engine->sched_;
+    const double *freqs = sched.frequencies();
+    const Sweep_Scheduler::cfloat *response = sched.response(level);
+
+    unsigned count = std::min(sched.size(), max_points);
+    for (unsigned i = 0; i < count; ++i) {
+        frequencies[i] = freqs[i];
+        magnitudes[i] = std::abs(response[i]);
+        phases[i] = std::arg(response[i]);
+    }
+    return count;
+}
+
+unsigned sp_engine_fit_eq(
+    const sp_engine *engine, int level,
+    const double *target_frequencies, const double *target_db, unsigned target_points,
+    double sample_rate, sp_eq_section *sections, unsigned max_sections, double *gain_db)
+{
+    if (level != SP_LEVEL_LO && level != SP_LEVEL_HI)
+        return 0;
+
+    const Sweep_Scheduler &sched = engine->sched_;
+    const unsigned ns = sched.size();
+    const double *freqs = sched.frequencies();
+    const Sweep_Scheduler::cfloat *response = sched.response(level);
+
+    std::vector<double> response_db(ns), target(ns);
+    for (unsigned i = 0; i < ns; ++i)
+        response_db[i] = 20 * std::log10(std::max(std::abs(response[i]), 1e-10f));
+    if (target_points > 0)
+        resample_curve(target_frequencies, target_db, target_points, freqs, target.data(), ns);
+
+    Eq_Fit_Params params;
+    params.sections = max_sections;
+    params.sample_rate = sample_rate;
+    Eq_Fit fit = fit_eq(freqs, response_db.data(), sched.valid(level),
+                        (target_points > 0) ? target.data() : nullptr, ns, params);
+
+    unsigned count = std::min((unsigned)fit.sections.size(), max_sections);
+    for (unsigned s = 0; s < count; ++s) {
+        const Eq_Section &section = fit.sections[s];
+        sections[s].frequency = section.frequency;
+        sections[s].gain_db = section.gain_db;
+        sections[s].q = section.q;
+        eq_section_coefficients(section, sample_rate, sections[s].coefs);
+    }
+    if (gain_db)
+        *gain_db = fit.gain_db;
+    return count;
+}
@@ -0,0 +1,110 @@
+/*          Copyright Jean Pierre Cimalando 2018.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+
+/*
+ * C interface of the measurement engine, to run the stepped sine sweep
+ * without the graphical interface.
+ *
+ * The engine is a JACK client, of which there is one per process. It is not
+ * thread-safe: all calls are from the same thread, which must poll the engine
+ * regularly for the sweep to progress.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct sp_engine sp_engine;
+
+enum {
+    SP_LEVEL_LO = 0,
+    SP_LEVEL_HI = 1,
+};
+
+enum {
+    SP_WINDOW_HANN = 0,
+    SP_WINDOW_FLAT_TOP = 1,
+    SP_WINDOW_BLACKMAN_HARRIS = 2,
+};
+
+typedef struct sp_config {
+    int lo_enable;
+    int hi_enable;
+    /* frequencies measured at once, 0 for automatic */
+    unsigned parallel;
+    int adaptive;
+    double gain_db;
+    /* uncertainty which sets the length of the captures from the noise
+       floor, 0 for captures of fixed length */
+    double uncertainty_db;
+    /* window of the analysis, SP_WINDOW_HANN by default */
+    int window;
+} sp_config;
+
+typedef struct sp_point {
+    int level;
+    double frequency;
+    double magnitude;
+    double phase;
+    /* power relative to the noise floor, 0 if unknown, and the resulting
+       standard uncertainty of the magnitude */
+    double snr;
+    double uncertainty_db;
+} sp_point;
+
+/* returns NULL if JACK is not available, or an engine exists already */
+sp_engine *sp_engine_create(const char *client_name);
+void sp_engine_destroy(sp_engine *engine);
+
+void sp_engine_default_config(sp_config *config);
+/* returns 0 on success, -1 on invalid configuration */
+int sp_engine_configure(sp_engine *engine, const sp_config *config);
+
+/* keeps the sweep in progress in a file, or in none if the path is NULL,
+   and returns 0 on success, -1 if the file cannot be mapped */
+int sp_engine_set_checkpoint(sp_engine *engine, const char *path);
+
+/* the start resumes the partial sweep of the checkpoint, if it was made with
+   the same configuration, and the restart discards it */
+void sp_engine_start(sp_engine *engine);
+void sp_engine_restart(sp_engine *engine);
+void sp_engine_stop(sp_engine *engine);
+
+/* advances the sweep, and returns the count of new points stored; it also
+   rebuilds the engine if the server changed its rate or its period, and the
+   sweep starts over, unless the checkpoint resumes it at the same rate */
+unsigned sp_engine_poll(sp_engine *engine, sp_point *points, unsigned max_points);
+
+unsigned sp_engine_sweeps_completed(const sp_engine *engine);
+double sp_engine_progress(const sp_engine *engine);
+
+/* copies the response at a level, and returns the count of points */
+unsigned sp_engine_response(
+    const sp_engine *engine, int level,
+    double *frequencies, double *magnitudes, double *phases, unsigned max_points);
+
+typedef struct sp_eq_section {
+    double frequency;
+    double gain_db;
+    double q;
+    /* b0 b1 b2 a1 a2, for a0 = 1 */
+    double coefs[5];
+} sp_eq_section;
+
+/* fits peaking sections which bring the response at a level to a target
+   curve, given at its own frequencies, or flat if it has no points, for a
+   filter at the given sample rate; returns the count of sections, and the
+   gain to apply with them */
+unsigned sp_engine_fit_eq(
+    const sp_engine *engine, int level,
+    const double *target_frequencies, const double *target_db, unsigned target_points,
+    double sample_rate, sp_eq_section *sections, unsigned max_sections, double *gain_db);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
@@ -0,0 +1,159 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "streamanalyzer.h"
+#include "workerpool.h"
+#include "utility/ring_buffer.h"
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <cassert>
+
+struct Stream_Analyzer::Impl : Worker_Task {
+    Stream_Analyzer *self_ = nullptr;
+    unsigned channels_ = 0;
+    unsigned block_size_ = 0;
+    unsigned hop_size_ = 0;
+
+    std::vector<std::unique_ptr<Ring_Buffer>> rb_;
+    std::vector<std::unique_ptr<float[]>> history_;
+    std::vector<float *> history_ptrs_;
+    unsigned fill_ = 0;
+
+    bool attached_ = false;
+    std::atomic<bool> reset_{false};
+    std::atomic<unsigned long> overruns_{0};
+
+    bool service() override;
+    void discard_input();
+};
+
+Stream_Analyzer::Stream_Analyzer(unsigned channels, unsigned block_size, unsigned hop_size)
+    : P(new Impl)
+{
+    assert(hop_size > 0 && hop_size <= block_size);
+
+    P->self_ = this;
+    P->channels_ = channels;
+    P->block_size_ = block_size;
+    P->hop_size_ = hop_size;
+
+    for (unsigned c = 0; c < channels; ++c) {
+        P->rb_.emplace_back(new Ring_Buffer(4 * block_size * sizeof(float)));
+        P->history_.emplace_back(new float[block_size]());
+        P->history_ptrs_.push_back(P->history_.back().get());
+    }
+}
+
+Stream_Analyzer::~Stream_Analyzer()
+{
+    assert(!P->attached_);
+}
+
+void Stream_Analyzer::start()
+{
+    if (P->attached_)
+        return;
+    Worker_Pool::instance().attach(P.get());
+    P->attached_ = true;
+}
+
+void Stream_Analyzer::stop()
+{
+    if (!P->attached_)
+        return;
+    Worker_Pool::instance().detach(P.get());
+    P->attached_ = false;
+}
+
+unsigned Stream_Analyzer::channels() const
+{
+    return P->channels_;
+}
+
+unsigned Stream_Analyzer::block_size() const
+{
+    return P->block_size_;
+}
+
+unsigned Stream_Analyzer::hop_size() const
+{
+    return P->hop_size_;
+}
+
+void Stream_Analyzer::request_reset()
+{
+    P->reset_ = true;
+}
+
+unsigned long Stream_Analyzer::overruns() const
+{
+    return P->overruns_.load(std::memory_order_relaxed);
+}
+
+bool Stream_Analyzer::push(const float *const *data, unsigned n)
+{
+    const unsigned channels = P->channels_;
+    const size_t size = n * sizeof(float);
+
+    for (unsigned c = 0; c < channels; ++c) {
+        if (P->rb_[c]->size_free() < size) {
+            P->overruns_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    for (unsigned c = 0; c < channels; ++c)
+        P->rb_[c]->put(data[c], n);
+    return true;
+}
+
+bool Stream_Analyzer::Impl::service()
+{
+    const unsigned channels = channels_;
+    const unsigned block_size = block_size_;
+    const unsigned hop_size = hop_size_;
+
+    if (reset_.exchange(false)) {
+        discard_input();
+        fill_ = 0;
+        self_->reset();
+    }
+
+    size_t avail = ~(size_t)0;
+    for (unsigned c = 0; c < channels; ++c)
+        avail = std::min(avail, rb_[c]->size_used() / sizeof(float));
+
+    if (avail == 0)
+        return false;
+
+    unsigned fill = fill_;
+    unsigned count = (unsigned)std::min<size_t>(avail, block_size - fill);
+    for (unsigned c = 0; c < channels; ++c)
+        rb_[c]->get(&history_ptrs_[c][fill], count);
+    fill += count;
+
+    if (fill == block_size) {
+        self_->process_block(history_ptrs_.data(), block_size);
+        for (unsigned c = 0; c < channels; ++c) {
+            float *history = history_ptrs_[c];
+            std::copy(history + hop_size, history + block_size, history);
+        }
+        fill = block_size - hop_size;
+    }
+
+    fill_ = fill;
+    return true;
+}
+
+void Stream_Analyzer::Impl::discard_input()
+{
+    // the same amount on all channels, so they stay aligned
+    size_t avail = ~(size_t)0;
+    for (unsigned c = 0; c < channels_; ++c)
+        avail = std::min(avail, rb_[c]->size_used());
+    for (unsigned c = 0; c < channels_; ++c)
+        rb_[c]->discard(avail);
+}
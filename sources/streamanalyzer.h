@@ -0,0 +1,42 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <memory>
+
+//------------------------------------------------------------------------------
+// Continuous analysis of audio streams on the worker pool.
+//
+// The real-time thread pushes the channels into lock-free ring buffers, and the
+// worker cuts them into overlapped blocks passed to `process_block`.
+// Derived classes must call `stop` in their destructor.
+class Stream_Analyzer {
+public:
+    Stream_Analyzer(unsigned channels, unsigned block_size, unsigned hop_size);
+    virtual ~Stream_Analyzer();
+
+    void start();
+    void stop();
+
+    unsigned channels() const;
+    unsigned block_size() const;
+    unsigned hop_size() const;
+
+    // discard buffered input and restart the analysis (non-RT)
+    void request_reset();
+    // number of pushes dropped because the worker fell behind
+    unsigned long overruns() const;
+
+    // called by the real-time thread
+    bool push(const float *const *data, unsigned n);
+
+protected:
+    virtual void process_block(const float *const *block, unsigned size) = 0;
+    virtual void reset() {}
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> P;
+};
@@ -0,0 +1,74 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "sweepcheckpoint.h"
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char checkpoint_magic[8] = {'S', 'P', 'S', 'W', 'E', 'E', 'P', '\0'};
+static const uint32_t checkpoint_layout = sizeof(Sweep_Checkpoint_Data);
+
+Sweep_Checkpoint::~Sweep_Checkpoint()
+{
+    close();
+}
+
+bool Sweep_Checkpoint::open(const std::string &path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDWR|O_CREAT|O_CLOEXEC, 0644);
+    if (fd == -1)
+        return false;
+
+    const size_t size = sizeof(Sweep_Checkpoint_Data);
+    struct stat st;
+    bool fresh = fstat(fd, &st) == -1 || (size_t)st.st_size != size;
+    if (fresh && (ftruncate(fd, 0) == -1 || ftruncate(fd, size) == -1)) {
+        ::close(fd);
+        return false;
+    }
+
+    // the mapping stays valid once the file is closed
+    void *data = mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    data_ = (Sweep_Checkpoint_Data *)data;
+    if (memcmp(data_->magic, checkpoint_magic, sizeof(checkpoint_magic)) || data_->layout != checkpoint_layout)
+        clear();
+    return true;
+}
+
+void Sweep_Checkpoint::close()
+{
+    if (!data_)
+        return;
+    sync();
+    munmap(data_, sizeof(Sweep_Checkpoint_Data));
+    data_ = nullptr;
+}
+
+bool Sweep_Checkpoint::has_state() const
+{
+    return data_ && data_->num_points > 0 && !data_->writing;
+}
+
+void Sweep_Checkpoint::clear()
+{
+    memset((void *)data_, 0, sizeof(Sweep_Checkpoint_Data));
+    memcpy(data_->magic, checkpoint_magic, sizeof(checkpoint_magic));
+    data_->layout = checkpoint_layout;
+}
+
+void Sweep_Checkpoint::sync()
+{
+    if (data_)
+        msync(data_, sizeof(Sweep_Checkpoint_Data), MS_ASYNC);
+}
@@ -0,0 +1,69 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include "analyzerdefs.h"
+#include <complex>
+#include <string>
+#include <cstdint>
+
+//------------------------------------------------------------------------------
+// The state of a sweep in a file mapped in memory, which the scheduler writes
+// as the points complete, so that a sweep interrupted by the exit of the
+// program, or by a failure of the device, can resume where it stopped.
+//
+// The points are written before the bits which mark them measured, so an
+// interrupted write loses at most the step in progress. The rewrites of the
+// whole state are marked in the header until they are complete.
+struct Sweep_Checkpoint_Data {
+    enum { capacity = Analysis::sweep_capacity };
+
+    char magic[8];
+    uint32_t layout;
+    uint32_t writing;
+
+    // the settings which the grid and the schedule depend on
+    double resolution;
+    uint8_t adaptive;
+    uint8_t lo_enable;
+    uint8_t hi_enable;
+    uint8_t level;
+    uint32_t num_points;
+    uint32_t index;
+
+    uint64_t progress[capacity / 64];
+    double freqs[capacity];
+    std::complex<float> response[2][capacity];
+    float snr[2][capacity];
+    uint8_t valid[2][capacity];
+    uint8_t coarse[capacity];
+};
+
+class Sweep_Checkpoint {
+public:
+    Sweep_Checkpoint() {}
+    ~Sweep_Checkpoint();
+    Sweep_Checkpoint(const Sweep_Checkpoint &) = delete;
+    Sweep_Checkpoint &operator=(const Sweep_Checkpoint &) = delete;
+
+    // maps the file, which is created empty if it does not exist or has
+    // another layout, and returns false on failure
+    bool open(const std::string &path);
+    void close();
+    bool is_open() const { return data_ != nullptr; }
+
+    // whether the file holds a state, whose rewrite was not interrupted
+    bool has_state() const;
+    void clear();
+
+    Sweep_Checkpoint_Data &data() { return *data_; }
+    const Sweep_Checkpoint_Data &data() const { return *data_; }
+
+    // schedules the pages for writing to the disk
+    void sync();
+
+private:
+    Sweep_Checkpoint_Data *data_ = nullptr;
+};
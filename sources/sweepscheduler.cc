@@ -0,0 +1,556 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "sweepscheduler.h"
+#include "messages.h"
+#include "sweepcheckpoint.h"
+#include "dsp/adaptive_grid.h"
+#include "dsp/windows.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+Sweep_Scheduler::Sweep_Scheduler()
+{
+    const unsigned nc = Analysis::sweep_capacity;
+    freqs_.reset(new double[nc]());
+    coarse_.reset(new bool[nc]());
+    for (unsigned spl = 0; spl < 2; ++spl) {
+        response_[spl].reset(new cfloat[nc]());
+        valid_[spl].reset(new bool[nc]());
+        snr_[spl].reset(new float[nc]());
+    }
+
+    reset_grid();
+}
+
+Sweep_Scheduler::~Sweep_Scheduler()
+{
+}
+
+void Sweep_Scheduler::set_resolution(double hz)
+{
+    resolution_ = hz;
+}
+
+void Sweep_Scheduler::set_levels(bool lo, bool hi)
+{
+    lo_enable_ = lo;
+    hi_enable_ = hi;
+    progress_.reset();
+    checkpoint_stale_ = true;
+    resumed_ = false;
+}
+
+bool Sweep_Scheduler::level_enabled(int spl) const
+{
+    switch (spl) {
+    default:
+        return false;
+    case Analysis::Signal_Lo:
+        return lo_enable_;
+    case Analysis::Signal_Hi:
+        return hi_enable_;
+    }
+}
+
+int Sweep_Scheduler::next_level(int spl) const
+{
+    if (!lo_enable_ && !hi_enable_)
+        return -1;
+    else if ((spl == -1 || spl == Analysis::Signal_Hi) && lo_enable_)
+        return Analysis::Signal_Lo;
+    else if ((spl == -1 || spl == Analysis::Signal_Lo) && hi_enable_)
+        return Analysis::Signal_Hi;
+    else
+        return spl;
+}
+
+int Sweep_Scheduler::display_level() const
+{
+    return hi_enable_ ? Analysis::Signal_Hi : Analysis::Signal_Lo;
+}
+
+bool Sweep_Scheduler::set_level(int spl)
+{
+    if (level_ == spl)
+        return false;
+    level_ = spl;
+    progress_.reset();
+    checkpoint_stale_ = true;
+    resumed_ = false;
+    return true;
+}
+
+void Sweep_Scheduler::set_freqs_at_once(unsigned count)
+{
+    freqs_at_once_ = count;
+
+    // automatic, when zero, and calibrated again at every selection
+    if (count == 0) {
+        for (unsigned *density : auto_density_)
+            std::fill_n(density, Analysis::parallel_regions, 0);
+        probe_density_ = 1;
+    }
+}
+
+void Sweep_Scheduler::set_adaptive(bool adaptive)
+{
+    adaptive_ = adaptive;
+    reset_grid();
+}
+
+void Sweep_Scheduler::reset_grid()
+{
+    const unsigned ns = Analysis::sweep_length;
+    double *freqs = freqs_.get();
+
+    const double lx1 = std::log10((double)Analysis::freq_range_min);
+    const double lx2 = std::log10((double)Analysis::freq_range_max);
+    for (unsigned i = 0; i < ns; ++i) {
+        double r = (double)i / (ns - 1);
+        freqs[i] = std::pow(10.0, lx1 + r * (lx2 - lx1));
+    }
+
+    num_points_ = ns;
+    for (unsigned spl = 0; spl < 2; ++spl) {
+        std::fill_n(response_[spl].get(), ns, cfloat());
+        std::fill_n(valid_[spl].get(), ns, false);
+        std::fill_n(snr_[spl].get(), ns, 0.0f);
+    }
+    std::fill_n(coarse_.get(), ns, true);
+
+    progress_.reset();
+    noise_due_ = true;
+    index_ = 0;
+    std::fill_n(auto_offset_, Analysis::parallel_regions, 0);
+    auto_region_ = 0;
+    checkpoint_stale_ = true;
+    resumed_ = false;
+}
+
+void Sweep_Scheduler::restart()
+{
+    progress_.reset();
+    noise_due_ = true;
+    checkpoint_stale_ = true;
+    resumed_ = false;
+}
+
+void Sweep_Scheduler::set_checkpoint(Sweep_Checkpoint *checkpoint)
+{
+    checkpoint_ = checkpoint;
+    checkpoint_stale_ = true;
+}
+
+bool Sweep_Scheduler::resume()
+{
+    if (!checkpoint_ || !checkpoint_->has_state())
+        return false;
+
+    const Sweep_Checkpoint_Data &data = checkpoint_->data();
+    const unsigned ns = data.num_points;
+    const int spl = data.level;
+    bool same = data.resolution == resolution_ && (bool)data.adaptive == adaptive_ &&
+        (bool)data.lo_enable == lo_enable_ && (bool)data.hi_enable == hi_enable_ &&
+        level_enabled(spl) && ns <= Analysis::sweep_capacity &&
+        (adaptive_ || ns == Analysis::sweep_length);
+    if (!same)
+        return false;
+
+    Progress progress;
+    for (unsigned i = 0; i < ns; ++i)
+        progress.set(i, (data.progress[i / 64] >> (i % 64)) & 1);
+    if (progress.none() || progress.count() == ns)
+        return false;
+
+    num_points_ = ns;
+    std::copy_n(data.freqs, ns, freqs_.get());
+    for (unsigned l = 0; l < 2; ++l) {
+        std::copy_n(data.response[l], ns, response_[l].get());
+        std::copy_n(data.snr[l], ns, snr_[l].get());
+        for (unsigned i = 0; i < ns; ++i)
+            valid_[l][i] = data.valid[l][i];
+    }
+    for (unsigned i = 0; i < ns; ++i)
+        coarse_[i] = data.coarse[i];
+
+    level_ = spl;
+    index_ = std::min(data.index, ns - 1);
+    progress_ = progress;
+    noise_due_ = true;
+    checkpoint_stale_ = false;
+    resumed_ = true;
+    return true;
+}
+
+void Sweep_Scheduler::save_checkpoint(int spl, const unsigned *points, unsigned count)
+{
+    if (!checkpoint_)
+        return;
+
+    Sweep_Checkpoint_Data &data = checkpoint_->data();
+    const unsigned ns = num_points_;
+
+    if (!checkpoint_stale_) {
+        // the bits last, once their points are written
+        for (unsigned a = 0; a < count; ++a) {
+            unsigned i = points[a];
+            data.freqs[i] = freqs_[i];
+            data.response[spl][i] = response_[spl][i];
+            data.snr[spl][i] = snr_[spl][i];
+            data.valid[spl][i] = valid_[spl][i];
+        }
+        std::atomic_signal_fence(std::memory_order_release);
+        for (unsigned a = 0; a < count; ++a)
+            data.progress[points[a] / 64] |= (uint64_t)1 << (points[a] % 64);
+        data.index = index_;
+        return;
+    }
+
+    data.writing = 1;
+    std::atomic_signal_fence(std::memory_order_release);
+
+    data.resolution = resolution_;
+    data.adaptive = adaptive_;
+    data.lo_enable = lo_enable_;
+    data.hi_enable = hi_enable_;
+    data.level = (uint8_t)level_;
+    data.num_points = ns;
+    data.index = index_;
+    std::fill_n(data.progress, Sweep_Checkpoint_Data::capacity / 64, 0);
+    for (unsigned i = 0; i < ns; ++i) {
+        if (progress_.test(i))
+            data.progress[i / 64] |= (uint64_t)1 << (i % 64);
+    }
+    std::copy_n(freqs_.get(), ns, data.freqs);
+    for (unsigned l = 0; l < 2; ++l) {
+        std::copy_n(response_[l].get(), ns, data.response[l]);
+        std::copy_n(snr_[l].get(), ns, data.snr[l]);
+        for (unsigned i = 0; i < ns; ++i)
+            data.valid[l][i] = valid_[l][i];
+    }
+    for (unsigned i = 0; i < ns; ++i)
+        data.coarse[i] = coarse_[i];
+
+    std::atomic_signal_fence(std::memory_order_release);
+    data.writing = 0;
+    checkpoint_->sync();
+    checkpoint_stale_ = false;
+}
+
+Messages::RequestAnalyzeFrequency &Sweep_Scheduler::plan(Message_Buffer &buffer)
+{
+    unsigned *points = step_points_;
+    unsigned count;
+
+    step_noise_ = noise_due_;
+    if (step_noise_) {
+        step_probe_ = false;
+        count = 0;
+    }
+    else if (freqs_at_once_ == 0)
+        count = plan_auto(points);
+    else if (adaptive_ || resumed_) {
+        step_probe_ = false;
+        count = plan_unmeasured(points);
+    }
+    else {
+        step_probe_ = false;
+        count = max_spread(freqs_at_once_);
+        for (unsigned a = 0; a < count; ++a)
+            points[a] = Analysis::nth_bin_position(index_, a, count);
+    }
+
+    step_num_points_ = count;
+    auto &msg = buffer.emplace<Messages::RequestAnalyzeFrequency>(count);
+    msg.spl = level_;
+    msg.uncertainty = target_uncertainty_;
+    msg.window = window_;
+    float *frequency = msg.frequency();
+    for (unsigned a = 0; a < count; ++a)
+        frequency[a] = freqs_[points[a]];
+    return msg;
+}
+
+unsigned Sweep_Scheduler::plan_auto(unsigned *points)
+{
+    const unsigned ns = num_points_;
+    const unsigned len = ns / Analysis::parallel_regions;
+    const unsigned *density = auto_density_[level_];
+
+    // probe the regions not calibrated yet, with increasing density
+    for (unsigned r = 0; r < Analysis::parallel_regions; ++r) {
+        if (density[r] == 0) {
+            step_probe_ = true;
+            probe_region_ = r;
+            const unsigned count = probe_density_;
+            for (unsigned a = 0; a < count; ++a)
+                points[a] = r * len + a * len / count;
+            return count;
+        }
+    }
+
+    step_probe_ = false;
+
+    if (adaptive_ || resumed_)
+        return plan_unmeasured(points);
+
+    // measure the regions in turn, skipping those done in this sweep
+    unsigned r = auto_region_;
+    for (unsigned i = 0; i < Analysis::parallel_regions && region_complete(r); ++i)
+        r = (r + 1) % Analysis::parallel_regions;
+    auto_region_ = r;
+
+    const unsigned count = density[r];
+    const unsigned offset = auto_offset_[r];
+    for (unsigned a = 0; a < count; ++a)
+        points[a] = r * len + (offset + a * len / count) % len;
+    return count;
+}
+
+unsigned Sweep_Scheduler::plan_unmeasured(unsigned *points)
+{
+    const unsigned ns = num_points_;
+    const unsigned len = ns / Analysis::parallel_regions;
+
+    unsigned first = 0;
+    while (first < ns && progress_.test(first))
+        ++first;
+    if (first == ns)
+        first = 0;
+
+    // spread over the points left, or those of one region if automatic
+    unsigned lo = 0, hi = ns;
+    unsigned count = max_spread(freqs_at_once_);
+    if (freqs_at_once_ == 0) {
+        unsigned r = std::min(first / len, (unsigned)Analysis::parallel_regions - 1);
+        lo = r * len;
+        hi = (r + 1 < Analysis::parallel_regions) ? (lo + len) : ns;
+        count = auto_density_[level_][r];
+    }
+
+    unsigned pending[Analysis::sweep_capacity];
+    unsigned num_pending = 0;
+    for (unsigned i = lo; i < hi; ++i) {
+        if (!progress_.test(i))
+            pending[num_pending++] = i;
+    }
+    if (num_pending == 0)
+        pending[num_pending++] = first;
+
+    count = std::min(count, num_pending);
+    for (unsigned a = 0; a < count; ++a)
+        points[a] = pending[a * num_pending / count];
+    return count;
+}
+
+void Sweep_Scheduler::advance()
+{
+    if (adaptive_ || resumed_) {
+        index_ = step_points_[0];
+        return;
+    }
+
+    if (freqs_at_once_ != 0) {
+        index_ = (index_ + 1) % num_points_;
+        return;
+    }
+
+    const unsigned len = num_points_ / Analysis::parallel_regions;
+    unsigned r = auto_region_;
+    auto_offset_[r] = (auto_offset_[r] + 1) % len;
+    auto_region_ = (r + 1) % Analysis::parallel_regions;
+    index_ = step_points_[0];
+}
+
+bool Sweep_Scheduler::region_complete(unsigned region) const
+{
+    const unsigned len = num_points_ / Analysis::parallel_regions;
+    for (unsigned i = region * len, e = i + len; i < e; ++i) {
+        if (!progress_.test(i))
+            return false;
+    }
+    return true;
+}
+
+unsigned Sweep_Scheduler::max_spread(unsigned count) const
+{
+    // the grid is tightest at its start
+    const unsigned ns = num_points_;
+    const double *freqs = freqs_.get();
+    const double gap = min_gap();
+
+    count = std::min(count, ns);
+    while (count > 1 && freqs[ns / count] - freqs[0] < gap)
+        --count;
+    return count;
+}
+
+unsigned Sweep_Scheduler::max_density(unsigned region) const
+{
+    // the residual does not see the tones within the main lobe of another;
+    // the grid is tightest at the region start
+    const unsigned len = num_points_ / Analysis::parallel_regions;
+    const double *freqs = &freqs_[region * len];
+    const double gap = min_gap();
+
+    unsigned density = std::min<unsigned>(len, Analysis::max_bins_at_once);
+    while (density > 1 && freqs[len / density] - freqs[0] < gap)
+        density /= 2;
+    return density;
+}
+
+double Sweep_Scheduler::min_gap() const
+{
+    // the main lobe of the window, and the bin past it which the fit of the
+    // peak reads
+    return (window_lobe_bins(window_) + 1) * resolution_;
+}
+
+bool Sweep_Scheduler::probe(int spl, float residual)
+{
+    const unsigned max_density = this->max_density(probe_region_);
+    const unsigned density = probe_density_;
+
+    // compare the intermodulation and noise to the single tone
+    double level = 10 * std::log10(residual + 1e-20);
+    bool accept;
+    if (density == 1) {
+        probe_baseline_ = level;
+        accept = true;
+    }
+    else {
+        double limit = std::max<double>(
+            probe_baseline_ + Analysis::parallel_margin_db, Analysis::parallel_floor_db);
+        accept = level <= limit;
+    }
+
+    if (accept && density * 2 <= max_density) {
+        probe_density_ = density * 2;
+        return false;
+    }
+
+    auto_density_[spl][probe_region_] = accept ? density : (density / 2);
+    probe_density_ = 1;
+    return true;
+}
+
+void Sweep_Scheduler::store(const Messages::NotifyFrequencyAnalysis &msg)
+{
+    const int spl = msg.spl;
+    cfloat *response = response_[spl].get();
+    bool *valid = valid_[spl].get();
+    float *snr = snr_[spl].get();
+
+    const float *frequency = msg.frequency();
+    const cfloat *step_response = msg.response();
+    const float *step_snr = msg.snr();
+    unsigned done_bins = std::min(msg.num_bins, step_num_points_);
+    for (unsigned a = 0; a < done_bins; ++a)  {
+        unsigned dst_index = step_points_[a];
+        freqs_[dst_index] = frequency[a];
+        response[dst_index] = step_response[a];
+        valid[dst_index] = true;
+        snr[dst_index] = step_snr[a];
+        progress_.set(dst_index);
+    }
+    step_num_points_ = done_bins;
+    save_checkpoint(spl, step_points_, done_bins);
+}
+
+Sweep_Scheduler::Outcome Sweep_Scheduler::finish_step(int spl)
+{
+    Outcome outcome;
+
+    // the noise floor is not a step of the sweep
+    if (step_noise_) {
+        step_noise_ = false;
+        noise_due_ = false;
+        return outcome;
+    }
+
+    bool sweep_done = progress_.count() == num_points_;
+    // the adaptive sweep goes on with the points it adds
+    if (sweep_done && adaptive_ && refine(spl)) {
+        outcome.refined = true;
+        sweep_done = false;
+    }
+    outcome.sweep_done = sweep_done;
+    if (sweep_done) {
+        noise_due_ = true;
+        resumed_ = false;
+    }
+
+    if (sweep_done || !level_enabled(spl))
+        spl = next_level(level_);
+    if (sweep_done && spl == level_) {
+        progress_.reset();
+        checkpoint_stale_ = true;
+    }
+    advance();
+    outcome.level_changed = set_level(spl);
+
+    save_checkpoint(level_, nullptr, 0);
+    return outcome;
+}
+
+bool Sweep_Scheduler::refine(int spl)
+{
+    const unsigned n = num_points_;
+
+    Grid_Refinement params;
+    // the generator rounds the frequencies to the bins of the analysis
+    params.min_spacing = resolution_;
+
+    double added[Analysis::sweep_capacity];
+    unsigned k = ::refine_grid(
+        freqs_.get(), response_[spl].get(), valid_[spl].get(), n,
+        params, added, Analysis::sweep_capacity - n);
+    if (k == 0)
+        return false;
+
+    double *freqs = freqs_.get();
+    cfloat *lo_response = response_[Analysis::Signal_Lo].get();
+    cfloat *hi_response = response_[Analysis::Signal_Hi].get();
+    bool *lo_valid = valid_[Analysis::Signal_Lo].get();
+    bool *hi_valid = valid_[Analysis::Signal_Hi].get();
+    float *lo_snr = snr_[Analysis::Signal_Lo].get();
+    float *hi_snr = snr_[Analysis::Signal_Hi].get();
+    bool *coarse = coarse_.get();
+    Progress progress;
+
+    unsigned in_place = merge_grid(
+        freqs, n, added, k,
+        [&](unsigned from, unsigned to) {
+            freqs[to] = freqs[from];
+            lo_response[to] = lo_response[from];
+            hi_response[to] = hi_response[from];
+            lo_valid[to] = lo_valid[from];
+            hi_valid[to] = hi_valid[from];
+            lo_snr[to] = lo_snr[from];
+            hi_snr[to] = hi_snr[from];
+            coarse[to] = coarse[from];
+            progress.set(to, progress_.test(from));
+        },
+        [&](unsigned to, unsigned index) {
+            freqs[to] = added[index];
+            lo_response[to] = 0;
+            hi_response[to] = 0;
+            lo_valid[to] = false;
+            hi_valid[to] = false;
+            lo_snr[to] = 0;
+            hi_snr[to] = 0;
+            coarse[to] = false;
+        });
+
+    for (unsigned i = 0; i < in_place; ++i)
+        progress.set(i, progress_.test(i));
+    progress_ = progress;
+
+    num_points_ = n + k;
+    checkpoint_stale_ = true;
+    return true;
+}
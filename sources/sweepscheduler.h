@@ -0,0 +1,159 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include "analyzerdefs.h"
+#include "utility/counting_bitset.h"
+#include <complex>
+#include <memory>
+class Message_Buffer;
+class Sweep_Checkpoint;
+namespace Messages {
+    struct RequestAnalyzeFrequency;
+    struct NotifyFrequencyAnalysis;
+}
+
+//------------------------------------------------------------------------------
+// Bookkeeping of the stepped sine sweep: the frequency grid, the responses,
+// the levels in turn, the choice of frequencies at each step, the automatic
+// parallelism, and the adaptive refinement of the grid.
+class Sweep_Scheduler {
+public:
+    typedef std::complex<float> cfloat;
+    typedef counting_bitset<Analysis::sweep_capacity> Progress;
+
+    Sweep_Scheduler();
+    ~Sweep_Scheduler();
+
+    // spacing of the frequencies which the generator can play
+    void set_resolution(double hz);
+
+    void set_levels(bool lo, bool hi);
+    bool level_enabled(int spl) const;
+    int next_level(int spl) const;
+    int display_level() const;
+
+    // the current level, and whether it changed
+    int level() const { return level_; }
+    bool set_level(int spl);
+
+    // the count of frequencies at once, or 0 for automatic
+    void set_freqs_at_once(unsigned count);
+    unsigned freqs_at_once() const { return freqs_at_once_; }
+    const unsigned *auto_density(int spl) const { return auto_density_[spl]; }
+
+    void set_adaptive(bool adaptive);
+    bool adaptive() const { return adaptive_; }
+
+    // the uncertainty in dB which sets the length of the captures, from the
+    // noise floor measured at the start of every sweep, or 0 for fixed
+    void set_target_uncertainty(double db) { target_uncertainty_ = db; }
+    double target_uncertainty() const { return target_uncertainty_; }
+
+    // the window of the analysis, of Analysis::Window_Type
+    void set_window(int window) { window_ = window; }
+    int window() const { return window_; }
+
+    // the largest count up to `count` of tones spread evenly over the grid
+    // which stay apart by the main lobe of the window
+    unsigned max_spread(unsigned count) const;
+
+    void reset_grid();
+    unsigned size() const { return num_points_; }
+    double *frequencies() { return freqs_.get(); }
+    const double *frequencies() const { return freqs_.get(); }
+    cfloat *response(int spl) { return response_[spl].get(); }
+    const cfloat *response(int spl) const { return response_[spl].get(); }
+    const bool *valid(int spl) const { return valid_[spl].get(); }
+    // power of the tone relative to the noise floor, 0 if not measured
+    const float *snr(int spl) const { return snr_[spl].get(); }
+    const bool *coarse() const { return coarse_.get(); }
+
+    unsigned index() const { return index_; }
+    void set_index(unsigned index) { index_ = index; }
+    Progress &progress() { return progress_; }
+    // starts the sweep over, after a new measure of the noise floor
+    void restart();
+    double completion() const { return progress_.count() * (1.0 / num_points_); }
+
+    // the file where the state is saved as the points complete, or null
+    void set_checkpoint(Sweep_Checkpoint *checkpoint);
+    // continues the partial sweep of the checkpoint, if it was made with the
+    // same settings, measuring only the points missing after a new measure of
+    // the noise floor, and returns false otherwise
+    bool resume();
+
+    // the step to measure next, at the current level
+    Messages::RequestAnalyzeFrequency &plan(Message_Buffer &buffer);
+    bool probing() const { return step_probe_; }
+    bool measuring_noise() const { return step_noise_; }
+    unsigned step_size() const { return step_num_points_; }
+    const unsigned *step_points() const { return step_points_; }
+
+    // the result of a measure step, which returns true if the automatic
+    // parallelism was calibrated
+    bool probe(int spl, float residual);
+    void store(const Messages::NotifyFrequencyAnalysis &msg);
+
+    struct Outcome {
+        bool sweep_done = false;
+        bool refined = false;
+        bool level_changed = false;
+    };
+    Outcome finish_step(int spl);
+
+private:
+    unsigned plan_auto(unsigned *points);
+    unsigned plan_unmeasured(unsigned *points);
+    void advance();
+    bool region_complete(unsigned region) const;
+    unsigned max_density(unsigned region) const;
+    double min_gap() const;
+    bool refine(int spl);
+    void save_checkpoint(int spl, const unsigned *points, unsigned count);
+
+private:
+    double resolution_ = 1;
+
+    // sorted grid, coarse at first, and refined by the adaptive sweep
+    unsigned num_points_ = 0;
+    bool adaptive_ = false;
+    std::unique_ptr<double[]> freqs_;
+    std::unique_ptr<cfloat[]> response_[2];
+    std::unique_ptr<bool[]> valid_[2];
+    std::unique_ptr<float[]> snr_[2];
+    std::unique_ptr<bool[]> coarse_;
+
+    unsigned index_ = 0;
+    int level_ = Analysis::Signal_Lo;
+    unsigned freqs_at_once_ = 1;
+    Progress progress_;
+    bool lo_enable_ = true;
+    bool hi_enable_ = true;
+    double target_uncertainty_ = 0;
+    int window_ = Analysis::Window_Hann;
+    bool noise_due_ = true;
+
+    // the checkpoint is written entirely at the next step if stale, and
+    // otherwise by the points of each step
+    Sweep_Checkpoint *checkpoint_ = nullptr;
+    bool checkpoint_stale_ = true;
+    // a resumed sweep measures the points missing in any order
+    bool resumed_ = false;
+
+    // positions measured by the step in progress
+    unsigned step_points_[Analysis::max_bins_at_once] = {};
+    unsigned step_num_points_ = 0;
+    bool step_probe_ = false;
+    bool step_noise_ = false;
+
+    // automatic parallelism, by level and by region
+    unsigned auto_density_[2][Analysis::parallel_regions] = {};
+    unsigned auto_offset_[Analysis::parallel_regions] = {};
+    unsigned auto_region_ = 0;
+    unsigned probe_region_ = 0;
+    unsigned probe_density_ = 1;
+    double probe_baseline_ = 0;
+};
@@ -0,0 +1,112 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "tracer.h"
+#include "audiosys.h"
+#include "utility/ring_buffer.h"
+#include <fstream>
+#include <vector>
+
+struct Tracer::Impl {
+    struct Event {
+        const char *name;
+        uint32_t frame;
+        uint32_t id;
+        char phase;
+        uint8_t track;
+    };
+
+    std::string path_;
+    std::unique_ptr<Ring_Buffer> rb_audio_;
+    std::vector<Event> events_;
+    jack_nframes_t origin_ = 0;
+    std::atomic<unsigned long> dropped_{0};
+};
+
+Tracer &Tracer::instance()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::Tracer()
+    : P(new Impl)
+{
+}
+
+Tracer::~Tracer()
+{
+}
+
+void Tracer::start(const std::string &path)
+{
+    P->path_ = path;
+    P->rb_audio_.reset(new Ring_Buffer(1024 * sizeof(Impl::Event)));
+    P->events_.reserve(65536);
+    P->origin_ = Audio_Sys::instance().frame_time();
+    enabled_.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::record(Track track, Phase phase, const char *name, uint32_t id)
+{
+    Impl::Event ev;
+    ev.name = name;
+    ev.frame = Audio_Sys::instance().frame_time();
+    ev.id = id;
+    ev.phase = phase;
+    ev.track = track;
+
+    if (track == Track_Audio) {
+        Ring_Buffer &rb = *P->rb_audio_;
+        if (!rb.put(ev))
+            ++P->dropped_;
+    }
+    else
+        P->events_.push_back(ev);
+}
+
+void Tracer::collect()
+{
+    if (!enabled())
+        return;
+
+    Ring_Buffer &rb = *P->rb_audio_;
+    Impl::Event ev;
+    while (rb.get(ev))
+        P->events_.push_back(ev);
+}
+
+bool Tracer::save()
+{
+    if (!enabled())
+        return true;
+
+    collect();
+
+    std::ofstream file(P->path_);
+    const double us_per_frame = 1e6 / Audio_Sys::instance().sample_rate();
+    static const char *const track_names[] = {"GUI", "Audio"};
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (unsigned t = 0; t < 2; ++t) {
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t + 1
+             << ",\"args\":{\"name\":\"" << track_names[t] << "\"}},\n";
+    }
+    for (const Impl::Event &ev : P->events_) {
+        // frame times wrap around, so take them relative to the start
+        double ts = (uint32_t)(ev.frame - P->origin_) * us_per_frame;
+        file << "{\"name\":\"" << ev.name << "\",\"cat\":\"sweep\",\"ph\":\"" << ev.phase
+             << "\",\"pid\":1,\"tid\":" << ev.track + 1 << ",\"ts\":" << std::fixed << ts;
+        if (ev.phase == Phase_Async_Begin || ev.phase == Phase_Async_End)
+            file << ",\"id\":" << ev.id;
+        else if (ev.phase == Phase_Instant)
+            file << ",\"s\":\"t\"";
+        file << "},\n";
+    }
+    file << "{\"name\":\"process_labels\",\"ph\":\"M\",\"pid\":1,\"args\":{\"labels\":\""
+         << P->dropped_.load() << " dropped events\"}}\n]}\n";
+
+    return bool(file.flush());
+}
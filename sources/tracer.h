@@ -0,0 +1,61 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+//------------------------------------------------------------------------------
+// Opt-in recorder of the sweep timeline, saved in the trace-event format.
+//
+// Events are stamped with the JACK frame time. The audio thread sends its
+// events through a lock-free ring which the GUI thread collects, and the GUI
+// thread records its own events directly. When the tracer is not started,
+// recording an event costs one relaxed atomic load.
+class Tracer {
+public:
+    static Tracer &instance();
+    ~Tracer();
+
+    enum Track {
+        Track_Gui,
+        Track_Audio,
+    };
+
+    // phases of the trace-event format
+    enum Phase : char {
+        Phase_Begin = 'B',
+        Phase_End = 'E',
+        Phase_Async_Begin = 'b',
+        Phase_Async_End = 'e',
+        Phase_Instant = 'i',
+    };
+
+    // to call before the audio processing starts
+    void start(const std::string &path);
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // the name must be a string of static duration
+    void event(Track track, Phase phase, const char *name, uint32_t id = 0)
+    {
+        if (enabled())
+            record(track, phase, name, id);
+    }
+
+    // called by the GUI thread
+    void collect();
+    bool save();
+
+private:
+    Tracer();
+    void record(Track track, Phase phase, const char *name, uint32_t id);
+
+private:
+    std::atomic<bool> enabled_{false};
+    struct Impl;
+    std::unique_ptr<Impl> P;
+};
@@ -0,0 +1,181 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "transferanalyzer.h"
+#include "fftplan.h"
+#include "windowcache.h"
+#include "analyzerdefs.h"
+#include "dsp/kernels.h"
+#include <fftw3.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cmath>
+typedef std::complex<float> cfloat;
+typedef std::complex<double> cdouble;
+
+struct Transfer_Analyzer::Impl {
+    unsigned fft_size_ = 0;
+    const Dsp_Kernels *kernels_ = nullptr;
+    const float *window_ = nullptr;
+
+    struct Fftwf_Deleter {
+        void operator()(void *x) { fftwf_free(x); }
+    };
+
+    std::unique_ptr<float[], Fftwf_Deleter> fft_real_;
+    std::unique_ptr<cfloat[], Fftwf_Deleter> fft_x_;
+    std::unique_ptr<cfloat[], Fftwf_Deleter> fft_y_;
+    Fft_Plan fft_plan_;
+
+    std::vector<double> gxx_;
+    std::vector<double> gyy_;
+    std::vector<cdouble> gxy_;
+    unsigned num_blocks_ = 0;
+    std::atomic<unsigned> averages_{16};
+
+    std::vector<unsigned> bin_lo_;
+    std::vector<unsigned> bin_hi_;
+
+    std::mutex out_mutex_;
+    std::vector<cfloat> out_h1_;
+    std::vector<cfloat> out_h2_;
+    std::vector<float> out_coh_;
+    bool out_fresh_ = false;
+
+    void transform(const float *in, cfloat *out);
+    void evaluate();
+};
+
+Transfer_Analyzer::Transfer_Analyzer(unsigned fft_size)
+    : Stream_Analyzer(2, fft_size, fft_size / 2), P(new Impl)
+{
+    P->fft_size_ = fft_size;
+    P->kernels_ = &dsp_kernels();
+
+    P->window_ = Window_Cache::instance().get(Analysis::Window_Hann, fft_size).data;
+
+    P->fft_real_.reset(fftwf_alloc_real(fft_size));
+    P->fft_x_.reset((cfloat *)fftwf_alloc_complex(fft_size / 2 + 1));
+    P->fft_y_.reset((cfloat *)fftwf_alloc_complex(fft_size / 2 + 1));
+    if (!P->fft_real_ || !P->fft_x_ || !P->fft_y_)
+        throw std::bad_alloc();
+
+    P->fft_plan_ = Fft_Plan_Cache::instance().get(fft_size, Fft_Type::Real_Forward);
+
+    P->gxx_.resize(fft_size / 2 + 1);
+    P->gyy_.resize(fft_size / 2 + 1);
+    P->gxy_.resize(fft_size / 2 + 1);
+}
+
+Transfer_Analyzer::~Transfer_Analyzer()
+{
+    stop();
+}
+
+void Transfer_Analyzer::set_frequencies(const double *freqs, unsigned n, float sample_rate)
+{
+    const unsigned fft_size = P->fft_size_;
+    const unsigned max_bin = fft_size / 2;
+    const double bin_width = sample_rate / fft_size;
+
+    P->bin_lo_.resize(n);
+    P->bin_hi_.resize(n);
+
+    // each point covers the bins up to the geometric middle of its neighbors
+    for (unsigned i = 0; i < n; ++i) {
+        double f = freqs[i];
+        double f1 = (i > 0) ? std::sqrt(freqs[i - 1] * f) : f;
+        double f2 = (i + 1 < n) ? std::sqrt(f * freqs[i + 1]) : f;
+        unsigned center = std::min<unsigned>(std::lround(f / bin_width), max_bin);
+        unsigned lo = std::min<unsigned>(std::ceil(f1 / bin_width), center);
+        unsigned hi = std::max<unsigned>(std::floor(f2 / bin_width), center);
+        P->bin_lo_[i] = std::max(1u, lo);
+        P->bin_hi_[i] = std::min(max_bin, hi) + 1;
+    }
+
+    std::lock_guard<std::mutex> lock(P->out_mutex_);
+    P->out_h1_.assign(n, 0.0f);
+    P->out_h2_.assign(n, 0.0f);
+    P->out_coh_.assign(n, 0.0f);
+    P->out_fresh_ = false;
+}
+
+void Transfer_Analyzer::set_averages(unsigned count)
+{
+    P->averages_ = std::max(1u, count);
+}
+
+unsigned Transfer_Analyzer::averages() const
+{
+    return P->averages_;
+}
+
+bool Transfer_Analyzer::fetch(cfloat *h1, cfloat *h2, float *coherence)
+{
+    std::lock_guard<std::mutex> lock(P->out_mutex_);
+    if (!P->out_fresh_)
+        return false;
+    std::copy(P->out_h1_.begin(), P->out_h1_.end(), h1);
+    std::copy(P->out_h2_.begin(), P->out_h2_.end(), h2);
+    std::copy(P->out_coh_.begin(), P->out_coh_.end(), coherence);
+    P->out_fresh_ = false;
+    return true;
+}
+
+void Transfer_Analyzer::process_block(const float *const *block, unsigned size)
+{
+    const unsigned nbins = size / 2 + 1;
+    cfloat *x = P->fft_x_.get();
+    cfloat *y = P->fft_y_.get();
+
+    P->transform(block[0], x);
+    P->transform(block[1], y);
+
+    // linear average over the first blocks, exponential afterwards
+    unsigned k = ++P->num_blocks_;
+    double alpha = 1.0 / std::min(k, P->averages_.load());
+
+    P->kernels_->cross_spectrum(P->gxx_.data(), P->gyy_.data(), P->gxy_.data(), x, y, nbins, alpha);
+
+    P->evaluate();
+}
+
+void Transfer_Analyzer::reset()
+{
+    std::fill(P->gxx_.begin(), P->gxx_.end(), 0.0);
+    std::fill(P->gyy_.begin(), P->gyy_.end(), 0.0);
+    std::fill(P->gxy_.begin(), P->gxy_.end(), 0.0);
+    P->num_blocks_ = 0;
+}
+
+void Transfer_Analyzer::Impl::transform(const float *in, cfloat *out)
+{
+    float *real = fft_real_.get();
+    kernels_->multiply(real, in, window_, fft_size_);
+    fft_plan_.execute(real, out);
+}
+
+void Transfer_Analyzer::Impl::evaluate()
+{
+    const unsigned n = (unsigned)bin_lo_.size();
+
+    std::lock_guard<std::mutex> lock(out_mutex_);
+    for (unsigned i = 0; i < n; ++i) {
+        double sxx = 0, syy = 0;
+        cdouble sxy = 0;
+        for (unsigned b = bin_lo_[i], e = bin_hi_[i]; b < e; ++b) {
+            sxx += gxx_[b];
+            syy += gyy_[b];
+            sxy += gxy_[b];
+        }
+        double nxy = std::norm(sxy);
+        out_h1_[i] = (sxx > 0) ? cfloat(sxy / sxx) : cfloat();
+        out_h2_[i] = (nxy > 0) ? cfloat(syy * sxy / nxy) : cfloat();
+        out_coh_[i] = (sxx > 0 && syy > 0) ? (float)(nxy / (sxx * syy)) : 0.0f;
+    }
+    out_fresh_ = true;
+}
@@ -0,0 +1,39 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include "streamanalyzer.h"
+#include <complex>
+#include <memory>
+
+//------------------------------------------------------------------------------
+// Dual-channel transfer function of a system playing arbitrary material.
+//
+// Channel 0 is the reference (the input of the system), channel 1 is the
+// measurement. Cross and auto spectra are averaged over half-overlapped Hann
+// blocks (Welch), and the H1/H2 estimates and the coherence are evaluated on
+// the frequency grid, each point gathering the bins of its neighborhood.
+class Transfer_Analyzer : public Stream_Analyzer {
+public:
+    explicit Transfer_Analyzer(unsigned fft_size);
+    ~Transfer_Analyzer();
+
+    // to call before starting
+    void set_frequencies(const double *freqs, unsigned n, float sample_rate);
+
+    void set_averages(unsigned count);
+    unsigned averages() const;
+
+    // get the last estimates, returns false if nothing new since last time
+    bool fetch(std::complex<float> *h1, std::complex<float> *h2, float *coherence);
+
+protected:
+    void process_block(const float *const *block, unsigned size) override;
+    void reset() override;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> P;
+};
@@ -5,6 +5,7 @@
 
 #pragma once
 #include <bitset>
+#include <cstddef>
 
 template <size_t N>
 struct counting_bitset {
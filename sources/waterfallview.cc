@@ -0,0 +1,145 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "waterfallview.h"
+#include <QPainter>
+#include <QImage>
+#include <algorithm>
+#include <cmath>
+
+struct WaterfallView::Impl {
+    QImage image_;
+    const unsigned history_ = 256;
+    unsigned offset_ = 0;
+    unsigned count_ = 0;
+
+    double mag_min_ = -40;
+    double mag_scale_ = 255.0 / 80;
+
+    enum { lut_size = 256 };
+    QRgb lut_[lut_size];
+
+    void init_lut();
+    void init_image(unsigned height);
+};
+
+WaterfallView::WaterfallView(QWidget *parent)
+    : QWidget(parent), P(new Impl)
+{
+    P->init_lut();
+    setMinimumHeight(100);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+WaterfallView::~WaterfallView()
+{
+}
+
+void WaterfallView::setMagnitudeRange(double min, double max)
+{
+    P->mag_min_ = min;
+    P->mag_scale_ = (Impl::lut_size - 1) / (max - min);
+}
+
+void WaterfallView::addColumn(const double *mags, unsigned n)
+{
+    if ((unsigned)P->image_.height() != n)
+        P->init_image(n);
+
+    QImage &image = P->image_;
+    const unsigned col = P->offset_;
+    const double min = P->mag_min_;
+    const double scale = P->mag_scale_;
+    const QRgb *lut = P->lut_;
+
+    // lowest frequency at the bottom row
+    for (unsigned i = 0; i < n; ++i) {
+        double v = (mags[i] - min) * scale;
+        int index = std::isfinite(v) ? (int)std::lround(v) : 0;
+        index = std::max(0, std::min(index, (int)Impl::lut_size - 1));
+        QRgb *row = (QRgb *)image.scanLine(n - 1 - i);
+        row[col] = lut[index];
+    }
+
+    P->offset_ = (col + 1) % P->history_;
+    P->count_ = std::min(P->count_ + 1, P->history_);
+    update();
+}
+
+void WaterfallView::clear()
+{
+    P->image_.fill(Qt::black);
+    P->offset_ = 0;
+    P->count_ = 0;
+    update();
+}
+
+void WaterfallView::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    const QRect r = rect();
+    painter.fillRect(r, Qt::black);
+
+    const QImage &image = P->image_;
+    if (image.isNull() || P->count_ == 0)
+        return;
+
+    // the image is a ring of columns, draw it from oldest to newest
+    // so the latest sweep always appears at the right edge
+    const unsigned history = P->history_;
+    const unsigned offset = P->offset_;
+    const double colw = (double)r.width() / history;
+    const int h = image.height();
+
+    unsigned older = history - offset;
+    if (older > 0) {
+        QRectF src(offset, 0, older, h);
+        QRectF dst(r.left(), r.top(), older * colw, r.height());
+        painter.drawImage(dst, image, src);
+    }
+    if (offset > 0) {
+        QRectF src(0, 0, offset, h);
+        QRectF dst(r.left() + older * colw, r.top(), offset * colw, r.height());
+        painter.drawImage(dst, image, src);
+    }
+}
+
+void WaterfallView::Impl::init_lut()
+{
+    struct Stop { double pos; int r, g, b; };
+    static const Stop stops[] = {
+        {0.00, 0, 0, 0},
+        {0.25, 0, 0, 160},
+        {0.50, 0, 200, 200},
+        {0.75, 255, 255, 0},
+        {0.90, 255, 0, 0},
+        {1.00, 255, 255, 255},
+    };
+    const unsigned num_stops = sizeof(stops) / sizeof(stops[0]);
+
+    for (unsigned i = 0; i < lut_size; ++i) {
+        double x = (double)i / (lut_size - 1);
+        unsigned s = 1;
+        while (s < num_stops - 1 && x > stops[s].pos)
+            ++s;
+        const Stop &s1 = stops[s - 1];
+        const Stop &s2 = stops[s];
+        double mu = (x - s1.pos) / (s2.pos - s1.pos);
+        int r = std::lround(s1.r + mu * (s2.r - s1.r));
+        int g = std::lround(s1.g + mu * (s2.g - s1.g));
+        int b = std::lround(s1.b + mu * (s2.b - s1.b));
+        lut_[i] = qRgb(r, g, b);
+    }
+}
+
+void WaterfallView::Impl::init_image(unsigned height)
+{
+    image_ = QImage(history_, height, QImage::Format_RGB32);
+    image_.fill(Qt::black);
+    offset_ = 0;
+    count_ = 0;
+}
@@ -0,0 +1,28 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <QWidget>
+#include <memory>
+
+class WaterfallView : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit WaterfallView(QWidget *parent = nullptr);
+    ~WaterfallView();
+
+    void setMagnitudeRange(double min, double max);
+
+    void addColumn(const double *mags, unsigned n);
+    void clear();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> P;
+};
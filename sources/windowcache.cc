@@ -0,0 +1,65 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "windowcache.h"
+#include "rtarena.h"
+#include "analyzerdefs.h"
+#include "dsp/windows.h"
+#include <mutex>
+#include <map>
+#include <utility>
+
+struct Window_Cache::Impl {
+    typedef std::pair<int, unsigned> Key;
+
+    struct Entry {
+        Window_Table table;
+        Rt_Arena arena;
+    };
+
+    std::mutex mutex_;
+    std::map<Key, std::unique_ptr<Entry>> entries_;
+};
+
+Window_Cache &Window_Cache::instance()
+{
+    static Window_Cache cache;
+    return cache;
+}
+
+Window_Cache::Window_Cache()
+    : P(new Impl)
+{
+}
+
+Window_Cache::~Window_Cache()
+{
+}
+
+const Window_Table &Window_Cache::get(int type, unsigned size)
+{
+    if (type < 0 || (unsigned)type >= Analysis::num_window_types)
+        type = Analysis::Window_Hann;
+
+    std::lock_guard<std::mutex> lock(P->mutex_);
+
+    std::unique_ptr<Impl::Entry> &slot = P->entries_[Impl::Key(type, size)];
+    if (!slot) {
+        std::unique_ptr<Impl::Entry> e(new Impl::Entry);
+        e->arena.reset(Rt_Arena::footprint<float>(size));
+        float *data = e->arena.allocate<float>(size);
+        generate_window(type, data, size);
+
+        Window_Table &table = e->table;
+        table.type = type;
+        table.size = size;
+        table.data = data;
+        table.sum = window_sum(type, size);
+        table.square_sum = window_square_sum(type, size);
+        slot = std::move(e);
+    }
+
+    return slot->table;
+}
@@ -0,0 +1,41 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <memory>
+
+struct Window_Table {
+    int type = 0;
+    unsigned size = 0;
+    const float *data = nullptr;
+    // the sums of the coefficients and of their squares
+    double sum = 0;
+    double square_sum = 0;
+
+    // the factor from the bin of a tone to its amplitude
+    float amplitude_scale() const { return (float)(2 / sum); }
+};
+
+//------------------------------------------------------------------------------
+// Cache of the tables of the analysis windows, keyed by type and size.
+//
+// A table is computed at the first request, in memory locked like that of
+// the audio thread, and it stays valid and unchanged until the exit, so that
+// the processors and the workers read it without synchronization.
+class Window_Cache {
+public:
+    static Window_Cache &instance();
+    ~Window_Cache();
+
+    // the type is one of Analysis::Window_Type
+    const Window_Table &get(int type, unsigned size);
+
+private:
+    Window_Cache();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> P;
+};
@@ -0,0 +1,128 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "workerpool.h"
+#include <condition_variable>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Worker_Pool::Impl {
+    struct Slot {
+        Worker_Task *task;
+        bool busy;
+    };
+
+    std::mutex mutex_;
+    std::condition_variable work_cond_;
+    std::condition_variable done_cond_;
+    std::vector<Slot> slots_;
+    unsigned next_ = 0;
+    bool quit_ = false;
+    std::vector<std::thread> threads_;
+
+    void run();
+    Slot *find(Worker_Task *task);
+};
+
+Worker_Pool &Worker_Pool::instance()
+{
+    static Worker_Pool pool;
+    return pool;
+}
+
+Worker_Pool::Worker_Pool()
+    : P(new Impl)
+{
+    unsigned count = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < count; ++i)
+        P->threads_.emplace_back([this]() { P->run(); });
+}
+
+Worker_Pool::~Worker_Pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(P->mutex_);
+        P->quit_ = true;
+    }
+    P->work_cond_.notify_all();
+    for (std::thread &thread : P->threads_)
+        thread.join();
+}
+
+unsigned Worker_Pool::thread_count() const
+{
+    return (unsigned)P->threads_.size();
+}
+
+void Worker_Pool::attach(Worker_Task *task)
+{
+    std::lock_guard<std::mutex> lock(P->mutex_);
+    P->slots_.push_back(Impl::Slot{task, false});
+    P->work_cond_.notify_all();
+}
+
+void Worker_Pool::detach(Worker_Task *task)
+{
+    std::unique_lock<std::mutex> lock(P->mutex_);
+    P->done_cond_.wait(lock, [this, task]() {
+        Impl::Slot *slot = P->find(task);
+        return !slot || !slot->busy;
+    });
+    P->slots_.erase(
+        std::remove_if(P->slots_.begin(), P->slots_.end(),
+                       [task](const Impl::Slot &slot) { return slot.task == task; }),
+        P->slots_.end());
+}
+
+void Worker_Pool::Impl::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    unsigned idle = 0;
+
+    while (!quit_) {
+        // take the next task which is not being serviced
+        Worker_Task *task = nullptr;
+        const unsigned count = (unsigned)slots_.size();
+        for (unsigned i = 0; i < count && !task; ++i) {
+            Slot &slot = slots_[(next_ + i) % count];
+            if (!slot.busy) {
+                slot.busy = true;
+                task = slot.task;
+                next_ = (next_ + i + 1) % count;
+            }
+        }
+
+        if (!task) {
+            work_cond_.wait_for(lock, std::chrono::milliseconds(10));
+            continue;
+        }
+
+        lock.unlock();
+        bool worked = task->service();
+        lock.lock();
+
+        find(task)->busy = false;
+        done_cond_.notify_all();
+
+        // after a round without work, wait for more input
+        if (worked)
+            idle = 0;
+        else if (++idle >= count) {
+            idle = 0;
+            work_cond_.wait_for(lock, std::chrono::milliseconds(10));
+        }
+    }
+}
+
+Worker_Pool::Impl::Slot *Worker_Pool::Impl::find(Worker_Task *task)
+{
+    for (Slot &slot : slots_) {
+        if (slot.task == task)
+            return &slot;
+    }
+    return nullptr;
+}
@@ -0,0 +1,38 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <memory>
+
+//------------------------------------------------------------------------------
+class Worker_Task {
+public:
+    virtual ~Worker_Task() {}
+    // do a piece of work, or return false if there was nothing to do
+    virtual bool service() = 0;
+};
+
+//------------------------------------------------------------------------------
+// Pool of worker threads, one per core, which services the attached tasks in
+// turn. A task is never serviced by two threads at once, and the threads
+// sleep a while when they have found no work in any task.
+class Worker_Pool {
+public:
+    static Worker_Pool &instance();
+    ~Worker_Pool();
+
+    unsigned thread_count() const;
+
+    void attach(Worker_Task *task);
+    // wait until no thread services the task anymore
+    void detach(Worker_Task *task);
+
+private:
+    Worker_Pool();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> P;
+};
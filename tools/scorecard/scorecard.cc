@@ -0,0 +1,713 @@
+//          Copyright Jean Pierre Cimalando 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// Scorecard of the accuracy against the duration of the stepped sine sweep.
+//
+// The real audio processor measures simulated systems with a known response,
+// faster than real time, and for each setting the program reports the time
+// the sweep would take and the error of the measured response.
+
+#include "audioprocessor.h"
+#include "sweepscheduler.h"
+#include "analyzerdefs.h"
+#include "messages.h"
+#include "parameters.h"
+#include "rtguard.h"
+#include "dsp/noise_generator.h"
+#include "dsp/kernels.h"
+#include "dsp/eq_fit.h"
+#include "dsp/tone_detector.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <complex>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <cmath>
+typedef std::complex<float> cfloat;
+typedef std::complex<double> cdouble;
+
+//------------------------------------------------------------------------------
+struct Reference_System {
+    virtual ~Reference_System() {}
+    virtual const char *name() const = 0;
+    virtual void reset() = 0;
+    virtual float process(float x) = 0;
+    // the exact response, or the small-signal response if nonlinear
+    virtual cdouble response(double f) const = 0;
+};
+
+struct Biquad {
+    double b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+    double s1 = 0, s2 = 0;
+
+    // from the cookbook formulae of Robert Bristow-Johnson
+    static Biquad peak(double f, double q, double db);
+    static Biquad lowpass(double f, double q);
+    static Biquad highpass(double f, double q);
+
+    double process(double x);
+    cdouble response(double f) const;
+};
+
+Biquad Biquad::peak(double f, double q, double db)
+{
+    double w = 2 * M_PI * f / Analysis::sample_rate;
+    double a = std::pow(10.0, db / 40);
+    double alpha = std::sin(w) / (2 * q);
+    double a0 = 1 + alpha / a;
+    Biquad bq;
+    bq.b0 = (1 + alpha * a) / a0;
+    bq.b1 = -2 * std::cos(w) / a0;
+    bq.b2 = (1 - alpha * a) / a0;
+    bq.a1 = -2 * std::cos(w) / a0;
+    bq.a2 = (1 - alpha / a) / a0;
+    return bq;
+}
+
+Biquad Biquad::lowpass(double f, double q)
+{
+    double w = 2 * M_PI * f / Analysis::sample_rate;
+    double alpha = std::sin(w) / (2 * q);
+    double a0 = 1 + alpha;
+    Biquad bq;
+    bq.b0 = (1 - std::cos(w)) / 2 / a0;
+    bq.b1 = (1 - std::cos(w)) / a0;
+    bq.b2 = bq.b0;
+    bq.a1 = -2 * std::cos(w) / a0;
+    bq.a2 = (1 - alpha) / a0;
+    return bq;
+}
+
+Biquad Biquad::highpass(double f, double q)
+{
+    double w = 2 * M_PI * f / Analysis::sample_rate;
+    double alpha = std::sin(w) / (2 * q);
+    double a0 = 1 + alpha;
+    Biquad bq;
+    bq.b0 = (1 + std::cos(w)) / 2 / a0;
+    bq.b1 = -(1 + std::cos(w)) / a0;
+    bq.b2 = bq.b0;
+    bq.a1 = -2 * std::cos(w) / a0;
+    bq.a2 = (1 - alpha) / a0;
+    return bq;
+}
+
+double Biquad::process(double x)
+{
+    // transposed direct form II
+    double y = b0 * x + s1;
+    s1 = b1 * x - a1 * y + s2;
+    s2 = b2 * x - a2 * y;
+    return y;
+}
+
+cdouble Biquad::response(double f) const
+{
+    cdouble z1 = std::polar(1.0, -2 * M_PI * f / Analysis::sample_rate);
+    cdouble z2 = z1 * z1;
+    return (b0 + b1 * z1 + b2 * z2) / (1.0 + a1 * z1 + a2 * z2);
+}
+
+//------------------------------------------------------------------------------
+struct Biquad_Cascade : Reference_System {
+    std::vector<Biquad> stages_;
+
+    Biquad_Cascade()
+    {
+        stages_.push_back(Biquad::highpass(40, M_SQRT1_2));
+        stages_.push_back(Biquad::peak(1000, 4, +9));
+        stages_.push_back(Biquad::peak(3500, 8, -12));
+        stages_.push_back(Biquad::lowpass(12000, M_SQRT1_2));
+    }
+
+    const char *name() const override { return "biquads"; }
+
+    void reset() override
+    {
+        for (Biquad &bq : stages_)
+            bq.s1 = bq.s2 = 0;
+    }
+
+    float process(float x) override
+    {
+        double y = x;
+        for (Biquad &bq : stages_)
+            y = bq.process(y);
+        return y;
+    }
+
+    cdouble response(double f) const override
+    {
+        cdouble h = 1;
+        for (const Biquad &bq : stages_)
+            h *= bq.response(f);
+        return h;
+    }
+};
+
+struct Pure_Delay : Reference_System {
+    enum { delay = 37 };
+    float line_[delay] = {};
+    unsigned pos_ = 0;
+
+    const char *name() const override { return "delay"; }
+
+    void reset() override
+    {
+        std::fill_n(line_, (unsigned)delay, 0.0f);
+        pos_ = 0;
+    }
+
+    float process(float x) override
+    {
+        float y = line_[pos_];
+        line_[pos_] = x;
+        pos_ = (pos_ + 1) % delay;
+        return y;
+    }
+
+    cdouble response(double f) const override
+    {
+        return std::polar(1.0, -2 * M_PI * f * delay / Analysis::sample_rate);
+    }
+};
+
+struct Soft_Clipper : Reference_System {
+    // saturates around the level of the hi signal
+    static constexpr float drive = 3;
+
+    const char *name() const override { return "clipper"; }
+    void reset() override {}
+    float process(float x) override { return std::tanh(drive * x) / drive; }
+    cdouble response(double) const override { return 1; }
+};
+
+struct Added_Noise : Reference_System {
+    // white noise at -60 dB of full scale
+    static constexpr float level = 1e-3f;
+    White_Noise<float> noise_;
+
+    const char *name() const override { return "noise"; }
+    void reset() override {}
+    float process(float x) override { return x + level * noise_.process(); }
+    cdouble response(double) const override { return 1; }
+};
+
+struct Clock_Drift : Reference_System {
+    // the loop runs on a clock faster by 100 ppm, as through a resampler
+    static constexpr double ratio = 1 + 100e-6;
+    enum { taps = 64, phases = 512, delay = 1024, history = 8192 };
+    std::vector<float> kernel_;
+    float line_[history] = {};
+    unsigned long count_ = 0;
+
+    Clock_Drift()
+    {
+        // sinc with a Kaiser window, tabulated at fractions of a sample
+        const double beta = 8;
+        kernel_.resize((phases + 1) * 2 * taps);
+        for (unsigned p = 0; p <= phases; ++p) {
+            for (int m = -taps + 1; m <= taps; ++m) {
+                double u = (double)p / phases - m;
+                double r = u / taps;
+                double w = (std::fabs(r) < 1) ? bessel_i0(beta * std::sqrt(1 - r * r)) / bessel_i0(beta) : 0;
+                double sinc = (u == 0) ? 1 : std::sin(M_PI * u) / (M_PI * u);
+                kernel_[p * 2 * taps + (m + taps - 1)] = sinc * w;
+            }
+        }
+    }
+
+    static double bessel_i0(double x)
+    {
+        double sum = 1, term = 1;
+        for (unsigned k = 1; k < 32; ++k) {
+            term *= (x / (2 * k)) * (x / (2 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    const char *name() const override { return "drift"; }
+
+    void reset() override
+    {
+        std::fill_n(line_, (unsigned)history, 0.0f);
+        count_ = 0;
+    }
+
+    float process(float x) override
+    {
+        unsigned long j = count_++;
+        line_[j % history] = x;
+
+        double t = j * ratio - delay;
+        if (t < taps)
+            return 0;
+        long i0 = (long)t;
+        double pos = (t - i0) * phases;
+        unsigned p = (unsigned)pos;
+        float mu = pos - p;
+        const float *k0 = &kernel_[p * 2 * taps];
+        const float *k1 = &kernel_[(p + 1) * 2 * taps];
+        float y = 0;
+        for (int m = -taps + 1; m <= taps; ++m) {
+            float h = k0[m + taps - 1] + mu * (k1[m + taps - 1] - k0[m + taps - 1]);
+            y += h * line_[(i0 + m) % history];
+        }
+        return y;
+    }
+
+    cdouble response(double f) const override
+    {
+        // the delay at the start of the sweep
+        return std::polar(1.0, -2 * M_PI * f * delay / Analysis::sample_rate);
+    }
+};
+
+//------------------------------------------------------------------------------
+struct Setting {
+    int spl;
+    unsigned parallel;
+    double uncertainty;
+    int window;
+};
+
+struct Score {
+    double seconds = 0;
+    double mag_rms_db = 0;
+    double mag_max_db = 0;
+    double phase_rms_deg = 0;
+    // the uncertainty predicted from the noise floor, to compare to the error
+    double predicted_rms_db = 0;
+    bool complete = false;
+};
+
+static Score run_sweep(Audio_Processor &proc, Reference_System &sys, const Setting &setting)
+{
+    const unsigned period = 256;
+    const double max_seconds = 600;
+    const double sr = Analysis::sample_rate;
+
+    Sweep_Scheduler sched;
+    sched.set_resolution(sr / proc.fft_size());
+    sched.set_levels(setting.spl == Analysis::Signal_Lo, setting.spl == Analysis::Signal_Hi);
+    sched.set_level(setting.spl);
+    sched.set_freqs_at_once(setting.parallel);
+    sched.set_target_uncertainty(setting.uncertainty);
+    sched.set_window(setting.window);
+
+    sys.reset();
+
+    // the input of a cycle is the response to the output of the last one
+    std::vector<float> in(period), ref(period), out(period);
+    unsigned long frames = 0;
+    bool waiting = false;
+    Message_Buffer request_buf;
+    Score score;
+
+    while (frames < max_seconds * sr) {
+        while (Basic_Message *hmsg = proc.receive_message()) {
+            if (hmsg->tag != Message_Tag::NotifyFrequencyAnalysis)
+                continue;
+            auto *msg = (Messages::NotifyFrequencyAnalysis *)hmsg;
+            waiting = false;
+            if (msg->version == 0)
+                continue;
+            if (sched.probing())
+                sched.probe(msg->spl, msg->residual);
+            else {
+                sched.store(*msg);
+                score.complete = sched.finish_step(msg->spl).sweep_done;
+            }
+        }
+        if (score.complete)
+            break;
+
+        if (!waiting) {
+            proc.send_message(sched.plan(request_buf));
+            waiting = true;
+        }
+
+        for (unsigned i = 0; i < period; ++i)
+            in[i] = sys.process(out[i]);
+        {
+            // checks the cycle as if it ran in the audio thread
+            Rt_Guard::Scope guard;
+            proc.process(in.data(), ref.data(), out.data(), period);
+        }
+        frames += period;
+    }
+
+    Messages::RequestStop stop;
+    proc.send_message(stop);
+    proc.process(in.data(), ref.data(), out.data(), period);
+    while (proc.receive_message());
+
+    score.seconds = frames / sr;
+
+    const double *freqs = sched.frequencies();
+    const std::complex<float> *response = sched.response(setting.spl);
+    const float *snr = sched.snr(setting.spl);
+    double sum_mag = 0, sum_phase = 0, sum_predicted = 0;
+    unsigned count = 0;
+    for (unsigned i = 0, n = sched.size(); i < n; ++i) {
+        double f = freqs[i];
+        cdouble expected = sys.response(f);
+        // the points far below the passband say more of the noise than of the method
+        if (std::abs(expected) < 1e-3)
+            continue;
+        cdouble ratio = cdouble(response[i]) / expected;
+        double mag = 20 * std::log10(std::abs(ratio) + 1e-20);
+        double phase = std::arg(ratio) * (180 / M_PI);
+        sum_mag += mag * mag;
+        sum_phase += phase * phase;
+        double predicted = std::min(Analysis::snr_uncertainty_db(snr[i]), 100.0);
+        sum_predicted += predicted * predicted;
+        score.mag_max_db = std::max(score.mag_max_db, std::fabs(mag));
+        ++count;
+    }
+    if (count > 0) {
+        score.mag_rms_db = std::sqrt(sum_mag / count);
+        score.phase_rms_deg = std::sqrt(sum_phase / count);
+        score.predicted_rms_db = std::sqrt(sum_predicted / count);
+    }
+
+    return score;
+}
+
+//------------------------------------------------------------------------------
+// Agreement of the variants of the kernels with the scalar one, on the same
+// inputs, whose size is not a multiple of the vectors, and their speed.
+struct Kernel_Inputs {
+    enum { size = 4093 };
+    std::vector<float> a, b, phi;
+    std::vector<cfloat> x, y;
+    std::vector<uint32_t> increments;
+
+    Kernel_Inputs()
+        : a(size), b(size), phi(size), x(size), y(size)
+    {
+        White_Noise<float> noise;
+        for (unsigned i = 0; i < size; ++i) {
+            a[i] = noise.process();
+            b[i] = noise.process();
+            x[i] = cfloat(noise.process(), noise.process());
+            y[i] = cfloat(noise.process(), noise.process());
+            phi[i] = std::pow(std::sin(0.5 * M_PI * i / size), 2);
+        }
+        for (double f : {0.001, 0.01234, 0.1, 0.25, 0.3333, 0.49, 0.5})
+            increments.push_back(phase_increment(f));
+    }
+};
+
+struct Kernel_Outputs {
+    std::vector<float> tones, product, envelope, power, peaking;
+    std::vector<double> gxx, gyy;
+    std::vector<cdouble> gxy;
+};
+
+static void run_kernels(const Dsp_Kernels &k, const Kernel_Inputs &in, Kernel_Outputs &out)
+{
+    const unsigned n = Kernel_Inputs::size;
+
+    out.tones.assign(n, 0);
+    for (uint32_t increment : in.increments) {
+        // in pieces, as the periods of the audio thread
+        uint32_t phase = increment * 12345u;
+        for (unsigned i = 0; i < n; i += 1000)
+            k.oscillator(&out.tones[i], std::min(1000u, n - i), &phase, increment, 0.25f);
+    }
+
+    out.product.resize(n);
+    k.multiply(out.product.data(), in.a.data(), in.b.data(), n);
+
+    // in blocks of all sizes, with a level which decays through some
+    out.envelope.clear();
+    float level = 2;
+    for (unsigned i = 0, len = 1; i + len <= n; i += len, len = len % 97 + 1)
+        out.envelope.push_back(level = k.peak_envelope(&in.a[i], len, 0.99f, level));
+
+    out.power.resize(n);
+    k.power(out.power.data(), in.x.data(), n);
+
+    out.gxx.assign(n, 1);
+    out.gyy.assign(n, 2);
+    out.gxy.assign(n, cdouble(0.5, -0.5));
+    for (double alpha : {1.0, 0.5, 0.125})
+        k.cross_spectrum(out.gxx.data(), out.gyy.data(), out.gxy.data(), in.x.data(), in.y.data(), n, alpha);
+
+    // a narrow cut and a wide boost, on the response so far
+    out.peaking.assign(n, 0);
+    k.peaking_gain(out.peaking.data(), out.peaking.data(), in.phi.data(), n, 0.25f, 1e-5f, 1e-2f);
+    k.peaking_gain(out.peaking.data(), out.peaking.data(), in.phi.data(), n, 1e-3f, 0.5f, 0.125f);
+}
+
+template <class T>
+static double max_error(const std::vector<T> &ref, const std::vector<T> &val)
+{
+    double error = 0;
+    for (size_t i = 0; i < ref.size(); ++i)
+        error = std::max(error, (double)std::abs(ref[i] - val[i]) / std::max(1.0, (double)std::abs(ref[i])));
+    return error;
+}
+
+static bool check_kernels()
+{
+    const Kernel_Inputs in;
+    Kernel_Outputs ref;
+    std::vector<const Dsp_Kernels *> variants = supported_dsp_kernels();
+    run_kernels(*variants[0], in, ref);
+
+    printf("%-8s %11s %11s %11s %11s %11s %11s %10s\n",
+           "kernels", "oscillator", "multiply", "envelope", "power", "cross", "peaking", "time µs");
+
+    bool ok = true;
+    for (const Dsp_Kernels *k : variants) {
+        Kernel_Outputs out;
+        const unsigned rounds = 200;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned r = 0; r < rounds; ++r)
+            run_kernels(*k, in, out);
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+        // the vector variants decay the envelope by powers, and may fuse
+        // the multiply-adds, so they agree within a few roundings
+        double errors[] = {
+            max_error(ref.tones, out.tones), max_error(ref.product, out.product),
+            max_error(ref.envelope, out.envelope), max_error(ref.power, out.power),
+            std::max({max_error(ref.gxx, out.gxx), max_error(ref.gyy, out.gyy), max_error(ref.gxy, out.gxy)}),
+            max_error(ref.peaking, out.peaking),
+        };
+        const double tolerances[] = {1e-5, 0, 1e-4, 1e-6, 1e-12, 1e-5};
+        bool agree = true;
+        for (unsigned i = 0; i < 6; ++i)
+            agree = agree && errors[i] <= tolerances[i];
+        ok = ok && agree;
+
+        printf("%-8s %11.2e %11.2e %11.2e %11.2e %11.2e %11.2e %10.1f%s\n",
+               k->name, errors[0], errors[1], errors[2], errors[3], errors[4], errors[5], us,
+               agree ? "" : " (mismatch)");
+    }
+    printf("selected: %s\n", dsp_kernels().name);
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+// Fit of a correction to a dense response of known sections, with the time
+// which it takes, and the accuracy of the FIR filter of the correction.
+static bool check_eq_fit()
+{
+    const double sr = 48000;
+    const unsigned n = 4096;
+    // the frequency, gain and Q of the sections of the device
+    const double device[][3] = {
+        {45, 8, 2}, {180, -6, 1.5}, {420, 4, 4}, {1100, -9, 3}, {2500, 5, 0.8},
+        {4200, -4, 6}, {7000, 6, 2}, {12000, -8, 1.2},
+    };
+
+    std::vector<double> freqs(n), response(n);
+    std::vector<char> valid(n, 1);
+    for (unsigned i = 0; i < n; ++i) {
+        double f = freqs[i] = 20 * std::pow(1000.0, i / (n - 1.0));
+        // with a tilt, and a ripple as of the measure
+        double db = -2 * std::log2(f / 1000) + 0.2 * std::sin(i * 0.7);
+        for (const double *p : device) {
+            Eq_Section section;
+            section.frequency = p[0];
+            section.gain_db = p[1];
+            section.q = p[2];
+            db += eq_section_gain_db(section, sr, f);
+        }
+        response[i] = db;
+    }
+
+    Eq_Fit_Params params;
+    params.sample_rate = sr;
+    params.max_boost_db = 12;
+
+    printf("%-8s %8s %10s %10s\n", "threads", "sections", "error dB", "time ms");
+    Eq_Fit fit;
+    for (unsigned threads : {1u, 0u}) {
+        params.threads = threads;
+        auto start = std::chrono::steady_clock::now();
+        fit = fit_eq(freqs.data(), response.data(), (const bool *)valid.data(), nullptr, n, params);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        printf("%-8s %8zu %10.3f %10.1f\n", threads ? "1" : "all", fit.sections.size(), fit.error_db, ms);
+    }
+
+    // the FIR filter against the correction, between the ends of the range
+    const unsigned num_taps = 4096;
+    std::vector<float> taps(num_taps);
+    design_min_phase_fir(fit.frequencies.data(), fit.correction_db.data(), (unsigned)fit.frequencies.size(),
+                         sr, taps.data(), num_taps);
+    double fir_error = 0;
+    for (unsigned i = 0; i < fit.frequencies.size(); i += 16) {
+        double f = fit.frequencies[i];
+        if (f < 50 || f > 16000)
+            continue;
+        std::complex<double> h = 0;
+        for (unsigned t = 0; t < num_taps; ++t)
+            h += (double)taps[t] * std::polar(1.0, -2 * M_PI * f * t / sr);
+        fir_error = std::max(fir_error, std::fabs(20 * std::log10(std::abs(h)) - fit.correction_db[i]));
+    }
+    printf("fir: %u taps, max error %.3f dB\n", num_taps, fir_error);
+
+    return fit.error_db < 1 && fir_error < 1;
+}
+
+//------------------------------------------------------------------------------
+// Agreement of the tone detectors with the transform, on a filter and on a
+// drifting clock, with few tones and with as many as the largest detector.
+static bool check_detectors()
+{
+    struct Variant {
+        const char *name;
+        double mag_db;
+        double phase_deg;
+    };
+    // the recursion of Goertzel in single precision loses the lowest tones,
+    // and is only held to a loose bound
+    const Variant variants[] = {
+        {"goertzel", 0.5, 5},
+        {"goertzel-double", 0.005, 0.05},
+        {"lockin", 0.005, 0.05},
+        {"lockin-double", 0.005, 0.05},
+    };
+
+    std::unique_ptr<Reference_System> systems[] = {
+        std::unique_ptr<Reference_System>(new Biquad_Cascade),
+        std::unique_ptr<Reference_System>(new Clock_Drift),
+    };
+    const unsigned parallel_counts[] = {4, Analysis::max_parallel};
+
+    printf("%-16s %-8s %-8s %11s %12s\n", "detector", "system", "parallel", "mag max dB", "phase rms °");
+
+    bool ok = true;
+    for (const std::unique_ptr<Reference_System> &sys : systems) {
+        for (unsigned parallel : parallel_counts) {
+            Setting setting;
+            setting.spl = Analysis::Signal_Lo;
+            setting.parallel = parallel;
+            setting.uncertainty = 0;
+            setting.window = Analysis::Window_Hann;
+
+            // the processor takes the detector from the environment
+            unsetenv("SP_DETECTOR");
+            Score ref;
+            {
+                Audio_Processor proc;
+                ref = run_sweep(proc, *sys, setting);
+            }
+            printf("%-16s %-8s %-8u %11.3f %12.3f\n", "fft", sys->name(), parallel, ref.mag_max_db, ref.phase_rms_deg);
+
+            for (const Variant &v : variants) {
+                setenv("SP_DETECTOR", v.name, 1);
+                Audio_Processor proc;
+                Score score = run_sweep(proc, *sys, setting);
+                bool agree = score.complete &&
+                    score.mag_max_db <= ref.mag_max_db + v.mag_db &&
+                    score.phase_rms_deg <= ref.phase_rms_deg + v.phase_deg;
+                ok = ok && agree;
+                printf("%-16s %-8s %-8u %11.3f %12.3f%s\n", v.name, sys->name(), parallel,
+                       score.mag_max_db, score.phase_rms_deg, agree ? "" : " (mismatch)");
+            }
+            fflush(stdout);
+        }
+    }
+    unsetenv("SP_DETECTOR");
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    float sample_rate = 48000;
+    double uncertainty = 0;
+    int window = Analysis::Window_Hann;
+    bool detectors = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--sample-rate") && i + 1 < argc)
+            sample_rate = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--uncertainty") && i + 1 < argc)
+            uncertainty = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--window") && i + 1 < argc) {
+            const char *name = argv[++i];
+            if (!strcmp(name, "hann"))
+                window = Analysis::Window_Hann;
+            else if (!strcmp(name, "flattop"))
+                window = Analysis::Window_Flat_Top;
+            else if (!strcmp(name, "blackman-harris"))
+                window = Analysis::Window_Blackman_Harris;
+            else {
+                fprintf(stderr, "Unknown window: %s\n", name);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--detector") && i + 1 < argc) {
+            // the processor takes it from the environment
+            const char *name = argv[++i];
+            if (strcmp(name, "fft") && !make_tone_detector(name, 1)) {
+                fprintf(stderr, "Unknown detector: %s\n", name);
+                return 1;
+            }
+            setenv("SP_DETECTOR", name, 1);
+        }
+        else if (!strcmp(argv[i], "--kernels"))
+            return check_kernels() ? 0 : 1;
+        else if (!strcmp(argv[i], "--eq"))
+            return check_eq_fit() ? 0 : 1;
+        else if (!strcmp(argv[i], "--detectors"))
+            detectors = true;
+        else {
+            fprintf(stderr, "Usage: %s [--sample-rate <hz>] [--uncertainty <db>] [--window <name>] [--detector <name>] [--kernels] [--eq] [--detectors]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Parameter_Block::instance().set_sample_rate(sample_rate);
+    if (detectors)
+        return check_detectors() ? 0 : 1;
+
+    Audio_Processor proc;
+
+    std::unique_ptr<Reference_System> systems[] = {
+        std::unique_ptr<Reference_System>(new Biquad_Cascade),
+        std::unique_ptr<Reference_System>(new Pure_Delay),
+        std::unique_ptr<Reference_System>(new Soft_Clipper),
+        std::unique_ptr<Reference_System>(new Added_Noise),
+        std::unique_ptr<Reference_System>(new Clock_Drift),
+    };
+    const unsigned parallel_counts[] = {1, 2, 4, 8, 16, 32, 0};
+
+    printf("%-8s %-5s %-8s %10s %11s %11s %12s %11s\n",
+           "system", "level", "parallel", "time s", "mag rms dB", "mag max dB", "phase rms °", "pred rms dB");
+
+    for (const std::unique_ptr<Reference_System> &sys : systems) {
+        for (int spl : {Analysis::Signal_Lo, Analysis::Signal_Hi}) {
+            for (unsigned parallel : parallel_counts) {
+                Setting setting;
+                setting.spl = spl;
+                setting.parallel = parallel;
+                setting.uncertainty = uncertainty;
+                setting.window = window;
+                Score score = run_sweep(proc, *sys, setting);
+
+                std::string count = parallel ? std::to_string(parallel) : "auto";
+                printf("%-8s %-5s %-8s %10.1f %11.3f %11.3f %12.3f %11.3f%s\n",
+                       sys->name(), (spl == Analysis::Signal_Hi) ? "hi" : "lo", count.c_str(),
+                       score.seconds, score.mag_rms_db, score.mag_max_db, score.phase_rms_deg,
+                       score.predicted_rms_db,
+                       score.complete ? "" : " (incomplete)");
+                fflush(stdout);
+            }
+        }
+    }
+
+    return 0;
+}
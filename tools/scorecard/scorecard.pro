@@ -0,0 +1,11 @@
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= qt
+TARGET = scorecard
+
+include(../../sources/engine.pri)
+
+SOURCES += scorecard.cc
+
+DESTDIR = build
+OBJECTS_DIR = build/obj